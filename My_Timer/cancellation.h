@@ -0,0 +1,81 @@
+#ifndef __CANCELLATION__
+#define __CANCELLATION__
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace wzq {
+
+    class CancellationToken;
+
+    /**
+     * ȡźŵķһӦһCancellationSource񶼴token
+     * ͻ˶ϿʱʱCancelŶӵʱֱӶִеͨtokenԼȡ
+     * ԿĶͬһȡ״̬
+     */
+    class CancellationSource {
+    public:
+        CancellationSource() : state_(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void Cancel() { state_->store(true, std::memory_order_release); }
+
+        bool IsCancelled() const { return state_->load(std::memory_order_acquire); }
+
+        CancellationToken GetToken() const;
+
+    private:
+        std::shared_ptr<std::atomic<bool>> state_;
+    };
+
+    /**
+     * ȡźŵĽշֻܲѯȡĬϹtokenԶᱻȡ
+     * ִ̳߳дtokenʱΪǰtokenпCancellationToken::Current()ѯҪԼ
+     */
+    class CancellationToken {
+    public:
+        CancellationToken() {}
+
+        bool IsCancelled() const { return state_ != nullptr && state_->load(std::memory_order_acquire); }
+
+        //ǷCancellationSourceĬϹtokenfalse
+        bool CanBeCancelled() const { return state_ != nullptr; }
+
+        //ǰִ߳еtokenִдtokenʱԶᱻȡtoken
+        static const CancellationToken& Current() {
+            static const CancellationToken kNone;
+            const CancellationToken* current = CurrentSlot();
+            return current != nullptr ? *current : kNone;
+        }
+
+        //ڰtokenΪǰ̵߳ĵǰtoken뿪ʱָԭֵǶִʱҲ
+        class Scope {
+        public:
+            explicit Scope(const CancellationToken& token) : previous_(CurrentSlot()) { CurrentSlot() = &token; }
+
+            ~Scope() { CurrentSlot() = previous_; }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            const CancellationToken* previous_;
+        };
+
+    private:
+        friend class CancellationSource;
+
+        explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> state) : state_(std::move(state)) {}
+
+        static const CancellationToken*& CurrentSlot() {
+            static thread_local const CancellationToken* current = nullptr;
+            return current;
+        }
+
+        std::shared_ptr<const std::atomic<bool>> state_;
+    };
+
+    inline CancellationToken CancellationSource::GetToken() const { return CancellationToken(state_); }
+}  // namespace wzq
+
+#endif
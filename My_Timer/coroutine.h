@@ -0,0 +1,364 @@
+#ifndef __COROUTINE__
+#define __COROUTINE__
+
+//֧C++20ЭʱWZQ_COROUTINEΪ1ЭصĽӿڣҲڱѡжWZQ_COROUTINE=0ص
+#ifndef WZQ_COROUTINE
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define WZQ_COROUTINE 1
+#else
+#define WZQ_COROUTINE 0
+#endif
+#endif
+
+#if WZQ_COROUTINE
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/*
+C++20Э֧֣Task<T>Э̵ķͣThreadPool::ScheduleTimerQueue::SleepForʹã
+    co_await pool.Schedule();                         л̳߳ص߳мִ
+    co_await timer.SleepFor(std::chrono::seconds(1)); 1룬ڼ䲻ռκ߳
+    auto values = co_await coro::WhenAll(std::move(tasks));
+ͨcoro::SpawnһЭ̣coro::SyncWaitȴЭ̵Ľ
+Э֮лֱӻָЭ̾std::functionҲڴ棨Э֡⣩
+*/
+
+namespace wzq {
+namespace coro {
+
+    template <typename T = void>
+    class Task;
+
+namespace detail {
+
+    //Э̽ʱֱлȴЭִ̼УԳתƣ̳߳أջҲԽԽ
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct PromiseBase {
+        //co_awaitTaskʱſʼִ
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase {
+        Task<T> get_return_object() noexcept;
+
+        template <typename U>
+        void return_value(U&& value) {
+            result.emplace(std::forward<U>(value));
+        }
+
+        T TakeResult() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*result);
+        }
+
+        std::optional<T> result;
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object() noexcept;
+
+        void return_void() noexcept {}
+
+        void TakeResult() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+}  // namespace detail
+
+    /**
+     * Э̵ķֻͣƶܿ
+     * co_awaitһTaskʱſʼڵǰִ߳Уֱִ֮ӻصco_awaitЭ̣쳣ͨco_await
+     * TaskʱЭ֡TaskҪЭִ
+     */
+    template <typename T>
+    class Task {
+    public:
+        using promise_type = detail::Promise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        Task() noexcept : handle_(nullptr) {}
+
+        explicit Task(Handle handle) noexcept : handle_(handle) {}
+
+        Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                Destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() { Destroy(); }
+
+        bool IsValid() const noexcept { return static_cast<bool>(handle_); }
+
+        bool IsDone() const noexcept { return handle_ && handle_.done(); }
+
+        //co_await taskЭ̲ȴ
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().TakeResult(); }
+        };
+
+        Awaiter operator co_await() const noexcept { return Awaiter{handle_}; }
+
+        //co_await task.WhenReady()Э̲ȴִ꣬ȡҲ׳Эе쳣
+        struct ReadyAwaiter : Awaiter {
+            void await_resume() const noexcept {}
+        };
+
+        ReadyAwaiter WhenReady() const noexcept { return ReadyAwaiter{{handle_}}; }
+
+        //Эִ֮ȡЭ׳쳣ʱ׳ֻܵһ
+        T GetResult() { return handle_.promise().TakeResult(); }
+
+    private:
+        void Destroy() {
+            if (handle_) {
+                handle_.destroy();
+                handle_ = nullptr;
+            }
+        }
+
+        Handle handle_;
+    };
+
+namespace detail {
+
+    template <typename T>
+    Task<T> Promise<T>::get_return_object() noexcept {
+        return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> Promise<void>::get_return_object() noexcept {
+        return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+    }
+
+    //ʼִСʱԼЭ֡Э̣ͨTask
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+
+    template <typename T>
+    Detached RunDetached(Task<T> task) {
+        //PostһSpawnЭ׳쳣ûеطգֱӺ
+        co_await task.WhenReady();
+    }
+
+    //ɱ־֪ͨȴõ֮Ż᷵أ֪ͨʱ״̬һûб
+    class SyncState {
+    public:
+        void Set() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_done_ = true;
+            cv_.notify_all();
+        }
+
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return is_done_; });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool is_done_ = false;
+    };
+
+    template <typename T>
+    Detached RunAndSet(Task<T>& task, SyncState& state) {
+        co_await task.WhenReady();
+        state.Set();
+    }
+
+    //Э̸+1ʼÿЭ̽ʱ1ЭЭ̺Ҳ10һָЭ
+    class JoinCounter {
+    public:
+        explicit JoinCounter(size_t n) : count_(n + 1) {}
+
+        bool Arrive() noexcept { return count_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+        std::coroutine_handle<> parent;
+
+    private:
+        std::atomic<size_t> count_;
+    };
+
+    template <typename T>
+    Detached RunWhenAllChild(Task<T>& task, JoinCounter& counter) {
+        co_await task.WhenReady();
+        if (counter.Arrive()) {
+            counter.parent.resume();
+        }
+    }
+
+    template <typename T>
+    struct WhenAllAwaiter {
+        std::vector<Task<T>>& tasks;
+        JoinCounter& counter;
+
+        bool await_ready() const noexcept { return tasks.empty(); }
+
+        bool await_suspend(std::coroutine_handle<> parent) {
+            counter.parent = parent;
+            for (Task<T>& task : tasks) {
+                RunWhenAllChild(task, counter);
+            }
+            //Э̶ѾִͬʱֱӼִ
+            return !counter.Arrive();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    //WhenAnyغЭִ̻УǺ״̬һshared_ptrһЭ̽ʱ
+    template <typename T>
+    struct WhenAnyState {
+        explicit WhenAnyState(std::vector<Task<T>>&& t) : tasks(std::move(t)), counter(1), is_won(false), winner(0) {}
+
+        std::vector<Task<T>> tasks;
+        JoinCounter counter;
+        std::atomic<bool> is_won;
+        size_t winner;
+    };
+
+    template <typename T>
+    Detached RunWhenAnyChild(std::shared_ptr<WhenAnyState<T>> state, size_t index) {
+        co_await state->tasks[index].WhenReady();
+        if (!state->is_won.exchange(true, std::memory_order_acq_rel)) {
+            state->winner = index;
+            if (state->counter.Arrive()) {
+                state->counter.parent.resume();
+            }
+        }
+    }
+
+    template <typename T>
+    struct WhenAnyAwaiter {
+        std::shared_ptr<WhenAnyState<T>>& state;
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> parent) {
+            state->counter.parent = parent;
+            for (size_t i = 0; i < state->tasks.size(); ++i) {
+                RunWhenAnyChild(state, i);
+            }
+            return !state->counter.Arrive();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+}  // namespace detail
+
+    //ͨһЭ̣ȴЭ֡Э̽ʱԼ
+    template <typename T>
+    void Spawn(Task<T> task) {
+        detail::RunDetached(std::move(task));
+    }
+
+    //ȴЭִ겢ĽЭ׳쳣׳
+    //Ҫ̳߳صеãЭҪлͬһ̳߳ؼִУܻȲе߳
+    template <typename T>
+    T SyncWait(Task<T> task) {
+        detail::SyncState state;
+        detail::RunAndSet(task, state);
+        state.Wait();
+        return task.GetResult();
+    }
+
+    //ͬʱЭ̣ȫִԭ˳򷵻ؽЭ׳쳣ʱȫ׳һ쳣
+    //Эco_await߳ҪִʱЭco_await pool.Schedule()
+    template <typename T>
+    Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks) {
+        detail::JoinCounter counter(tasks.size());
+        co_await detail::WhenAllAwaiter<T>{tasks, counter};
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (Task<T>& task : tasks) {
+            results.push_back(task.GetResult());
+        }
+        co_return results;
+    }
+
+    inline Task<void> WhenAll(std::vector<Task<void>> tasks) {
+        detail::JoinCounter counter(tasks.size());
+        co_await detail::WhenAllAwaiter<void>{tasks, counter};
+        for (Task<void>& task : tasks) {
+            task.GetResult();
+        }
+    }
+
+    //ͬʱЭ̣һִʱͷ±ͽЭִ̼еtasksΪ
+    template <typename T>
+    Task<std::pair<size_t, T>> WhenAny(std::vector<Task<T>> tasks) {
+        auto state = std::make_shared<detail::WhenAnyState<T>>(std::move(tasks));
+        co_await detail::WhenAnyAwaiter<T>{state};
+        co_return std::pair<size_t, T>(state->winner, state->tasks[state->winner].GetResult());
+    }
+
+    inline Task<size_t> WhenAny(std::vector<Task<void>> tasks) {
+        auto state = std::make_shared<detail::WhenAnyState<void>>(std::move(tasks));
+        co_await detail::WhenAnyAwaiter<void>{state};
+        state->tasks[state->winner].GetResult();
+        co_return state->winner;
+    }
+
+}  // namespace coro
+}  // namespace wzq
+
+#endif
+
+#endif
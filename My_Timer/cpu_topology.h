@@ -0,0 +1,141 @@
+#ifndef __CPU_TOPOLOGY__
+#define __CPU_TOPOLOGY__
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace wzq {
+
+    /**
+     * CPUNUMAڵϢ
+     * Linux´/sys/devices/system/nodeȡÿڵCPUбֻǰʹõCPUûпCPUĽڵᱻ
+     * Ľڵ±겻һϵͳĽڵšƽ̨߶ȡʧʱֻһڵ㡣
+     */
+    class CpuTopology {
+    public:
+        static const CpuTopology& Get() {
+            static CpuTopology topology;
+            return topology;
+        }
+
+        int NodeNum() const { return static_cast<int>(node_cpus_.size()); }
+
+        const std::vector<int>& NodeCpus(int node) const { return node_cpus_[node]; }
+
+        //CPUڵĽڵ±꣬δ֪CPU-1
+        int NodeOfCpu(int cpu) const {
+            if (cpu < 0 || cpu >= static_cast<int>(cpu_node_.size())) {
+                return -1;
+            }
+            return cpu_node_[cpu];
+        }
+
+        //ǰ߳еCPUڵĽڵ㣬޷ȡʱ-1
+        int CurrentNode() const { return NodeOfCpu(CurrentCpu()); }
+
+        static int CurrentCpu() {
+#ifdef __linux__
+            return sched_getcpu();
+#else
+            return -1;
+#endif
+        }
+
+        //ѵǰ̰߳󶨵cpusеCPUϣֻLinux֧֣ƽ̨false
+        static bool BindCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            for (int cpu : cpus) {
+                if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &cpu_set);
+                }
+            }
+            return CPU_COUNT(&cpu_set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+            (void)cpus;
+            return false;
+#endif
+        }
+
+        //"0-3,8,10-11"ָʽCPUб
+        static std::vector<int> ParseCpuList(const std::string& text) {
+            std::vector<int> cpus;
+            std::stringstream ss(text);
+            std::string range;
+            while (std::getline(ss, range, ',')) {
+                size_t dash = range.find('-');
+                try {
+                    int first = std::stoi(range.substr(0, dash));
+                    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                    for (int cpu = first; cpu <= last; ++cpu) {
+                        cpus.push_back(cpu);
+                    }
+                }
+                catch (...) {
+                }
+            }
+            return cpus;
+        }
+
+    private:
+        static const int kMaxNodeNum = 256;
+
+        CpuTopology() {
+#ifdef __linux__
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            bool has_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+            for (int node = 0; node < kMaxNodeNum; ++node) {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                std::string text;
+                if (!file || !std::getline(file, text)) {
+                    continue;
+                }
+                std::vector<int> cpus;
+                for (int cpu : ParseCpuList(text)) {
+                    if (!has_allowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+                        cpus.push_back(cpu);
+                    }
+                }
+                if (!cpus.empty()) {
+                    AddNode(cpus);
+                }
+            }
+#endif
+            if (node_cpus_.empty()) {
+                std::vector<int> cpus;
+                int cpu_num = static_cast<int>(std::thread::hardware_concurrency());
+                for (int cpu = 0; cpu < (cpu_num > 0 ? cpu_num : 1); ++cpu) {
+                    cpus.push_back(cpu);
+                }
+                AddNode(cpus);
+            }
+        }
+
+        void AddNode(const std::vector<int>& cpus) {
+            int node = NodeNum();
+            node_cpus_.push_back(cpus);
+            for (int cpu : cpus) {
+                if (cpu >= static_cast<int>(cpu_node_.size())) {
+                    cpu_node_.resize(cpu + 1, -1);
+                }
+                cpu_node_[cpu] = node;
+            }
+        }
+
+        std::vector<std::vector<int>> node_cpus_;  //ÿڵʹõCPU
+        std::vector<int> cpu_node_;  //CPUŵڵ±ӳ
+    };
+
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef __EVENT_COUNT__
+#define __EVENT_COUNT__
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace wzq {
+
+    //ȴʱʾCPUǰæȣ͹ģҲóˮ߸ͬһϵһ߳
+    inline void CpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+
+    /**
+     * ¼""ʱ˯ߣҪϳ
+     * ȴkey = PrepareWait()ټһCancelWait()Wait(key)
+     * ֪ͨٵNotify(n)ûеȴʱֻһԭӶں
+     * ֪ͨʱepochһȴֻepochȻkeyʱ˯ߣ֪ͨᶪʧ
+     * LinuxֱepochʹfutexһֻҪĸƽ̨˻Ϊ
+     */
+    class EventCount {
+    public:
+        using Key = uint32_t;
+
+        EventCount() : epoch_(0), waiters_(0) {}
+
+        EventCount(const EventCount&) = delete;
+        EventCount& operator=(const EventCount&) = delete;
+
+        Key PrepareWait() {
+            waiters_.fetch_add(1, std::memory_order_seq_cst);
+            return epoch_.load(std::memory_order_seq_cst);
+        }
+
+        void CancelWait() { waiters_.fetch_sub(1, std::memory_order_seq_cst); }
+
+        void Wait(Key key) {
+            while (epoch_.load(std::memory_order_acquire) == key) {
+                WaitEpoch(key, nullptr);
+            }
+            waiters_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+        //ʱfalse
+        template <typename Rep, typename Period>
+        bool WaitFor(Key key, std::chrono::duration<Rep, Period> timeout) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            bool notified = true;
+            while (epoch_.load(std::memory_order_acquire) == key) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    notified = false;
+                    break;
+                }
+                auto rest = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+                WaitEpoch(key, &rest);
+            }
+            waiters_.fetch_sub(1, std::memory_order_seq_cst);
+            return notified;
+        }
+
+        //ȴis_ready()֪ͨҪٵNotify
+        template <typename Pred>
+        void Await(Pred is_ready) {
+            while (!is_ready()) {
+                Key key = PrepareWait();
+                if (is_ready()) {
+                    CancelWait();
+                    return;
+                }
+                Wait(key);
+            }
+        }
+
+        //ʱʱȻfalse
+        template <typename Pred, typename Rep, typename Period>
+        bool AwaitFor(Pred is_ready, std::chrono::duration<Rep, Period> timeout) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!is_ready()) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    return false;
+                }
+                Key key = PrepareWait();
+                if (is_ready()) {
+                    CancelWait();
+                    return true;
+                }
+                WaitFor(key, deadline - now);
+            }
+            return true;
+        }
+
+        //̳߳صеȴʱȰִ̳߳Ŷӵûִʱ˯ߣ
+        //˯kHelpWaitMsͻû񣬱̶߳ڵȴûִ߳
+        template <typename Pool, typename Pred>
+        void AwaitInPool(Pool& pool, Pred is_ready) {
+            while (!is_ready()) {
+                if (pool.RunPendingTask()) {
+                    continue;
+                }
+                Key key = PrepareWait();
+                if (is_ready()) {
+                    CancelWait();
+                    return;
+                }
+                WaitFor(key, std::chrono::milliseconds(static_cast<int64_t>(kHelpWaitMs)));
+            }
+        }
+
+        //໽nȴ
+        void Notify(size_t n = 1) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (n == 0 || waiters_.load(std::memory_order_seq_cst) == 0) {
+                return;
+            }
+            Wake(n);
+        }
+
+        void NotifyAll() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiters_.load(std::memory_order_seq_cst) == 0) {
+                return;
+            }
+            Wake(INT_MAX);
+        }
+
+    private:
+        static const int kHelpWaitMs = 1;
+
+#ifdef __linux__
+        void WaitEpoch(Key key, const std::chrono::nanoseconds* timeout) {
+            struct timespec ts;
+            if (timeout != nullptr) {
+                ts.tv_sec = static_cast<time_t>(timeout->count() / 1000000000);
+                ts.tv_nsec = static_cast<long>(timeout->count() % 1000000000);
+            }
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, key,
+                timeout != nullptr ? &ts : nullptr, nullptr, 0);
+        }
+
+        void Wake(size_t n) {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE,
+                static_cast<int>(n < INT_MAX ? n : INT_MAX), nullptr, nullptr, 0);
+        }
+#else
+        void WaitEpoch(Key key, const std::chrono::nanoseconds* timeout) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto changed = [this, key] { return epoch_.load(std::memory_order_acquire) != key; };
+            if (timeout != nullptr) {
+                cv_.wait_for(lock, *timeout, changed);
+            }
+            else {
+                cv_.wait(lock, changed);
+            }
+        }
+
+        void Wake(size_t n) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                epoch_.fetch_add(1, std::memory_order_seq_cst);
+            }
+            if (n >= static_cast<size_t>(waiters_.load())) {
+                cv_.notify_all();
+                return;
+            }
+            while (n-- > 0) {
+                cv_.notify_one();
+            }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+#endif
+
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32-bit word");
+
+        std::atomic<uint32_t> epoch_;
+        std::atomic<int> waiters_;
+    };
+
+}  // namespace wzq
+
+#endif
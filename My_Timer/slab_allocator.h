@@ -0,0 +1,326 @@
+#ifndef __SLAB_ALLOCATOR__
+#define __SLAB_ALLOCATOR__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//·ϵС(нڵ㡢ŲTaskĿɵö)Ƿʹslab䣬Ϊ0ʱֱʹnew/delete
+#ifndef WZQ_TASK_SLAB
+#define WZQ_TASK_SLAB 1
+#endif
+
+/*
+̶СڴķտСֳ32/64/128/256ֽĸÿ
+ÿ߳ԼĻ棬ͷű̵߳ĿֻĿҲûԭӲ
+߳ͷŵĿͷ߳ﰴĻܳһܹkBatchNumһCASҵԶϣ
+̱߳ʱһȡԶûппʱϵͳһslab(kSlabBlockNum)
+slabỹϵͳ߳˳ʱĻͬпһ֮󴴽̼߳ʹá
+*/
+
+namespace wzq {
+
+    /**
+     * slabͳ
+     * alloc_num: 
+     * local_hit_num: ֱӴӱ߳̿Ĵ
+     * remote_hit_num: Ϊʱ̹߳黹ĿзĴ
+     * miss_num: ҪϵͳslabĴslab_num: slab
+     * remote_free_num: ͷ̷߳ĿĴ
+     */
+    struct SlabStats {
+        uint64_t alloc_num = 0;
+        uint64_t local_hit_num = 0;
+        uint64_t remote_hit_num = 0;
+        uint64_t miss_num = 0;
+        uint64_t remote_free_num = 0;
+        uint64_t slab_num = 0;
+
+        //Ҫϵͳڴı
+        double HitRate() const {
+            return alloc_num > 0 ? static_cast<double>(local_hit_num + remote_hit_num) / alloc_num : 0.0;
+        }
+
+        void Merge(const SlabStats& other) {
+            alloc_num += other.alloc_num;
+            local_hit_num += other.local_hit_num;
+            remote_hit_num += other.remote_hit_num;
+            miss_num += other.miss_num;
+            remote_free_num += other.remote_free_num;
+            slab_num += other.slab_num;
+        }
+    };
+
+    template <size_t kBlockSize>
+    class SlabAllocator {
+    public:
+        static const size_t kSlabBlockNum = 64;
+        static const int kBatchNum = 32;
+
+        static void* Allocate() {
+            Cache* cache = LocalCache();
+            if (cache == nullptr) {
+                //߳˳Ѿȥˣ˻Ϊֱ
+                Block* block = static_cast<Block*>(::operator new(sizeof(Block)));
+                block->owner = nullptr;
+                return block->payload;
+            }
+            Block* block = cache->free_list;
+            if (block != nullptr) {
+                Add(cache->local_hit_num, 1);
+            }
+            else if ((block = cache->remote_list.exchange(nullptr, std::memory_order_acquire)) != nullptr) {
+                Add(cache->remote_hit_num, 1);
+            }
+            else {
+                block = NewSlab(cache);
+                Add(cache->miss_num, 1);
+            }
+            cache->free_list = block->next;
+            Add(cache->alloc_num, 1);
+            return block->payload;
+        }
+
+        static void Deallocate(void* ptr) {
+            Block* block = reinterpret_cast<Block*>(static_cast<char*>(ptr) - offsetof(Block, payload));
+            Cache* owner = block->owner;
+            if (owner == nullptr) {
+                ::operator delete(block);
+                return;
+            }
+            Cache* cache = LocalCache();
+            if (cache == owner) {
+                block->next = cache->free_list;
+                cache->free_list = block;
+                return;
+            }
+            if (cache == nullptr) {
+                PushRemote(owner, block, block);
+                return;
+            }
+            Add(cache->remote_free_num, 1);
+            Pending& pending = GetPending(cache, owner);
+            block->next = pending.head;
+            pending.head = block;
+            if (pending.tail == nullptr) {
+                pending.tail = block;
+            }
+            if (++pending.num >= kBatchNum) {
+                Flush(pending);
+            }
+        }
+
+        //̵߳Ļͳ֮ͣѾ˳߳
+        static SlabStats GetStats() {
+            SlabStats stats;
+            std::lock_guard<std::mutex> lock(RegistryMutex());
+            for (Cache* cache = RegistryHead(); cache != nullptr; cache = cache->registry_next) {
+                stats.alloc_num += cache->alloc_num.load(std::memory_order_relaxed);
+                stats.local_hit_num += cache->local_hit_num.load(std::memory_order_relaxed);
+                stats.remote_hit_num += cache->remote_hit_num.load(std::memory_order_relaxed);
+                stats.miss_num += cache->miss_num.load(std::memory_order_relaxed);
+                stats.remote_free_num += cache->remote_free_num.load(std::memory_order_relaxed);
+            }
+            stats.slab_num = stats.miss_num;
+            return stats;
+        }
+
+    private:
+        struct Cache;
+
+        //ͷ¼Ļ棬ʱpayloadĿͷָ
+        struct Block {
+            Cache* owner;
+            union {
+                Block* next;
+                typename std::aligned_storage<kBlockSize, alignof(std::max_align_t)>::type payload[1];
+            };
+        };
+
+        //ͷ߳Ϊĳܵһ
+        struct Pending {
+            Cache* owner = nullptr;
+            Block* head = nullptr;
+            Block* tail = nullptr;
+            int num = 0;
+        };
+
+        static const int kPendingNum = 4;
+
+        //ֻ̻߳дGetStatsʱֻ߳
+        struct Cache {
+            Block* free_list = nullptr;
+            std::atomic<Block*> remote_list{nullptr};
+            Pending pendings[kPendingNum];
+            std::atomic<uint64_t> alloc_num{0};
+            std::atomic<uint64_t> local_hit_num{0};
+            std::atomic<uint64_t> remote_hit_num{0};
+            std::atomic<uint64_t> miss_num{0};
+            std::atomic<uint64_t> remote_free_num{0};
+            bool is_used = false;  //RegistryMutex
+            Cache* registry_next = nullptr;
+        };
+
+        //߳˳ʱŵĿ鶼ȥٰѻ潻ע
+        struct CacheHolder {
+            ~CacheHolder() {
+                Cache* cache = LocalSlot();
+                for (Pending& pending : cache->pendings) {
+                    Flush(pending);
+                }
+                LocalSlot() = nullptr;
+                IsExited() = true;
+                std::lock_guard<std::mutex> lock(RegistryMutex());
+                cache->is_used = false;
+            }
+        };
+
+        static Cache*& LocalSlot() {
+            static thread_local Cache* cache = nullptr;
+            return cache;
+        }
+
+        static bool& IsExited() {
+            static thread_local bool is_exited = false;
+            return is_exited;
+        }
+
+        static Cache* LocalCache() {
+            Cache* cache = LocalSlot();
+            if (cache != nullptr || IsExited()) {
+                return cache;
+            }
+            {
+                //ȽѾ˳߳µĻ
+                std::lock_guard<std::mutex> lock(RegistryMutex());
+                for (cache = RegistryHead(); cache != nullptr && cache->is_used; cache = cache->registry_next) {
+                }
+                if (cache == nullptr) {
+                    cache = new Cache();
+                    cache->registry_next = RegistryHead();
+                    RegistryHead() = cache;
+                }
+                cache->is_used = true;
+            }
+            LocalSlot() = cache;
+            static thread_local CacheHolder holder;
+            (void)holder;
+            return cache;
+        }
+
+        //עеĻڳ˳ʱҲͷţ̬ʱȻͷſ
+        static std::mutex& RegistryMutex() {
+            static std::mutex* mutex = new std::mutex();
+            return *mutex;
+        }
+
+        static Cache*& RegistryHead() {
+            static Cache* head = nullptr;
+            return head;
+        }
+
+        //һslabһ鷵ظ(nextָɵ)
+        static Block* NewSlab(Cache* cache) {
+            Block* blocks = static_cast<Block*>(::operator new(sizeof(Block) * kSlabBlockNum));
+            for (size_t i = 0; i < kSlabBlockNum; ++i) {
+                blocks[i].owner = cache;
+                blocks[i].next = i + 1 < kSlabBlockNum ? &blocks[i + 1] : nullptr;
+            }
+            return blocks;
+        }
+
+        //ҵΪownerܿλãռʱȰܵһȥ
+        static Pending& GetPending(Cache* cache, Cache* owner) {
+            Pending* victim = &cache->pendings[0];
+            for (Pending& pending : cache->pendings) {
+                if (pending.owner == owner) {
+                    return pending;
+                }
+                if (pending.owner == nullptr) {
+                    victim = &pending;
+                }
+                else if (victim->owner != nullptr && pending.num > victim->num) {
+                    victim = &pending;
+                }
+            }
+            Flush(*victim);
+            victim->owner = owner;
+            return *victim;
+        }
+
+        static void Flush(Pending& pending) {
+            if (pending.head != nullptr) {
+                PushRemote(pending.owner, pending.head, pending.tail);
+            }
+            pending = Pending();
+        }
+
+        static void PushRemote(Cache* owner, Block* head, Block* tail) {
+            Block* old_head = owner->remote_list.load(std::memory_order_relaxed);
+            do {
+                tail->next = old_head;
+            } while (!owner->remote_list.compare_exchange_weak(old_head, head, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    };
+
+    //ڵĿ񣬳256ֽڻ߶Ҫ󳬹max_align_tĶʹslab
+    constexpr size_t SlabSizeClass(size_t size) {
+        return size <= 32 ? 32 : size <= 64 ? 64 : size <= 128 ? 128 : 256;
+    }
+
+    template <typename T>
+    constexpr bool IsSlabAllocatable() {
+        return WZQ_TASK_SLAB && sizeof(T) <= 256 && alignof(T) <= alignof(std::max_align_t);
+    }
+
+    template <typename T, typename... Args>
+    typename std::enable_if<IsSlabAllocatable<T>(), T*>::type SlabNew(Args&&... args) {
+        using Allocator = SlabAllocator<SlabSizeClass(sizeof(T))>;
+        void* ptr = Allocator::Allocate();
+        try {
+            return new (ptr) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            Allocator::Deallocate(ptr);
+            throw;
+        }
+    }
+
+    template <typename T, typename... Args>
+    typename std::enable_if<!IsSlabAllocatable<T>(), T*>::type SlabNew(Args&&... args) {
+        return new T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    typename std::enable_if<IsSlabAllocatable<T>()>::type SlabDelete(T* ptr) {
+        if (ptr != nullptr) {
+            ptr->~T();
+            SlabAllocator<SlabSizeClass(sizeof(T))>::Deallocate(ptr);
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsSlabAllocatable<T>()>::type SlabDelete(T* ptr) {
+        delete ptr;
+    }
+
+    //йͳ֮
+    inline SlabStats GetSlabStats() {
+        SlabStats stats;
+        stats.Merge(SlabAllocator<32>::GetStats());
+        stats.Merge(SlabAllocator<64>::GetStats());
+        stats.Merge(SlabAllocator<128>::GetStats());
+        stats.Merge(SlabAllocator<256>::GetStats());
+        return stats;
+    }
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef __TASK__
+#define __TASK__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "slab_allocator.h"
+
+namespace wzq {
+
+    /**
+     * ̳߳еֻͣƶܿ
+     * std::functionȣԴpackaged_taskֻƶĶ
+     * ɵö󲻳kInlineSizeֽʱֱӷڲĻҪڴ棬
+     * ʱ˻ΪڶϷ䣬256ֽڵslab(slab_allocator.h)
+     * ָ룬ops_ָsizeof(Task)һУҪ󳬹ָĿɵöҲڶϡ
+     */
+    class Task {
+    public:
+        static const size_t kInlineSize = 64 - sizeof(void*);
+
+        Task() noexcept : ops_(nullptr) {}
+
+        template <typename F, typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+        Task(F&& f) : ops_(nullptr) {
+            using Functor = typename std::decay<F>::type;
+            Construct<Functor>(std::forward<F>(f), std::integral_constant<bool, IsInline<Functor>()>());
+        }
+
+        Task(Task&& other) noexcept : ops_(other.ops_) {
+            if (ops_ != nullptr) {
+                ops_->move(&storage_, &other.storage_);
+                other.ops_ = nullptr;
+            }
+        }
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                Reset();
+                ops_ = other.ops_;
+                if (ops_ != nullptr) {
+                    ops_->move(&storage_, &other.storage_);
+                    other.ops_ = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() { Reset(); }
+
+        void operator()() { ops_->invoke(&storage_); }
+
+        explicit operator bool() const { return ops_ != nullptr; }
+
+        //жĳɵöTaskʱǷҪڴ
+        template <typename F>
+        static constexpr bool IsInline() {
+            return sizeof(F) <= kInlineSize && alignof(F) <= alignof(Storage) &&
+                std::is_nothrow_move_constructible<F>::value;
+        }
+
+    private:
+        using Storage = typename std::aligned_storage<kInlineSize, alignof(void*)>::type;
+
+        struct Ops {
+            void (*invoke)(void* storage);
+            void (*move)(void* dst, void* src);
+            void (*destroy)(void* storage);
+        };
+
+        //ɵöֱӹڻ
+        template <typename F>
+        struct InlineOps {
+            static void Invoke(void* storage) { (*static_cast<F*>(storage))(); }
+            static void Move(void* dst, void* src) {
+                new (dst) F(std::move(*static_cast<F*>(src)));
+                static_cast<F*>(src)->~F();
+            }
+            static void Destroy(void* storage) { static_cast<F*>(storage)->~F(); }
+            static const Ops* Get() {
+                static const Ops ops = { &Invoke, &Move, &Destroy };
+                return &ops;
+            }
+        };
+
+        //ŲʱֻŶ϶ָ
+        template <typename F>
+        struct HeapOps {
+            static F*& Ptr(void* storage) { return *static_cast<F**>(storage); }
+            static void Invoke(void* storage) { (*Ptr(storage))(); }
+            static void Move(void* dst, void* src) { new (dst) F*(Ptr(src)); }
+            static void Destroy(void* storage) { SlabDelete(Ptr(storage)); }
+            static const Ops* Get() {
+                static const Ops ops = { &Invoke, &Move, &Destroy };
+                return &ops;
+            }
+        };
+
+        template <typename Functor, typename F>
+        void Construct(F&& f, std::true_type) {
+            new (&storage_) Functor(std::forward<F>(f));
+            ops_ = InlineOps<Functor>::Get();
+        }
+
+        template <typename Functor, typename F>
+        void Construct(F&& f, std::false_type) {
+            new (&storage_) Functor*(SlabNew<Functor>(std::forward<F>(f)));
+            ops_ = HeapOps<Functor>::Get();
+        }
+
+        void Reset() {
+            if (ops_ != nullptr) {
+                ops_->destroy(&storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        Storage storage_;
+        const Ops* ops_;
+    };
+
+    static_assert(sizeof(Task) == 64, "Task should occupy exactly one cache line");
+
+}  // namespace wzq
+
+#endif
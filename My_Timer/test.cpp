@@ -1,3 +1,5 @@
+#include <iostream>
+
 #include "timer.h"
 
 using namespace wzq;
@@ -1,29 +1,101 @@
 #ifndef __THREAD_POOL__
 #define __THREAD_POOL__
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <condition_variable>
+#include <exception>
 #include <functional>
 #include <future>
-#include <iostream>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
-using std::cout;
-using std::endl;
+#include "bounded_queue.h"
+#include "cancellation.h"
+#include "coroutine.h"
+#include "cpu_topology.h"
+#include "event_count.h"
+#include "latency_histogram.h"
+#include "slab_allocator.h"
+#include "task.h"
+#include "trace.h"
+#include "work_steal_queue.h"
 
 namespace wzq {
 
     class ThreadPool {
     public:
         using PoolSeconds = std::chrono::seconds;
+        using PoolMilliseconds = std::chrono::milliseconds;
+
+        /**
+         * ĵģʽ
+         * kGlobalQueue: ̹߳һȫУtask_mutex_
+         * kWorkStealing: ÿ߳ԼضУ߳ڲύ뱾ضУⲿύȫעУ
+         * ̻߳ȥ̵߳ıضȡ
+         */
+        enum class ScheduleMode { kGlobalQueue = 0, kWorkStealing = 1 };
+
+        /**
+         * ʱRunĴ
+         * kBlock: ύֱ̣߳пλ̳߳е߳ύʱΪԼִУ̻߳ȴ
+         * kReject: ܾRunnullptr
+         * kCallerRuns: ύֱִ߳
+         * kDiscardOldest: 񣬱futureõbroken_promise쳣
+         * ҪͨûпԶ(ͨ߱ضռ)ʱΪύִ߳
+         */
+        enum class OverflowPolicy { kBlock = 0, kReject = 1, kCallerRuns = 2, kDiscardOldest = 3 };
+
+        /**
+         * ȼӦ̳߳õͨ(idΪ012ȨΪ1641)Run/Submit/PostkNormalͨ
+         */
+        enum class TaskPriority { kHigh = 0, kNormal = 1, kLow = 2 };
+
+        /**
+         * ֮ͨĵȲ
+         * kStrictPriority: ȡȨķǿͨе
+         * kWeightedFair: ȨصıӸͨȡ
+         * ֲ£ǿյͨstarvation_timeûбȡʱᱻȴȼ
+         */
+        enum class LanePolicy { kStrictPriority = 0, kWeightedFair = 1 };
+
+        /**
+         * ̵߳CPU󶨷ʽֻLinuxЧƽ̨̲߳
+         * kNone: 󶨣ɲϵͳ
+         * kCpuList: ḭ߳󶨵cpu_list[i % cpu_list.size()]һCPU
+         * kSpread: ߳󶨵NUMAڵϣڽڵڵCPU
+         * kCompact: ̶߳󶨵numa_nodeһڵ
+         */
+        enum class AffinityMode { kNone = 0, kCpuList = 1, kSpread = 2, kCompact = 3 };
+
+        /**
+         * ߳ûִʱĵȴʽ
+         * kBlock: ֱtask_cv_ϵȴ
+         * kSpinThenPark: pauseָspin_countΣóCPU yield_countΣȻû¼(Linuxfutex)˯ߣ
+         * ύʱֻҪ̸ܼ߳ʱ̻߳˯ߣʡ˻ѺлĿǿʱռһCPU
+         * ͬʱ̲߳CPUһ룬ֻһCPUʱֱ˯
+         */
+        enum class IdlePolicy { kBlock = 0, kSpinThenPark = 1 };
+
+        /**
+         * ̸߳ʽ߳[core_threads, max_threads]֮
+         * kOnDemand: ύʱûп߳̾ʹһCachẹ߳Cache߳̿гtime_out˳
+         * kAutoScale: ɺ̨߳ÿscale_intervalһŶʱ߳ʣ
+         * ŶӲʱŶʱp99ﵽscale_up_wait(һûܿʼִ)ʱݣ߳
+         * scale_down_samplesβʶscale_down_utilization%ʱһöĿCache߳˳
+         * ݺݵ֮м֮߳ض
+         */
+        enum class ScalePolicy { kOnDemand = 0, kAutoScale = 1 };
 
         /** ̳߳ص
          * core_threads: ̸̳߳߳ӵе̸߳ʼͻᴴọ̃߳פ̳߳
@@ -31,16 +103,139 @@ namespace wzq {
          * max_threads: >=core_threadsĸִ̫̳߳вʱ
          * ڲͻᴴִ߳иڲ߳ᳬmax_threads
          *
-         * max_task_size: ڲ洢ʱûʹ
+         * max_task_size: ڲ洢0ʱʹнд洢<=0ʾƣ̳߳޸ģ
+         * ̳߳صޣͨNUMAڵк͹ȡıضŶӵ
          *
          * time_out: Cache̵߳ĳʱʱ䣬Cacheָ߳max_threads-core_threads߳,
          * time_outʱûִ񣬴߳̾ͻᱻԶ
+         *
+         * schedule_mode: ģʽĬʹȫֶУ̳߳޸
+         *
+         * overflow_policy: ﵽmax_task_sizeʱRunĴԣĬȴ
+         *
+         * lane_policy: ֮ͨĵȲԣĬϸȼ
+         *
+         * starvation_time: ͨеȴʱȴ<=0ʾ
+         *
+         * affinity/cpu_list/numa_node: ̵߳CPU󶨷ʽԼkCpuListʹõCPUбkCompactʹõĽڵ㣬ֻӰ֮󴴽߳
+         *
+         * idle_policy/spin_count/yield_count: ߳̿ʱĵȴʽԼóCPUĴidle_policy̳߳޸
+         *
+         * scale_policy/scale_interval/scale_up_wait/scale_down_utilization/scale_down_samples: ̸߳ʽԶĲ
+         * scale_policy̳߳޸
          */
         struct ThreadPoolConfig {
             int core_threads;
             int max_threads;
             int max_task_size;
             PoolSeconds time_out;
+            ScheduleMode schedule_mode = ScheduleMode::kGlobalQueue;
+            OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+            LanePolicy lane_policy = LanePolicy::kStrictPriority;
+            PoolMilliseconds starvation_time = PoolMilliseconds(100);
+            AffinityMode affinity = AffinityMode::kNone;
+            std::vector<int> cpu_list{};
+            int numa_node = 0;
+            IdlePolicy idle_policy = IdlePolicy::kBlock;
+            int spin_count = 1000;
+            int yield_count = 10;
+            ScalePolicy scale_policy = ScalePolicy::kOnDemand;
+            PoolMilliseconds scale_interval = PoolMilliseconds(10);
+            PoolMilliseconds scale_up_wait = PoolMilliseconds(2);
+            int scale_down_utilization = 50;
+            int scale_down_samples = 20;
+        };
+
+        /**
+         * ͨͳϢ
+         * depth: ǰŶӵ
+         * popped_num: Ѿȡִе
+         * avg_wait_us/p99_wait_us/max_wait_us: ӷͨȡĵȴʱ(΢)p99ɶֱͼ㣬1/16
+         */
+        struct LaneStats {
+            std::string name;
+            int weight;
+            size_t depth;
+            uint64_t popped_num;
+            uint64_t avg_wait_us;
+            uint64_t p99_wait_us;
+            uint64_t max_wait_us;
+        };
+
+        /**
+         * ShutDown/ShutDownNowĽ
+         * completed_num: ӿʼرյڼִ
+         * dropped_num: ӿʼرյڼûִоͱȡֹ߳ʱЩfutureõbroken_promise쳣
+         * is_finished: ʱ߳ǷѾ˳գtimeoutʱΪfalseʱʣᱻ
+         * ִеִ꣬߳л
+         */
+        struct ShutDownStats {
+            uint64_t completed_num;
+            uint64_t dropped_num;
+            bool is_finished;
+        };
+
+        /**
+         * ̵߳ͳϢ
+         * executed_num: ִй
+         * busy_ns/idle_ns: ִ߳ʱûִʱ()idle_ns/(busy_ns+idle_ns)̵߳Ŀ
+         * steal_num: ̵߳ıض͵
+         * wakeup_num: ߳̽ȴ󱻻ѵĴ
+         * local_depth: ضŶӵֻйȡģʽ²ŲΪ0
+         */
+        struct WorkerStats {
+            int id;
+            bool is_core;
+            int numa_node;
+            uint64_t executed_num;
+            uint64_t busy_ns;
+            uint64_t idle_ns;
+            uint64_t steal_num;
+            uint64_t wakeup_num;
+            size_t local_depth;
+        };
+
+        /**
+         * ̳߳صͳƿգǷֱȡģ˴֮䲻֤ϸһ
+         * queue_depth: ͨNUMAڵкͱضŶӵ
+         * submitted_num/executed_num/rejected_num: ύɹѾִԼܾ
+         * skipped_num: ʱѾȡֹ߳ʱ䣬ûִоͱ
+         * blocking_threads: ScopedBlocking̸߳compensated_num: Ϊ̵̲߳߳Ĵ
+         * slab: ڵͷŲTaskĿɵöõslabͳƣ̵̳߳عãslab_allocator.h
+         * queue_latency: ӷеʼִеʱ()run_time: ִʱ()
+         * ֻͳ̳߳еִ߳еkCallerRunsʱύִ߳еֻexecuted_num
+         * busy_ns: ִ߳ʱ()
+         * executed_num/busy_ns/steal_num/wakeup_num/queue_latency/run_timeѾ˳ֻ̣߳
+         */
+        struct PoolStats {
+            int total_threads;
+            int waiting_threads;
+            int blocking_threads;
+            size_t queue_depth;
+            uint64_t submitted_num;
+            uint64_t executed_num;
+            uint64_t rejected_num;
+            uint64_t skipped_num;
+            uint64_t compensated_num;
+            uint64_t busy_ns;
+            uint64_t steal_num;
+            uint64_t wakeup_num;
+            HistogramSnapshot queue_latency;
+            HistogramSnapshot run_time;
+            std::vector<WorkerStats> workers;
+            std::vector<LaneStats> lanes;
+            SlabStats slab;
+        };
+
+        /**
+         * RunWith/SubmitWith/PostWithύʱѡ
+         * token: ʱtokenѾȡֱӶᱻãִڼCancellationToken::Current()ѯ
+         * deadline: ʱѾֹʱҲֱӶĬûнֹʱ
+         * GetSkippedFuncNum()RunWith/SubmitWithõfutureյbroken_promise쳣
+         */
+        struct TaskOptions {
+            CancellationToken token;
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
         };
 
         /**
@@ -58,31 +253,120 @@ namespace wzq {
         using ThreadStateAtomic = std::atomic<ThreadState>;
         using ThreadFlagAtomic = std::atomic<ThreadFlag>;
 
+        /**
+         * ڶŶӵ񣬼¼ʱ()ͳŶʱ
+         * TaskOptionsύ񻹼¼ֹʱ(룬0ʾû)ȡtokenʱ
+         */
+        struct QueuedTask {
+            Task task;
+            int64_t enqueue_ns;
+            int64_t deadline_ns;
+            CancellationToken token;
+
+            QueuedTask() : enqueue_ns(0), deadline_ns(0) {}
+            QueuedTask(Task&& t, int64_t ns, const TaskOptions* options = nullptr) : task(std::move(t)), enqueue_ns(ns), deadline_ns(0) {
+                if (options != nullptr) {
+                    token = options->token;
+                    if (options->deadline != std::chrono::steady_clock::time_point::max()) {
+                        deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options->deadline.time_since_epoch()).count();
+                    }
+                }
+            }
+        };
+
+        /**
+         * ߳Լ¼ͳݣֻ̻߳дGetStatsʱֻ߳ԼҪԭӵĶд
+         * ǰһУ߳Ƶдͬһ
+         */
+        struct WorkerCounters {
+            static const size_t kCacheLineSize = 64;
+
+            char pad0[kCacheLineSize];
+            std::atomic<uint64_t> executed_num;
+            std::atomic<uint64_t> busy_ns;
+            std::atomic<uint64_t> steal_num;
+            std::atomic<uint64_t> wakeup_num;
+            std::atomic<int64_t> start_ns;
+            LatencyHistogram queue_latency;
+            LatencyHistogram run_time;
+            char pad1[kCacheLineSize];
+
+            WorkerCounters() : executed_num(0), busy_ns(0), steal_num(0), wakeup_num(0), start_ns(0) {}
+
+            void OnRun(int64_t wait_ns, int64_t run_ns) {
+                Add(executed_num, 1);
+                Add(busy_ns, static_cast<uint64_t>(run_ns));
+                queue_latency.RecordLocal(static_cast<uint64_t>(std::max<int64_t>(wait_ns, 0)));
+                run_time.RecordLocal(static_cast<uint64_t>(run_ns));
+            }
+
+            static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+                counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+        };
+
         /**
          * ̴̳߳߳ڵĻλÿ̶߳иԶID߳ʶ״̬
+         * local_tasksǹȡģʽ߳ԼУֻбֻ̻߳߳ȡ
          */
         struct ThreadWrapper {
             ThreadPtr ptr;
             ThreadId id;
             ThreadFlagAtomic flag;
             ThreadStateAtomic state;
+            std::unique_ptr<WorkStealQueue<QueuedTask*>> local_tasks;
+            unsigned int steal_index;
+            int numa_node;
+            std::atomic<bool> is_retiring;  //ResizeҪ߳˳߳´οʱ˳
+            int blocking_depth;  //ScopedBlockingǶײֻб̶߳д
+            WorkerCounters counters;
 
             ThreadWrapper() {
                 ptr = nullptr;
                 id = 0;
                 state.store(ThreadState::kInit);
+                steal_index = 0;
+                numa_node = -1;
+                is_retiring.store(false);
+                blocking_depth = 0;
+            }
+
+            //ShutDownNow󱾵ضпܻûִе
+            ~ThreadWrapper() {
+                QueuedTask* task = nullptr;
+                while (local_tasks != nullptr && local_tasks->Pop(task)) {
+                    SlabDelete(task);
+                }
             }
         };
         using ThreadWrapperPtr = std::shared_ptr<ThreadWrapper>;
         using ThreadPoolLock = std::unique_lock<std::mutex>;
 
-        ThreadPool(ThreadPoolConfig config) : config_(config) {
+        ThreadPool(ThreadPoolConfig config) : config_(config), node_lanes_(CpuTopology::Get().NodeNum()) {
             this->total_function_num_.store(0);
             this->waiting_thread_num_.store(0);
+            this->spinning_thread_num_.store(0);
+            this->blocked_producer_num_.store(0);
+            this->queued_task_num_.store(0);
+            this->rejected_function_num_.store(0);
+            this->caller_executed_num_.store(0);
+            this->skipped_function_num_.store(0);
+            this->blocking_thread_num_.store(0);
+            this->surplus_thread_num_.store(0);
+            this->compensating_thread_num_.store(0);
+            this->compensated_num_.store(0);
+            this->dropped_function_num_.store(0);
 
             this->thread_id_.store(0);
             this->is_shutdown_.store(false);
             this->is_shutdown_now_.store(false);
+            this->fair_cursor_.store(0);
+            CreateLane("high", 16);
+            CreateLane("normal", 4);
+            CreateLane("low", 1);
+            for (auto& lane : this->node_lanes_) {
+                lane.store(nullptr);
+            }
 
             if (IsValidConfig(config_)) {
                 is_available_.store(true);
@@ -92,9 +376,12 @@ namespace wzq {
             }
         }
 
-        ~ThreadPool() { 
+        // ʱȴеִ꣬߳˳join֮ŷ
+        ~ThreadPool() {
             ShutDown();
-            std::this_thread::sleep_for(std::chrono::seconds(10));
+            for (auto& lane : this->node_lanes_) {
+                delete lane.load();
+            }
         }
 
         bool Reset(ThreadPoolConfig config) {
@@ -104,6 +391,10 @@ namespace wzq {
             if (config_.core_threads != config.core_threads) {
                 return false;
             }
+            if (config_.schedule_mode != config.schedule_mode || config_.max_task_size != config.max_task_size ||
+                config_.idle_policy != config.idle_policy || config_.scale_policy != config.scale_policy) {
+                return false;
+            }
             config_ = config;
             return true;
         }
@@ -114,194 +405,1630 @@ namespace wzq {
                 return false;
             }
             int core_thread_num = config_.core_threads;
-            cout << "Init thread num " << core_thread_num << endl;
+            WZQ_TRACE_INFO("init thread num", core_thread_num);
             while (core_thread_num-- > 0) {
                 AddThread(GetNextThreadId());
             }
-            cout << "Init thread end" << endl;
+            if (config_.scale_policy == ScalePolicy::kAutoScale) {
+                this->scaler_thread_ = std::thread([this]() { this->ScaleLoop(); });
+            }
+            WZQ_TRACE_INFO("init thread end");
             return true;
         }
 
         // ȡڴڵȴ״̵̬߳ĸ
         int GetWaitingThreadSize() { return this->waiting_thread_num_.load(); }
 
+        //ScopedBlocking̸߳
+        int GetBlockingThreadSize() { return this->blocking_thread_num_.load(); }
+
         // ȡ̳߳еǰ̵ܸ߳
-        int GetTotalThreadSize() { return this->worker_threads_.size(); }
+        int GetTotalThreadSize() {
+            ThreadPoolLock lock(this->worker_mutex_);
+            return this->worker_threads_.size();
+        }
 
         // ִ̳߳к
         template <typename F, typename... Args>
         auto Run(F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
-            if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
+            using return_type = std::result_of_t<F(Args...)>;
+            std::future<return_type> res = Submit(std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
                 return nullptr;
             }
-            if (GetWaitingThreadSize() == 0 && GetTotalThreadSize() < config_.max_threads) {
-                AddThread(GetNextThreadId(), ThreadFlag::kCache);
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
+
+        // Runһֱӷstd::future̳߳زû񱻾ܾʱصfutureЧ(valid()==false)
+        // packaged_taskֱӷŽTaskڲύֻpackaged_task״̬һڴ
+        template <typename F, typename... Args>
+        auto Submit(F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            return SubmitOnLane(kNormalLane, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        // ִֻвĽ񣬲futureɵö󲻳Task::kInlineSizeֽʱύ̲ڴ
+        // ׳쳣ûеطգPost׳쳣
+        template <typename F, typename... Args>
+        bool Post(F&& f, Args &&... args) {
+            return PostOnLane(kNormalLane, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        // Run/Submit/Postһֻoptionsеȡtokenͽֹʱ䣬
+        // ʱѾȡֹ߳ʱ񲻻ᱻãTaskOptions
+        template <typename F, typename... Args>
+        auto RunWith(const TaskOptions& options, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
+            using return_type = std::result_of_t<F(Args...)>;
+            std::future<return_type> res = SubmitWith(options, std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
+                return nullptr;
+            }
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
+
+        template <typename F, typename... Args>
+        auto SubmitWith(const TaskOptions& options, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            return SubmitToLane(*this->lanes_[kNormalLane], &options, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        bool PostWith(const TaskOptions& options, F&& f, Args &&... args) {
+            return PostToLane(*this->lanes_[kNormalLane], &options, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+#if WZQ_COROUTINE
+        // Эco_await pool.Schedule()ѵǰЭ̹𣬷ŵ̳߳ص߳мִ
+        // ָЭ̵ֻЭֱ̾ӷTaskĻڴ棻̳߳زû񱻾ܾʱڵǰִ̼߳
+        // ֱ֮ShutDownNowkDiscardOldest߳˳ʱʱڶ߳лָЭ̣Э֡й©SyncWaitҲһֱȥ
+        struct ScheduleAwaiter {
+            ThreadPool* pool;
+
+            bool await_ready() const noexcept { return false; }
+
+            // ָЭ̵ֻƶûִоͱʱڵǰָ̻߳Э
+            struct ResumeTask {
+                std::coroutine_handle<> handle;
+
+                explicit ResumeTask(std::coroutine_handle<> h) noexcept : handle(h) {}
+                ResumeTask(ResumeTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+                ResumeTask(const ResumeTask&) = delete;
+                ResumeTask& operator=(const ResumeTask&) = delete;
+                ResumeTask& operator=(ResumeTask&&) = delete;
+
+                // Postûؾύ߳ﱻܾͬawait_suspendfalseִУﲻٻָһ
+                ~ResumeTask() {
+                    if (handle && PostingHandle() != handle.address()) {
+                        handle.resume();
+                    }
+                }
+
+                void operator()() { std::exchange(handle, nullptr).resume(); }
+            };
+
+            // ǰ߳PostЭ̾
+            static void*& PostingHandle() {
+                static thread_local void* posting_handle = nullptr;
+                return posting_handle;
+            }
+
+            // Postɹ֮Э̿Ѿ߳лִָУٷЭ֡κζawaiterԼ
+            bool await_suspend(std::coroutine_handle<> handle) {
+                void*& posting_handle = PostingHandle();
+                void* saved_handle = posting_handle;
+                posting_handle = handle.address();
+                bool is_posted = pool->Post(ResumeTask(handle));
+                posting_handle = saved_handle;
+                return is_posted;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        ScheduleAwaiter Schedule() { return ScheduleAwaiter{this}; }
+#endif
+
+        // һԶͨͨidweight(1~100)ԽԽȣϸȼʱͬȨصͨ˳
+        // ͨҪStart֮ǰӣͬͨѾڡȨزϷ̳߳Ѿ߳ʱ-1
+        int AddLane(const std::string& name, int weight) {
+            if (weight < 1 || weight > kMaxLaneWeight || GetLaneId(name) >= 0 || GetTotalThreadSize() > 0) {
+                return -1;
+            }
+            return CreateLane(name, weight);
+        }
+
+        // ֲͨidʱ-1
+        int GetLaneId(const std::string& name) {
+            for (size_t i = 0; i < this->lanes_.size(); ++i) {
+                if (this->lanes_[i]->name == name) {
+                    return static_cast<int>(i);
+                }
             }
+            return -1;
+        }
 
+        // 麯Run/Submit/Postһֻǰָͨͨidʱύʧܴ
+        template <typename F, typename... Args>
+        auto RunOnLane(int lane_id, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
             using return_type = std::result_of_t<F(Args...)>;
-            auto task = std::make_shared<std::packaged_task<return_type()>>(
-                std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-            total_function_num_++;
+            std::future<return_type> res = SubmitOnLane(lane_id, std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
+                return nullptr;
+            }
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
 
-            std::future<return_type> res = task->get_future();
-            {
-                ThreadPoolLock lock(this->task_mutex_);
-                this->tasks_.emplace([task]() { (*task)(); });
+        template <typename F, typename... Args>
+        auto RunOnLane(TaskPriority priority, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
+            return RunOnLane(static_cast<int>(priority), std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        auto SubmitOnLane(int lane_id, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            if (!IsValidLane(lane_id)) {
+                return std::future<std::result_of_t<F(Args...)>>();
             }
-            this->task_cv_.notify_one();
-            return std::make_shared<std::future<std::result_of_t<F(Args...)>>>(std::move(res));
+            return SubmitToLane(*this->lanes_[lane_id], nullptr, std::forward<F>(f), std::forward<Args>(args)...);
         }
 
-        // ȡǰ̳߳Ѿִйĺ
-        int GetRunnedFuncNum() { return total_function_num_.load(); }
+        template <typename F, typename... Args>
+        auto SubmitOnLane(TaskPriority priority, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            return SubmitOnLane(static_cast<int>(priority), std::forward<F>(f), std::forward<Args>(args)...);
+        }
 
-        // ص̳߳أڲûִеִ
-        void ShutDown() {
-            ShutDown(false);
-            cout << "shutdown" << endl;
+        template <typename F, typename... Args>
+        bool PostOnLane(int lane_id, F&& f, Args &&... args) {
+            if (!IsValidLane(lane_id)) {
+                return false;
+            }
+            return PostToLane(*this->lanes_[lane_id], nullptr, std::forward<F>(f), std::forward<Args>(args)...);
         }
 
-        // ִйص̳߳أڲûִеֱȡִ
-        void ShutDownNow() {
-            ShutDown(true);
-            cout << "shutdown now" << endl;
+        template <typename F, typename... Args>
+        bool PostOnLane(TaskPriority priority, F&& f, Args &&... args) {
+            return PostOnLane(static_cast<int>(priority), std::forward<F>(f), std::forward<Args>(args)...);
         }
 
-        // ǰ̳߳Ƿ
-        bool IsAvailable() { return is_available_.load(); }
+        // ȡNUMAڵĸRunOnNodeȺnodeΧ[0, GetNumaNodeNum())NUMAܹĻֻһڵ
+        int GetNumaNodeNum() { return static_cast<int>(this->node_lanes_.size()); }
 
-    private:
-        void ShutDown(bool is_now) {
-            if (is_available_.load()) {
-                if (is_now) {
-                    this->is_shutdown_now_.store(true);
-                }
-                else {
-                    this->is_shutdown_.store(true);
-                }
-                this->task_cv_.notify_all();
-                is_available_.store(false);
+        // ָNUMAڵУڵϵִ̻߳бڵе
+        // ߳ûбʱҲæִУԽڵû߳ʱҲһֱòִУڵ㲻ʱύʧܴ
+        template <typename F, typename... Args>
+        auto RunOnNode(int node, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
+            using return_type = std::result_of_t<F(Args...)>;
+            std::future<return_type> res = SubmitOnNode(node, std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
+                return nullptr;
             }
+            return std::make_shared<std::future<return_type>>(std::move(res));
         }
 
-        void AddThread(int id) { AddThread(id, ThreadFlag::kCore); }
+        template <typename F, typename... Args>
+        auto SubmitOnNode(int node, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            if (node < 0 || node >= GetNumaNodeNum()) {
+                return std::future<std::result_of_t<F(Args...)>>();
+            }
+            return SubmitToLane(NodeLane(node), nullptr, std::forward<F>(f), std::forward<Args>(args)...);
+        }
 
-        void AddThread(int id, ThreadFlag thread_flag) {
-            cout << "AddThread " << id << " flag " << static_cast<int>(thread_flag) << endl;
-            ThreadWrapperPtr thread_ptr = std::make_shared<ThreadWrapper>();
-            thread_ptr->id.store(id);
-            thread_ptr->flag.store(thread_flag);
-            auto func = [this, thread_ptr]() {
-                for (;;) {
-                    std::function<void()> task;
-                    {
-                        ThreadPoolLock lock(this->task_mutex_);
-                        if (thread_ptr->state.load() == ThreadState::kStop) {
-                            break;
-                        }
-                        cout << "thread id " << thread_ptr->id.load() << " running start" << endl;
-                        thread_ptr->state.store(ThreadState::kWaiting);
-                        ++this->waiting_thread_num_;
-                        bool is_timeout = false;
-                        if (thread_ptr->flag.load() == ThreadFlag::kCore) {
-                            this->task_cv_.wait(lock, [this, thread_ptr] {
-                                return (this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                    thread_ptr->state.load() == ThreadState::kStop);
-                                });
-                        }
-                        else {
-                            this->task_cv_.wait_for(lock, this->config_.time_out, [this, thread_ptr] {
-                                return (this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                    thread_ptr->state.load() == ThreadState::kStop);
-                                });
-                            is_timeout = !(this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                thread_ptr->state.load() == ThreadState::kStop);
-                        }
-                        --this->waiting_thread_num_;
-                        cout << "thread id " << thread_ptr->id.load() << " running wait end" << endl;
+        template <typename F, typename... Args>
+        bool PostOnNode(int node, F&& f, Args &&... args) {
+            if (node < 0 || node >= GetNumaNodeNum()) {
+                return false;
+            }
+            return PostToLane(NodeLane(node), nullptr, std::forward<F>(f), std::forward<Args>(args)...);
+        }
 
-                        if (is_timeout) {
-                            thread_ptr->state.store(ThreadState::kStop);
-                        }
 
-                        if (thread_ptr->state.load() == ThreadState::kStop) {
-                            cout << "thread id " << thread_ptr->id.load() << " state stop" << endl;
-                            break;
-                        }
-                        if (this->is_shutdown_ && this->tasks_.empty()) {
-                            cout << "thread id " << thread_ptr->id.load() << " shutdown" << endl;
-                            break;
-                        }
-                        if (this->is_shutdown_now_) {
-                            cout << "thread id " << thread_ptr->id.load() << " shutdown now" << endl;
-                            break;
-                        }
-                        thread_ptr->state.store(ThreadState::kRunning);
-                        task = std::move(this->tasks_.front());
-                        this->tasks_.pop();
-                    }
-                    task();
-                }
-                cout << "thread id " << thread_ptr->id.load() << " running end" << endl;
-            };
-            thread_ptr->ptr = std::make_shared<std::thread>(std::move(func));
-            if (thread_ptr->ptr->joinable()) {
-                thread_ptr->ptr->detach();
+        // ύ[first, last)еĿɵöȫֶֻһѵ߳
+        // һfutureִ׳쳣ܾ߱ʱfutureбһ쳣
+        template <typename Iter>
+        std::future<void> RunBatch(Iter first, Iter last) {
+            using Func = typename std::decay<decltype(*first)>::type;
+            if (!BeforeSubmit()) {
+                return std::future<void>();
             }
-            this->worker_threads_.emplace_back(std::move(thread_ptr));
+            auto state = std::make_shared<BatchState>(std::distance(first, last));
+            std::future<void> res = state->promise.get_future();
+            std::vector<Task> tasks;
+            tasks.reserve(state->remaining.load());
+            for (; first != last; ++first) {
+                BatchItem item(state);
+                Func func = *first;
+                tasks.emplace_back([item = std::move(item), func]() mutable { item.Run(func); });
+            }
+            PushTasks(tasks);
+            return res;
         }
 
-        void Resize(int thread_num) {
-            if (thread_num < config_.core_threads) return;
-            int old_thread_num = worker_threads_.size();
-            cout << "old num " << old_thread_num << " resize " << thread_num << endl;
-            if (thread_num > old_thread_num) {
-                while (thread_num-- > old_thread_num) {
-                    AddThread(GetNextThreadId());
-                }
+        // ύn񣬵iִf(i)fֻһݣ
+        template <typename F>
+        std::future<void> RunBulk(size_t n, F&& f) {
+            using Func = typename std::decay<F>::type;
+            if (!BeforeSubmit()) {
+                return std::future<void>();
             }
-            else {
-                int diff = old_thread_num - thread_num;
-                auto iter = worker_threads_.begin();
-                while (iter != worker_threads_.end()) {
-                    if (diff == 0) {
-                        break;
-                    }
-                    auto thread_ptr = *iter;
-                    if (thread_ptr->flag.load() == ThreadFlag::kCache &&
-                        thread_ptr->state.load() == ThreadState::kWaiting) {  // wait
-                        thread_ptr->state.store(ThreadState::kStop);          // stop;
-                        --diff;
-                        iter = worker_threads_.erase(iter);
-                    }
-                    else {
-                        ++iter;
-                    }
-                }
-                this->task_cv_.notify_all();
+            auto state = std::make_shared<BatchState>(n);
+            std::future<void> res = state->promise.get_future();
+            auto func = std::make_shared<Func>(std::forward<F>(f));
+            std::vector<Task> tasks;
+            tasks.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                BatchItem item(state);
+                tasks.emplace_back([item = std::move(item), func, i]() mutable { item.Run([&func, i]() { (*func)(i); }); });
             }
+            PushTasks(tasks);
+            return res;
         }
 
-        int GetNextThreadId() { return this->thread_id_++; }
+        // ȡǰ̳߳ѾִйĺŶӺִе
+        int GetRunnedFuncNum() { return static_cast<int>(GetExecutedNum()); }
 
-        bool IsValidConfig(ThreadPoolConfig config) {
-            if (config.core_threads < 1 || config.max_threads < config.core_threads || config.time_out.count() < 1) {
+        // ȡΪܾ
+        int GetRejectedFuncNum() { return rejected_function_num_.load(); }
+
+        // ȡʱѾȡֹ߳ʱ䣬ûִоͱ
+        uint64_t GetSkippedFuncNum() { return skipped_function_num_.load(); }
+
+        // ȡÿͨŶӸ͵ȴʱ䣬±ͨid
+        std::vector<LaneStats> GetLaneStats() {
+            std::vector<LaneStats> stats;
+            for (auto& lane : this->lanes_) {
+                LaneStats s;
+                s.name = lane->name;
+                s.weight = lane->weight;
+                s.depth = static_cast<size_t>(std::max<int64_t>(lane->depth.load(), 0));
+                HistogramSnapshot wait_ns = lane->wait_ns.Snapshot();
+                s.popped_num = wait_ns.Count();
+                s.avg_wait_us = wait_ns.Mean() / 1000;
+                s.p99_wait_us = wait_ns.Percentile(0.99) / 1000;
+                s.max_wait_us = wait_ns.Max() / 1000;
+                stats.push_back(std::move(s));
+            }
+            return stats;
+        }
+
+        // ȡ̳߳صͳƿգŶӸŶʱִʱķֲÿ̵߳æʱ䣬ж߳Ƿ
+        // ֻ߳Լļϼ¼worker_mutex_߳бٺϲӰִ
+        PoolStats GetStats() {
+            PoolStats stats;
+            stats.waiting_threads = GetWaitingThreadSize();
+            stats.submitted_num = static_cast<uint64_t>(this->total_function_num_.load());
+            stats.rejected_num = static_cast<uint64_t>(this->rejected_function_num_.load());
+            stats.skipped_num = this->skipped_function_num_.load();
+            stats.blocking_threads = GetBlockingThreadSize();
+            stats.compensated_num = this->compensated_num_.load();
+            stats.slab = GetSlabStats();
+            stats.lanes = GetLaneStats();
+            stats.queue_depth = 0;
+            for (auto& lane : stats.lanes) {
+                stats.queue_depth += lane.depth;
+            }
+            for (auto& node_lane : this->node_lanes_) {
+                TaskLane* lane = node_lane.load();
+                if (lane != nullptr) {
+                    stats.queue_depth += static_cast<size_t>(std::max<int64_t>(lane->depth.load(), 0));
+                }
+            }
+            int64_t now_ns = NowNanos();
+            ThreadPoolLock lock(this->worker_mutex_);
+            stats.total_threads = static_cast<int>(this->worker_threads_.size());
+            stats.executed_num = this->retired_stats_.executed_num + this->caller_executed_num_.load();
+            stats.busy_ns = this->retired_stats_.busy_ns;
+            stats.steal_num = this->retired_stats_.steal_num;
+            stats.wakeup_num = this->retired_stats_.wakeup_num;
+            stats.queue_latency.Merge(this->retired_stats_.queue_latency);
+            stats.run_time.Merge(this->retired_stats_.run_time);
+            for (auto& thread_ptr : this->worker_threads_) {
+                const WorkerCounters& counters = thread_ptr->counters;
+                WorkerStats w;
+                w.id = thread_ptr->id.load();
+                w.is_core = thread_ptr->flag.load() == ThreadFlag::kCore;
+                w.numa_node = thread_ptr->numa_node;
+                w.executed_num = counters.executed_num.load(std::memory_order_relaxed);
+                w.busy_ns = counters.busy_ns.load(std::memory_order_relaxed);
+                w.steal_num = counters.steal_num.load(std::memory_order_relaxed);
+                w.wakeup_num = counters.wakeup_num.load(std::memory_order_relaxed);
+                int64_t alive_ns = now_ns - counters.start_ns.load(std::memory_order_relaxed);
+                w.idle_ns = static_cast<uint64_t>(std::max<int64_t>(alive_ns - static_cast<int64_t>(w.busy_ns), 0));
+                w.local_depth = static_cast<size_t>(thread_ptr->local_tasks->Size());
+                counters.queue_latency.AddTo(stats.queue_latency);
+                counters.run_time.AddTo(stats.run_time);
+                stats.executed_num += w.executed_num;
+                stats.busy_ns += w.busy_ns;
+                stats.steal_num += w.steal_num;
+                stats.wakeup_num += w.wakeup_num;
+                stats.queue_depth += w.local_depth;
+                stats.workers.push_back(w);
+            }
+            return stats;
+        }
+
+        // ȡһڵǰִ߳Уûпִеʱfalse
+        // Ҫȴ߳̿ѭæִ񣬶ȴ
+        bool RunPendingTask() {
+            QueuedTask item;
+            ThreadWrapper* thread_ptr = GetCurrentThread();
+            bool found = TryGetTask(thread_ptr, item);
+            if (!found && !IsBounded()) {
+                ThreadPoolLock lock(this->task_mutex_);
+                found = !this->is_shutdown_now_ && PopQueuedTask(thread_ptr, item);
+            }
+            if (!found) {
                 return false;
             }
+            RunTask(thread_ptr, item);
             return true;
         }
 
+        // ص̳߳أڲûִеִ
+        // timeoutǵȴִ߳˳ʱ䣬ĬһֱȴعرڼִͶ
+        ShutDownStats ShutDown(PoolMilliseconds timeout = PoolMilliseconds::max()) {
+            ShutDownStats stats = StopThreads(false, timeout);
+            WZQ_TRACE_INFO("shutdown", stats.completed_num, stats.dropped_num, stats.is_finished);
+            return stats;
+        }
+
+        // ִйص̳߳أڲûִеֱȡִ
+        // ִеȻִ꣬timeoutǵȴִ߳˳ʱ
+        ShutDownStats ShutDownNow(PoolMilliseconds timeout = PoolMilliseconds::max()) {
+            ShutDownStats stats = StopThreads(true, timeout);
+            WZQ_TRACE_INFO("shutdown now", stats.completed_num, stats.dropped_num, stats.is_finished);
+            return stats;
+        }
+
+        /**
+         * ִлĵ(recv/sendIOsleep)ʱһ㣺
+         *     { ThreadPool::ScopedBlocking blocking; n = recv(fd, buf, len, 0); }
+         * ʱŶûп̣߳һҪ˳Ĳ̣߳½һCache߳(߳max_threads)
+         * ̶߳ϵͳʱŶӵҲִܼУ뿪ʱһCache߳´οʱ˳
+         * ̳߳ص߳дʱʲôǶףֻЧ
+         */
+        class ScopedBlocking {
+        public:
+            ScopedBlocking() : pool_(CurrentWorker().first), worker_(CurrentWorker().second), is_compensated_(false) {
+                if (worker_ != nullptr && worker_->blocking_depth++ == 0) {
+                    is_compensated_ = pool_->EnterBlocking();
+                }
+            }
+
+            ~ScopedBlocking() {
+                if (worker_ != nullptr && --worker_->blocking_depth == 0) {
+                    pool_->LeaveBlocking(is_compensated_);
+                }
+            }
+
+            ScopedBlocking(const ScopedBlocking&) = delete;
+            ScopedBlocking& operator=(const ScopedBlocking&) = delete;
+
+        private:
+            ThreadPool* pool_;
+            ThreadWrapper* worker_;
+            bool is_compensated_;
+        };
+
+        // ǰ̳߳Ƿ
+        bool IsAvailable() { return is_available_.load(); }
+
     private:
-        ThreadPoolConfig config_;
+        /**
+         * RunBatch/RunBulk״̬һɵpromise
+         */
+        static const int kNormalLane = static_cast<int>(TaskPriority::kNormal);
+        static const int kMaxLaneWeight = 100;
 
-        std::list<ThreadWrapperPtr> worker_threads_;
+        /**
+         * ͨmax_task_size>0ʱÿͨʹһΪmax_task_sizeнУʹtask_mutex_std::queue
+         * нģʽͨqueued_task_num_¼max_task_sizeͨȫ
+         * нͨһηʱŴûõͨ(ȼͨԶͨڵ)ռûζеڴ
+         * depthڷһȡһʱܶΪ
+         * last_serve_nsһδͨȡ񣬻ͨɿձΪǿյʱ䣬жͨǷ
+         * wait_ns¼ӷͨȡĵȴʱ䣬ȡ̶߳дʹÿԲ¼ֱͼ
+         */
+        struct TaskLane {
+            std::string name;
+            int weight;
+            std::queue<QueuedTask> tasks;
+            std::atomic<BoundedQueue<QueuedTask>*> bounded_tasks;  //нģʽµһηʱ֮ǰΪ
+            std::atomic<int64_t> depth;
+            std::atomic<int64_t> last_serve_ns;
+            LatencyHistogram wait_ns;
+            int capacity;
 
-        std::queue<std::function<void()>> tasks_;
-        std::mutex task_mutex_;
-        std::condition_variable task_cv_;
+            TaskLane(const std::string& lane_name, int lane_weight, int max_task_size)
+                : name(lane_name), weight(lane_weight), bounded_tasks(nullptr), depth(0), last_serve_ns(0),
+                  capacity(max_task_size) {}
+
+            ~TaskLane() { delete bounded_tasks.load(); }
+
+            //ʱʹãûдʱһ߳ͬʱʱֻһ
+            BoundedQueue<QueuedTask>& BoundedTasks() {
+                BoundedQueue<QueuedTask>* queue = bounded_tasks.load(std::memory_order_acquire);
+                if (queue == nullptr) {
+                    std::unique_ptr<BoundedQueue<QueuedTask>> created(new BoundedQueue<QueuedTask>(capacity));
+                    if (bounded_tasks.compare_exchange_strong(queue, created.get(), std::memory_order_acq_rel)) {
+                        queue = created.release();
+                    }
+                }
+                return *queue;
+            }
+
+            //ȡʱʹãûд˵ûз
+            bool TryPopBounded(QueuedTask& item) {
+                BoundedQueue<QueuedTask>* queue = bounded_tasks.load(std::memory_order_acquire);
+                return queue != nullptr && queue->TryPop(item);
+            }
+
+            bool Empty() const { return depth.load() <= 0; }
+
+            void OnPush(int64_t now_ns) {
+                if (depth.fetch_add(1) <= 0) {
+                    last_serve_ns.store(now_ns);
+                }
+            }
+
+            void OnPop(int64_t now_ns, int64_t enqueue_ns) {
+                --depth;
+                last_serve_ns.store(now_ns);
+                wait_ns.Record(static_cast<uint64_t>(std::max<int64_t>(now_ns - enqueue_ns, 0)));
+            }
+        };
 
+        /**
+         * Ѿ˳߳µͳݣworker_mutex_
+         */
+        struct RetiredStats {
+            uint64_t executed_num = 0;
+            uint64_t busy_ns = 0;
+            uint64_t steal_num = 0;
+            uint64_t wakeup_num = 0;
+            HistogramSnapshot queue_latency;
+            HistogramSnapshot run_time;
+        };
+
+        //Submitϵкʵ
+        template <typename F, typename... Args>
+        auto SubmitToLane(TaskLane& lane, const TaskOptions* options, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            using return_type = std::result_of_t<F(Args...)>;
+            if (!BeforeSubmit()) {
+                return std::future<return_type>();
+            }
+            std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+            std::future<return_type> res = task.get_future();
+            if (!PushTask(Task(std::move(task)), lane, options)) {
+                return std::future<return_type>();
+            }
+            total_function_num_++;
+            return res;
+        }
+
+        //Postϵкʵ
+        template <typename F, typename... Args>
+        bool PostToLane(TaskLane& lane, const TaskOptions* options, F&& f, Args &&... args) {
+            if (!BeforeSubmit()) {
+                return false;
+            }
+            if (!PushTask(Task(std::bind(std::forward<F>(f), std::forward<Args>(args)...)), lane, options)) {
+                return false;
+            }
+            total_function_num_++;
+            return true;
+        }
+
+        struct BatchState {
+            std::atomic<size_t> remaining;
+            std::atomic<bool> has_error;
+            std::exception_ptr error;
+            std::promise<void> promise;
+
+            explicit BatchState(size_t count) : remaining(count), has_error(false) {
+                if (count == 0) {
+                    promise.set_value();
+                }
+            }
+
+            void Finish(std::exception_ptr e) {
+                if (e && !has_error.exchange(true)) {
+                    error = e;
+                }
+                if (remaining.fetch_sub(1) == 1) {
+                    if (error) {
+                        promise.set_exception(error);
+                    }
+                    else {
+                        promise.set_value();
+                    }
+                }
+            }
+        };
+
+        /**
+         * еһ񱻾ܾ߶ûִʱʱҲɼ֤futureһ
+         */
+        struct BatchItem {
+            std::shared_ptr<BatchState> state;
+
+            explicit BatchItem(std::shared_ptr<BatchState> s) : state(std::move(s)) {}
+            BatchItem(BatchItem&&) = default;
+            BatchItem& operator=(BatchItem&&) = default;
+
+            ~BatchItem() {
+                if (state != nullptr) {
+                    state->Finish(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                }
+            }
+
+            template <typename F>
+            void Run(F&& func) {
+                std::exception_ptr e;
+                try {
+                    func();
+                }
+                catch (...) {
+                    e = std::current_exception();
+                }
+                std::shared_ptr<BatchState> s = std::move(state);
+                s->Finish(e);
+            }
+        };
+
+        //ر̳߳أùرձ־̣߳ShutDownNowʱŶӵȻȴ߳˳join
+        //timeoutûִʱΪShutDownNowķʽʣµ񣬲ٵȴִе
+        //Ѿرչ̳߳ؿٴεãShutDown(timeout)ʱٵShutDownNow()
+        ShutDownStats StopThreads(bool is_now, PoolMilliseconds timeout) {
+            ShutDownStats stats{0, 0, true};
+            if (!IsAvailable() && !this->is_shutdown_ && !this->is_shutdown_now_) {
+                return stats;
+            }
+            bool has_deadline = timeout != PoolMilliseconds::max();
+            auto deadline = std::chrono::steady_clock::now();
+            if (has_deadline) {
+                deadline += timeout;
+            }
+            uint64_t executed_num = GetExecutedNum();
+            uint64_t dropped_num = this->dropped_function_num_.load() + this->skipped_function_num_.load();
+            this->is_available_.store(false);
+            if (is_now) {
+                this->is_shutdown_now_.store(true);
+            }
+            else {
+                this->is_shutdown_.store(true);
+            }
+            WakeAllThreads();
+            if (this->scaler_thread_.joinable() && this->scaler_thread_.get_id() != std::this_thread::get_id()) {
+                this->scaler_thread_.join();
+            }
+            if (is_now) {
+                DropQueuedTasks();
+            }
+            stats.is_finished = WaitThreads(has_deadline, deadline);
+            if (!stats.is_finished && !this->is_shutdown_now_) {
+                this->is_shutdown_now_.store(true);
+                WakeAllThreads();
+                DropQueuedTasks();
+            }
+            stats.completed_num = GetExecutedNum() - executed_num;
+            stats.dropped_num = this->dropped_function_num_.load() + this->skipped_function_num_.load() - dropped_num;
+            return stats;
+        }
+
+        //еȴе̺̣߳߳¼رձ־
+        //ȼ̸֪ͨ߳ռûʼȴʱ֪ͨ
+        void WakeAllThreads() {
+            { ThreadPoolLock lock(this->task_mutex_); }
+            this->task_cv_.notify_all();
+            this->space_cv_.notify_all();
+            this->event_count_.NotifyAll();
+            { ThreadPoolLock lock(this->scaler_mutex_); }
+            this->scaler_cv_.notify_all();
+        }
+
+        void AddThread(int id) { AddThread(id, ThreadFlag::kCore); }
+
+        void AddThread(int id, ThreadFlag thread_flag) {
+            JoinExitedThreads();
+            WZQ_TRACE_INFO("add thread", id, static_cast<int>(thread_flag));
+            ThreadWrapperPtr thread_ptr = std::make_shared<ThreadWrapper>();
+            thread_ptr->id.store(id);
+            thread_ptr->flag.store(thread_flag);
+            //߳ȰCPUٴضУLinux״ηʷڴ棬ضоͻ߳ڵĽڵ
+            //ʼɺ߳Լб߳ȡʱῴûдıضУ˳ʱҲ߳ԼбƳ
+            auto ready = std::make_shared<std::promise<void>>();
+            std::future<void> ready_future = ready->get_future();
+            auto func = [this, thread_ptr, ready]() {
+                this->PlaceCurrentThread(thread_ptr.get());
+                thread_ptr->local_tasks.reset(new WorkStealQueue<QueuedTask*>());
+                thread_ptr->counters.start_ns.store(NowNanos());
+                SetCurrentWorker(thread_ptr.get());
+                {
+                    ThreadPoolLock lock(this->worker_mutex_);
+                    this->worker_threads_.push_back(thread_ptr);
+                }
+                ready->set_value();
+                bool is_surplus = false;  //ǷѾһĲ߳
+                for (;;) {
+                    QueuedTask item;
+                    //ȡضкͨȥ߳͵ûʱȥȫֶеȴ
+                    if (this->TryGetTask(thread_ptr.get(), item)) {
+                        thread_ptr->state.store(ThreadState::kRunning);
+                        this->RunTask(thread_ptr.get(), item);
+                        continue;
+                    }
+                    if (this->config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                        this->SpinWait();
+                    }
+                    {
+                        ThreadPoolLock lock(this->task_mutex_);
+                        //̱߳Ҫ˳Ĳ̣߳˳ѭ
+                        if (thread_ptr->is_retiring.load()) {
+                            break;
+                        }
+                        if (this->TakeSurplusThread(thread_ptr.get())) {
+                            is_surplus = true;
+                            break;
+                        }
+                        WZQ_TRACE_DEBUG("thread wait start", thread_ptr->id.load());
+                        thread_ptr->state.store(ThreadState::kWaiting);
+                        ++this->waiting_thread_num_;
+                        bool is_timeout = false;
+                        auto is_ready = [this, thread_ptr] {
+                            return (this->is_shutdown_ || this->is_shutdown_now_ || this->HasQueuedTask() ||
+                                thread_ptr->is_retiring.load() || this->HasSurplusThread(thread_ptr.get()) || this->HasStealableTask());
+                        };
+                        if (this->config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                            is_timeout = !this->ParkWorker(lock, thread_ptr->flag.load() == ThreadFlag::kCore, is_ready);
+                        }
+                        else if (thread_ptr->flag.load() == ThreadFlag::kCore) {
+                            this->task_cv_.wait(lock, is_ready);
+                        }
+                        else {
+                            this->task_cv_.wait_for(lock, this->config_.time_out, is_ready);
+                            is_timeout = !is_ready();
+                        }
+                        --this->waiting_thread_num_;
+                        WorkerCounters::Add(thread_ptr->counters.wakeup_num, 1);
+                        WZQ_TRACE_DEBUG("thread wait end", thread_ptr->id.load());
+
+                        is_surplus = this->TakeSurplusThread(thread_ptr.get());
+                        if (is_surplus || is_timeout || thread_ptr->is_retiring.load()) {
+                            WZQ_TRACE_INFO("thread stop", thread_ptr->id.load());
+                            break;
+                        }
+                        if (this->is_shutdown_ && !this->HasQueuedTask() && !this->HasStealableTask()) {
+                            WZQ_TRACE_DEBUG("thread shutdown", thread_ptr->id.load());
+                            break;
+                        }
+                        if (this->is_shutdown_now_) {
+                            WZQ_TRACE_DEBUG("thread shutdown now", thread_ptr->id.load());
+                            break;
+                        }
+                        //Ϊ̵߳ıض񣬻صѭͷȥȡ
+                        if (!this->PopQueuedTask(thread_ptr.get(), item)) {
+                            continue;
+                        }
+                        thread_ptr->state.store(ThreadState::kRunning);
+                    }
+                    this->RunTask(thread_ptr.get(), item);
+                }
+                //Cache߳ΪResizeʱ߹ر˳ʱҲҪֵһ߳֮󻹻бCache߳Ϊ˳һ
+                if (!is_surplus) {
+                    this->SettleSurplusThread(thread_ptr.get());
+                }
+                thread_ptr->state.store(ThreadState::kStop);
+                this->RemoveThread(thread_ptr.get());
+                WZQ_TRACE_INFO("thread exit", thread_ptr->id.load());
+            };
+            {
+                //̼߳ƳбʱҪworker_mutex_ȱ̶߳߳˳ʱܰexited_threads_ȴ
+                ThreadPoolLock lock(this->worker_mutex_);
+                thread_ptr->ptr = std::make_shared<std::thread>(std::move(func));
+            }
+            ready_future.wait();
+        }
+
+        //ȡģʽ¼¼ǰ߳ĸ̳߳صĸ̣߳жύǲǱ̳߳е߳
+        static std::pair<ThreadPool*, ThreadWrapper*>& CurrentWorker() {
+            static thread_local std::pair<ThreadPool*, ThreadWrapper*> current(nullptr, nullptr);
+            return current;
+        }
+
+        void SetCurrentWorker(ThreadWrapper* thread_ptr) { CurrentWorker() = std::make_pair(this, thread_ptr); }
+
+        ThreadWrapper* GetCurrentWorker() {
+            if (config_.schedule_mode != ScheduleMode::kWorkStealing) {
+                return nullptr;
+            }
+            return GetCurrentThread();
+        }
+
+        //͵ģʽ޹أǰ߳Ǳ̳߳е߳ʱThreadWrapper
+        ThreadWrapper* GetCurrentThread() {
+            auto& current = CurrentWorker();
+            return current.first == this ? current.second : nullptr;
+        }
+
+        //affinityð󶨵ǰ̣߳¼߳ڵNUMAڵ㣬ʧʱûа
+        void PlaceCurrentThread(ThreadWrapper* thread_ptr) {
+            const CpuTopology& topology = CpuTopology::Get();
+            int index = thread_ptr->id.load();
+            std::vector<int> cpus;
+            int node = -1;
+            switch (config_.affinity) {
+            case AffinityMode::kCpuList:
+                cpus.push_back(config_.cpu_list[index % config_.cpu_list.size()]);
+                node = topology.NodeOfCpu(cpus.front());
+                break;
+            case AffinityMode::kSpread:
+                node = index % topology.NodeNum();
+                cpus = topology.NodeCpus(node);
+                break;
+            case AffinityMode::kCompact:
+                node = config_.numa_node;
+                cpus = topology.NodeCpus(node);
+                break;
+            default:
+                break;
+            }
+            if (!cpus.empty() && !CpuTopology::BindCurrentThread(cpus)) {
+                node = -1;
+            }
+            thread_ptr->numa_node = node;
+        }
+
+        bool IsWorkerThread() { return CurrentWorker().first == this; }
+
+        //ύǰļ飺̳߳Ƿãûп߳ʱCache߳
+        bool BeforeSubmit() {
+            if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
+                return false;
+            }
+            if (config_.scale_policy == ScalePolicy::kOnDemand && GetWaitingThreadSize() == 0 &&
+                GetTotalThreadSize() < config_.max_threads) {
+                AddThread(GetNextThreadId(), ThreadFlag::kCache);
+            }
+            return true;
+        }
+
+        //Уȡģʽ̳߳ڲύ뱾ضУķнлȫֶ
+        //нʱoverflow_policyfalseʾ񱻾ܾ
+        //ضвȼֻзkNormalͨŻ뱾ض
+        bool PushTask(Task&& task, TaskLane& lane, const TaskOptions* options = nullptr) {
+            ThreadWrapper* worker = GetCurrentWorker();
+            if (worker != nullptr && &lane == this->lanes_[kNormalLane].get() && (!IsBounded() || TryAcquireSlot())) {
+                worker->local_tasks->Push(SlabNew<QueuedTask>(std::move(task), NowNanos(), options));
+                NotifyWaiter();
+                return true;
+            }
+            if (!IsBounded()) {
+                {
+                    ThreadPoolLock lock(this->task_mutex_);
+                    int64_t now_ns = NowNanos();
+                    lane.tasks.emplace(std::move(task), now_ns, options);
+                    lane.OnPush(now_ns);
+                }
+                if (config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                    this->event_count_.Notify(1);
+                }
+                else {
+                    this->task_cv_.notify_one();
+                }
+                return true;
+            }
+            if (!PushBoundedTask(lane, std::move(task), options)) {
+                return false;
+            }
+            NotifyWaiter();
+            return true;
+        }
+
+        //ȫֶֻһѵȴ߳
+        //ܾʱBatchItemɼ
+        void PushTasks(std::vector<Task>& tasks) {
+            size_t pushed_num = tasks.size();
+            ThreadWrapper* worker = GetCurrentWorker();
+            if (worker != nullptr) {
+                int64_t now_ns = NowNanos();
+                for (auto& task : tasks) {
+                    //нģʽʱⲿύһoverflow_policy
+                    if (!IsBounded() || TryAcquireSlot()) {
+                        worker->local_tasks->Push(SlabNew<QueuedTask>(std::move(task), now_ns));
+                    }
+                    else if (!PushBoundedTask(*this->lanes_[kNormalLane], std::move(task))) {
+                        --pushed_num;
+                    }
+                }
+            }
+            else if (!IsBounded()) {
+                TaskLane& lane = *this->lanes_[kNormalLane];
+                ThreadPoolLock lock(this->task_mutex_);
+                int64_t now_ns = NowNanos();
+                for (auto& task : tasks) {
+                    lane.tasks.emplace(std::move(task), now_ns);
+                    lane.OnPush(now_ns);
+                }
+            }
+            else {
+                for (auto& task : tasks) {
+                    if (!PushBoundedTask(*this->lanes_[kNormalLane], std::move(task))) {
+                        --pushed_num;
+                    }
+                }
+            }
+            total_function_num_ += static_cast<int>(pushed_num);
+            NotifyWaiter(pushed_num);
+        }
+
+        //нУ̳߳صʱoverflow_policy߳
+        bool PushBoundedTask(TaskLane& lane, Task&& task, const TaskOptions* options = nullptr) {
+            QueuedTask item(std::move(task), NowNanos(), options);
+            //ͨmax_task_sizeռ벻ʧ
+            while (!TryAcquireSlot() || !lane.BoundedTasks().TryPush(std::move(item))) {
+                OverflowPolicy policy = config_.overflow_policy;
+                if (policy == OverflowPolicy::kBlock && IsWorkerThread()) {
+                    policy = OverflowPolicy::kCallerRuns;
+                }
+                if (policy == OverflowPolicy::kReject) {
+                    ++this->rejected_function_num_;
+                    return false;
+                }
+                if (policy == OverflowPolicy::kDiscardOldest) {
+                    QueuedTask oldest;
+                    if (lane.TryPopBounded(oldest)) {
+                        --lane.depth;
+                        --this->queued_task_num_;
+                        ++this->rejected_function_num_;
+                        continue;
+                    }
+                    //ͨ߱ضռãͨûпԶ񣬸Ϊύִ߳
+                    policy = OverflowPolicy::kCallerRuns;
+                }
+                if (policy == OverflowPolicy::kCallerRuns) {
+                    RunTask(GetCurrentThread(), item);
+                    return true;
+                }
+                //kBlock: ȴ߳ȡԣύʱûлѹ̣߳ǰȻ
+                NotifyWaiter(config_.max_task_size);
+                ThreadPoolLock lock(this->task_mutex_);
+                ++this->blocked_producer_num_;
+                this->space_cv_.wait(lock, [this] {
+                    return this->is_shutdown_ || this->is_shutdown_now_ ||
+                        this->queued_task_num_.load() < config_.max_task_size;
+                    });
+                --this->blocked_producer_num_;
+                if (this->is_shutdown_ || this->is_shutdown_now_) {
+                    return false;
+                }
+            }
+            lane.OnPush(item.enqueue_ns);
+            return true;
+        }
+
+        //нģʽΪһռһռʱfalse
+        bool TryAcquireSlot() {
+            int num = this->queued_task_num_.load();
+            while (num < config_.max_task_size) {
+                if (this->queued_task_num_.compare_exchange_weak(num, num + 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //ضеȡãнģʽ¹黹ύ߳
+        void ReleaseLocalSlot() {
+            if (IsBounded()) {
+                --this->queued_task_num_;
+                NotifyProducer();
+            }
+        }
+
+        //õȴȡģʽ˳ͬͨ˳starvation_timeʱȡͨе
+        //ȻԼıضСͨȥ̵߳ıض͵ضһֱʱⲿύҲ
+        //thread_ptrΪձʾ߲̳߳е̣߳ûбض
+        bool TryGetTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (this->is_shutdown_now_) {
+                return false;
+            }
+            bool is_work_stealing = config_.schedule_mode == ScheduleMode::kWorkStealing;
+            if (is_work_stealing && HasStarvingLane(NowNanos()) && TryPopSharedTask(thread_ptr, item)) {
+                return true;
+            }
+            QueuedTask* local_task = nullptr;
+            if (is_work_stealing && thread_ptr != nullptr && thread_ptr->local_tasks->Pop(local_task)) {
+                item = std::move(*local_task);
+                SlabDelete(local_task);
+                ReleaseLocalSlot();
+                return true;
+            }
+            if ((IsBounded() || is_work_stealing) && TryPopSharedTask(thread_ptr, item)) {
+                return true;
+            }
+            if (is_work_stealing && StealTask(thread_ptr, local_task)) {
+                item = std::move(*local_task);
+                SlabDelete(local_task);
+                ReleaseLocalSlot();
+                return true;
+            }
+            return false;
+        }
+
+        //ӹͨȡнģʽ޽ģʽֻͨΪʱżtask_mutex_
+        bool TryPopSharedTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (IsBounded()) {
+                if (!PopSharedTask(thread_ptr, item)) {
+                    return false;
+                }
+                NotifyProducer();
+                return true;
+            }
+            //depthԭӱֻʾȡʱټȷ
+            if (!HasQueuedTask()) {
+                return false;
+            }
+            ThreadPoolLock lock(this->task_mutex_);
+            return !this->is_shutdown_now_ && PopSharedTask(thread_ptr, item);
+        }
+
+        //Ƿзǿյͨstarvation_timeûбȡжϷʽPickLaneͬ
+        bool HasStarvingLane(int64_t now_ns) {
+            int64_t starvation_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.starvation_time).count();
+            if (starvation_ns <= 0) {
+                return false;
+            }
+            for (auto& lane : this->lanes_) {
+                if (lane->last_serve_ns.load() < now_ns - starvation_ns && !lane->Empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //ִȡ̳߳е߳ͬʱԼļϼ¼Ŷʱִʱ
+        //thread_ptrΪձʾύִ߳Уֻ
+        void RunTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (item.token.IsCancelled() || (item.deadline_ns != 0 && NowNanos() > item.deadline_ns)) {
+                //ֱ٣Run/Submitõfutureյbroken_promise쳣
+                item.task = Task();
+                ++this->skipped_function_num_;
+                return;
+            }
+            CancellationToken::Scope scope(item.token);
+            if (thread_ptr == nullptr) {
+                item.task();
+                ++this->caller_executed_num_;
+                return;
+            }
+            int64_t start_ns = NowNanos();
+            item.task();
+            thread_ptr->counters.OnRun(start_ns - item.enqueue_ns, NowNanos() - start_ns);
+        }
+
+        //task_mutex_ʱ׼ȷʱֻܵʾ
+        bool HasQueuedTask() {
+            for (auto& lane : this->lanes_) {
+                if (!lane->Empty()) {
+                    return true;
+                }
+            }
+            for (auto& node_lane : this->node_lanes_) {
+                TaskLane* lane = node_lane.load();
+                if (lane != nullptr && !lane->Empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //ʱҪtask_mutex_неѾ߳ȡߣԿܷfalse
+        bool PopQueuedTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (!PopSharedTask(thread_ptr, item)) {
+                return false;
+            }
+            if (IsBounded() && this->blocked_producer_num_.load() > 0) {
+                this->space_cv_.notify_all();
+            }
+            return true;
+        }
+
+        //нпճλúRunеύ̣߳ǿڵȲͬͨȫ
+        void NotifyProducer() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->blocked_producer_num_.load() > 0) {
+                { ThreadPoolLock lock(this->task_mutex_); }
+                this->space_cv_.notify_all();
+            }
+        }
+
+        bool IsBounded() const { return config_.max_task_size > 0; }
+
+        bool IsValidLane(int lane_id) const { return lane_id >= 0 && lane_id < static_cast<int>(this->lanes_.size()); }
+
+        static int64_t NowNanos() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //ڵڵһýڵύʱŴûõRunOnNodeȺʱռڴ棬ȡʱҲ
+        TaskLane& NodeLane(int node) {
+            TaskLane* lane = this->node_lanes_[node].load(std::memory_order_acquire);
+            if (lane == nullptr) {
+                std::unique_ptr<TaskLane> created(new TaskLane("node" + std::to_string(node), 1, config_.max_task_size));
+                if (this->node_lanes_[node].compare_exchange_strong(lane, created.get(), std::memory_order_acq_rel)) {
+                    lane = created.release();
+                }
+            }
+            return *lane;
+        }
+
+        //ͨ¼ϸȼ˳ͼȨƽȵתֻ֮߳ǰ
+        int CreateLane(const std::string& name, int weight) {
+            this->lanes_.emplace_back(new TaskLane(name, weight, config_.max_task_size));
+            int lane_num = static_cast<int>(this->lanes_.size());
+            this->lane_order_.resize(lane_num);
+            for (int i = 0; i < lane_num; ++i) {
+                this->lane_order_[i] = i;
+            }
+            std::stable_sort(this->lane_order_.begin(), this->lane_order_.end(),
+                [this](int a, int b) { return this->lanes_[a]->weight > this->lanes_[b]->weight; });
+
+            //ƽȨѯÿͨԼȨأѡǰֵͨټȥȨ
+            //һÿֵͨĴȨأͬһͨѳ
+            int total_weight = 0;
+            for (auto& lane : this->lanes_) {
+                total_weight += lane->weight;
+            }
+            std::vector<int> current(lane_num, 0);
+            this->fair_schedule_.clear();
+            for (int round = 0; round < total_weight; ++round) {
+                int best = 0;
+                for (int i = 0; i < lane_num; ++i) {
+                    current[i] += this->lanes_[i]->weight;
+                    if (current[i] > current[best]) {
+                        best = i;
+                    }
+                }
+                current[best] -= total_weight;
+                this->fair_schedule_.push_back(best);
+            }
+            return lane_num - 1;
+        }
+
+        //յȲѡһȡͨͨΪʱ-1
+        //ѡõͨΰռȨƽתֵͨΪջϸȼʱȨشӴСѡ
+        int PickLane(int64_t now_ns) {
+            int64_t starvation_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.starvation_time).count();
+            if (starvation_ns > 0) {
+                int starving = -1;
+                int64_t oldest_ns = now_ns - starvation_ns;
+                for (size_t i = 0; i < this->lanes_.size(); ++i) {
+                    TaskLane& lane = *this->lanes_[i];
+                    int64_t serve_ns = lane.last_serve_ns.load();
+                    if (serve_ns < oldest_ns && !lane.Empty()) {
+                        starving = static_cast<int>(i);
+                        oldest_ns = serve_ns;
+                    }
+                }
+                if (starving >= 0) {
+                    return starving;
+                }
+            }
+            if (config_.lane_policy == LanePolicy::kWeightedFair) {
+                int lane_id = this->fair_schedule_[this->fair_cursor_++ % this->fair_schedule_.size()];
+                if (!this->lanes_[lane_id]->Empty()) {
+                    return lane_id;
+                }
+            }
+            for (int lane_id : this->lane_order_) {
+                if (!this->lanes_[lane_id]->Empty()) {
+                    return lane_id;
+                }
+            }
+            return -1;
+        }
+
+        //ѡͨȡ񣬱߳ȡʱȼ˳ͨ
+        //޽ģʽµʱҪtask_mutex_
+        bool PopLaneTask(QueuedTask& item) {
+            int64_t now_ns = NowNanos();
+            int first = PickLane(now_ns);
+            if (first < 0) {
+                return false;
+            }
+            if (PopFromLane(*this->lanes_[first], item, now_ns)) {
+                return true;
+            }
+            for (int lane_id : this->lane_order_) {
+                if (lane_id != first && PopFromLane(*this->lanes_[lane_id], item, now_ns)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //߳ȡԼڽڵеٰȲȡͨеڵִ
+        //޽ģʽµʱҪtask_mutex_
+        bool PopSharedTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            int node = thread_ptr != nullptr ? thread_ptr->numa_node : -1;
+            TaskLane* own_lane = node >= 0 ? this->node_lanes_[node].load(std::memory_order_acquire) : nullptr;
+            if (own_lane != nullptr && PopFromLane(*own_lane, item, NowNanos())) {
+                return true;
+            }
+            if (PopLaneTask(item)) {
+                return true;
+            }
+            for (size_t i = 0; i < this->node_lanes_.size(); ++i) {
+                TaskLane* lane = this->node_lanes_[i].load(std::memory_order_acquire);
+                if (static_cast<int>(i) != node && lane != nullptr && !lane->Empty() && PopFromLane(*lane, item, NowNanos())) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool PopFromLane(TaskLane& lane, QueuedTask& item, int64_t now_ns) {
+            if (IsBounded()) {
+                if (!lane.TryPopBounded(item)) {
+                    return false;
+                }
+                --this->queued_task_num_;
+            }
+            else {
+                if (lane.tasks.empty()) {
+                    return false;
+                }
+                item = std::move(lane.tasks.front());
+                lane.tasks.pop();
+            }
+            lane.OnPop(now_ns, item.enqueue_ns);
+            return true;
+        }
+
+        //ϴελÿʼ̵߳ıضУп̶߳ȥ͵ͬһ߳
+        bool StealTask(ThreadWrapper* thief, QueuedTask*& task) {
+            ThreadPoolLock lock(this->worker_mutex_);
+            size_t thread_num = this->worker_threads_.size();
+            if (thread_num == 0) {
+                return false;
+            }
+            auto iter = this->worker_threads_.begin();
+            std::advance(iter, thief != nullptr ? thief->steal_index++ % thread_num : 0);
+            for (size_t i = 0; i < thread_num; ++i, ++iter) {
+                if (iter == this->worker_threads_.end()) {
+                    iter = this->worker_threads_.begin();
+                }
+                if (iter->get() != thief && (*iter)->local_tasks->Steal(task)) {
+                    if (thief != nullptr) {
+                        WorkerCounters::Add(thief->counters.steal_num, 1);
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool HasStealableTask() {
+            if (config_.schedule_mode != ScheduleMode::kWorkStealing) {
+                return false;
+            }
+            ThreadPoolLock lock(this->worker_mutex_);
+            for (auto& thread_ptr : this->worker_threads_) {
+                if (!thread_ptr->local_tasks->Empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //task_num߳ڵȴͻѣѵĸ
+        //ȼ֪֤ͨȴ߳ҪôڼʱҪôѾȴյ֪ͨ
+        void NotifyWaiter(size_t task_num = 1) {
+            if (config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                this->event_count_.Notify(task_num);
+                return;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            size_t waiting_num = static_cast<size_t>(std::max(this->waiting_thread_num_.load(), 0));
+            if (waiting_num == 0 || task_num == 0) {
+                return;
+            }
+            { ThreadPoolLock lock(this->task_mutex_); }
+            if (task_num >= waiting_num) {
+                this->task_cv_.notify_all();
+                return;
+            }
+            while (task_num-- > 0) {
+                this->task_cv_.notify_one();
+            }
+        }
+
+        //ǰ߳̽ãǷΪһ߳
+        //п̻߳ûŶʱҪڼύBeforeSubmitԭĹ򴴽߳
+        bool EnterBlocking() {
+            ++this->blocking_thread_num_;
+            if (this->is_shutdown_ || this->is_shutdown_now_ || GetWaitingThreadSize() > 0 || (!HasQueuedTask() && !HasStealableTask())) {
+                return false;
+            }
+            //֮ǰûü˳Cacheֱ߳£ٴ
+            int surplus_num = this->surplus_thread_num_.load();
+            while (surplus_num > 0) {
+                if (this->surplus_thread_num_.compare_exchange_weak(surplus_num, surplus_num - 1)) {
+                    ++this->compensating_thread_num_;
+                    ++this->compensated_num_;
+                    return true;
+                }
+            }
+            if (GetActiveThreadSize() >= config_.max_threads) {
+                return false;
+            }
+            WZQ_TRACE_DEBUG("compensate blocking thread");
+            ++this->compensating_thread_num_;
+            AddThread(GetNextThreadId(), ThreadFlag::kCache);
+            ++this->compensated_num_;
+            return true;
+        }
+
+        void LeaveBlocking(bool is_compensated) {
+            --this->blocking_thread_num_;
+            if (!is_compensated) {
+                return;
+            }
+            //еCache߳˳һִCacheִ֮߳
+            ++this->surplus_thread_num_;
+            --this->compensating_thread_num_;
+            { ThreadPoolLock lock(this->task_mutex_); }
+            this->task_cv_.notify_all();
+            this->event_count_.NotifyAll();
+        }
+
+        bool HasSurplusThread(ThreadWrapper* thread_ptr) {
+            return thread_ptr->flag.load() == ThreadFlag::kCache && this->surplus_thread_num_.load() > 0;
+        }
+
+        //Cache߳һĲ߳ɹ߳˳
+        bool TakeSurplusThread(ThreadWrapper* thread_ptr) {
+            if (thread_ptr->flag.load() != ThreadFlag::kCache) {
+                return false;
+            }
+            int surplus_num = this->surplus_thread_num_.load();
+            while (surplus_num > 0) {
+                if (this->surplus_thread_num_.compare_exchange_weak(surplus_num, surplus_num - 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //Cache߳ΪResizeʱ߹ر˳˳ʱãж͵ֵһ
+        //̵߳ûûнʱԤȵֵδø
+        void SettleSurplusThread(ThreadWrapper* thread_ptr) {
+            if (thread_ptr->flag.load() != ThreadFlag::kCache) {
+                return;
+            }
+            int surplus_num = this->surplus_thread_num_.load();
+            while (surplus_num > -this->compensating_thread_num_.load()) {
+                if (this->surplus_thread_num_.compare_exchange_weak(surplus_num, surplus_num - 1)) {
+                    return;
+                }
+            }
+        }
+
+        //kSpinThenParkģʽóCPUǰ
+        //߳Ҳ̣߳ύʱΪCache߳
+        //ͬʱ̲߳MaxSpinningThreads()ֱ˯ߣCPUʱóCPU̻߳ύ̼߳CPU
+        //ʱ߳û˯ߣύҲѲ񷴶Ҫһ
+        void SpinWait() {
+            if (++this->spinning_thread_num_ > MaxSpinningThreads()) {
+                --this->spinning_thread_num_;
+                return;
+            }
+            ++this->waiting_thread_num_;
+            for (int i = 0; i < config_.spin_count && !HasQueuedTask(); ++i) {
+                CpuRelax();
+            }
+            for (int i = 0; i < config_.yield_count && !HasQueuedTask() && !HasStealableTask(); ++i) {
+                std::this_thread::yield();
+            }
+            --this->waiting_thread_num_;
+            --this->spinning_thread_num_;
+        }
+
+        //CPUһ룬ֻһCPUʱΪ0ȡCPUʱΪ1
+        static int MaxSpinningThreads() {
+            static const int max_num = std::thread::hardware_concurrency() == 0 ? 1 : static_cast<int>(std::thread::hardware_concurrency() / 2);
+            return max_num;
+        }
+
+        //kSpinThenParkģʽ¼˯ߣʱtask_mutex_˯ڼͷ
+        //Cache̳߳time_outûеȵʱfalse
+        template <typename Pred>
+        bool ParkWorker(ThreadPoolLock& lock, bool is_core, Pred is_ready) {
+            auto deadline = std::chrono::steady_clock::now() + this->config_.time_out;
+            while (!is_ready()) {
+                EventCount::Key key = this->event_count_.PrepareWait();
+                if (is_ready()) {
+                    this->event_count_.CancelWait();
+                    break;
+                }
+                lock.unlock();
+                if (is_core) {
+                    this->event_count_.Wait(key);
+                }
+                else {
+                    auto now = std::chrono::steady_clock::now();
+                    bool notified = now < deadline && this->event_count_.WaitFor(key, deadline - now);
+                    if (!notified) {
+                        if (now >= deadline) {
+                            this->event_count_.CancelWait();
+                        }
+                        lock.lock();
+                        return is_ready();
+                    }
+                }
+                lock.lock();
+            }
+            return true;
+        }
+
+        //̸߳[core_threads, max_threads]֮䣬ص̸߳
+        //ӵCachẹ߳ʱֻڵȴCachẹ߳߳Լ˳бƳ
+        //ִ̣ͣ߳Ҳ̱߳бʱ޸беCache̲߳ʱʵʼٵĸһЩ
+        int Resize(int thread_num) {
+            thread_num = std::max(config_.core_threads, std::min(thread_num, config_.max_threads));
+            int old_thread_num = GetActiveThreadSize();
+            if (thread_num == old_thread_num || this->is_shutdown_ || this->is_shutdown_now_) {
+                return old_thread_num;
+            }
+            WZQ_TRACE_INFO("resize thread num", old_thread_num, thread_num);
+            if (thread_num > old_thread_num) {
+                for (int i = old_thread_num; i < thread_num; ++i) {
+                    AddThread(GetNextThreadId(), ThreadFlag::kCache);
+                }
+                return thread_num;
+            }
+            int diff = old_thread_num - thread_num;
+            {
+                //󴴽߳бĩβȻ
+                ThreadPoolLock lock(this->worker_mutex_);
+                for (auto iter = this->worker_threads_.rbegin(); iter != this->worker_threads_.rend() && diff > 0; ++iter) {
+                    ThreadWrapper& thread = **iter;
+                    if (thread.flag.load() == ThreadFlag::kCache && thread.state.load() == ThreadState::kWaiting &&
+                        !thread.is_retiring.exchange(true)) {
+                        --diff;
+                    }
+                }
+            }
+            //̼߳ȴʱtask_mutex_ȼ̸֪ͨ߳ռûʼȴʱ֪ͨ
+            { ThreadPoolLock lock(this->task_mutex_); }
+            this->task_cv_.notify_all();
+            this->event_count_.NotifyAll();
+            return thread_num + diff;
+        }
+
+        //ûбҪ˳̸߳
+        int GetActiveThreadSize() {
+            ThreadPoolLock lock(this->worker_mutex_);
+            int thread_num = 0;
+            for (auto& thread_ptr : this->worker_threads_) {
+                if (!thread_ptr->is_retiring.load()) {
+                    ++thread_num;
+                }
+            }
+            return thread_num;
+        }
+
+        //kAutoScaleģʽ̵߳ѭÿscale_intervalȡһͳƿգһεĿõʱڵŶʱ
+        //ʰִִʱ㣬ִʱִ֮ܳǰ룬ִ̲߳ᱻ
+        void ScaleLoop() {
+            PoolStats last = GetStats();
+            int64_t last_ns = NowNanos();
+            int idle_samples = 0;
+            for (;;) {
+                {
+                    ThreadPoolLock lock(this->scaler_mutex_);
+                    this->scaler_cv_.wait_for(lock, config_.scale_interval,
+                        [this] { return this->is_shutdown_ || this->is_shutdown_now_; });
+                    if (this->is_shutdown_ || this->is_shutdown_now_) {
+                        break;
+                    }
+                }
+                JoinExitedThreads();
+                PoolStats stats = GetStats();
+                int64_t now_ns = NowNanos();
+                HistogramSnapshot window = stats.queue_latency;
+                window.Subtract(last.queue_latency);
+                int thread_num = GetActiveThreadSize();
+                double capacity_ns = static_cast<double>(std::max<int64_t>(now_ns - last_ns, 1)) * std::max(thread_num, 1);
+                double utilization = 100.0 * static_cast<double>(stats.busy_ns - last.busy_ns) / capacity_ns;
+                uint64_t scale_up_wait_ns = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(config_.scale_up_wait).count());
+
+                //ŶӣŶʱ䳬꣬ʱ̶߳æûпʼִκ
+                bool is_overloaded = stats.queue_depth > 0 && (window.Percentile(0.99) >= scale_up_wait_ns ||
+                    (window.Count() == 0 && stats.waiting_threads == 0));
+                if (is_overloaded) {
+                    idle_samples = 0;
+                    if (thread_num < config_.max_threads) {
+                        int step = static_cast<int>(std::min(stats.queue_depth, static_cast<size_t>(thread_num)));
+                        WZQ_TRACE_INFO("scale up", thread_num, std::max(step, 1));
+                        Resize(thread_num + std::max(step, 1));
+                    }
+                }
+                else if (stats.queue_depth == 0 && utilization < config_.scale_down_utilization) {
+                    if (++idle_samples >= config_.scale_down_samples && thread_num > config_.core_threads) {
+                        //߳ʻصscale_down_utilization
+                        int needed = static_cast<int>(utilization * thread_num / config_.scale_down_utilization) + 1;
+                        WZQ_TRACE_INFO("scale down", thread_num, needed);
+                        Resize(needed);
+                        idle_samples = 0;
+                    }
+                }
+                else {
+                    idle_samples = 0;
+                }
+                last = std::move(stats);
+                last_ns = now_ns;
+            }
+        }
+
+        //߳˳ʱԼбƳͳۼӵretired_stats_̶߳exited_threads_ȴjoin
+        //ֻShutDownNow߳ʱ̲߳Żűضе˳Щ붪ĸ
+        void RemoveThread(ThreadWrapper* thread_ptr) {
+            QueuedTask* task = nullptr;
+            while (thread_ptr->local_tasks->Pop(task)) {
+                SlabDelete(task);
+                ++this->dropped_function_num_;
+                ReleaseLocalSlot();
+            }
+            {
+                ThreadPoolLock lock(this->worker_mutex_);
+                for (auto iter = this->worker_threads_.begin(); iter != this->worker_threads_.end(); ++iter) {
+                    if (iter->get() == thread_ptr) {
+                        RetireThread(*thread_ptr);
+                        this->exited_threads_.push_back(std::move(thread_ptr->ptr));
+                        this->worker_threads_.erase(iter);
+                        break;
+                    }
+                }
+            }
+            this->exit_cv_.notify_all();
+        }
+
+        //Ѿ˳̣߳ǴбƳֻʣºٵβjoinܿͻ᷵
+        void JoinExitedThreads() {
+            std::vector<ThreadPtr> exited_threads;
+            {
+                ThreadPoolLock lock(this->worker_mutex_);
+                exited_threads.swap(this->exited_threads_);
+            }
+            for (auto& thread : exited_threads) {
+                if (thread != nullptr && thread->joinable()) {
+                    thread->join();
+                }
+            }
+        }
+
+        //ȴ߳˳գhas_deadlineΪtrueʱȵdeadlineʱfalse
+        //̳߳е߳ʱȴԼ
+        bool WaitThreads(bool has_deadline, std::chrono::steady_clock::time_point deadline) {
+            size_t self_num = IsWorkerThread() ? 1 : 0;
+            bool is_exited = true;
+            {
+                ThreadPoolLock lock(this->worker_mutex_);
+                auto all_exited = [this, self_num] { return this->worker_threads_.size() <= self_num; };
+                if (has_deadline) {
+                    is_exited = this->exit_cv_.wait_until(lock, deadline, all_exited);
+                }
+                else {
+                    this->exit_cv_.wait(lock, all_exited);
+                }
+            }
+            JoinExitedThreads();
+            return is_exited && self_num == 0;
+        }
+
+        //̳߳еִ߳ύִ߳е
+        uint64_t GetExecutedNum() {
+            ThreadPoolLock lock(this->worker_mutex_);
+            uint64_t executed_num = this->retired_stats_.executed_num + this->caller_executed_num_.load();
+            for (auto& thread_ptr : this->worker_threads_) {
+                executed_num += thread_ptr->counters.executed_num.load(std::memory_order_relaxed);
+            }
+            return executed_num;
+        }
+
+        //ͨͽڵе񣬷ضĸ
+        uint64_t DropQueuedTasks() {
+            std::vector<QueuedTask> dropped;
+            {
+                ThreadPoolLock lock(this->task_mutex_);
+                std::vector<TaskLane*> lanes;
+                for (auto& lane : this->lanes_) {
+                    lanes.push_back(lane.get());
+                }
+                for (auto& lane : this->node_lanes_) {
+                    if (lane.load() != nullptr) {
+                        lanes.push_back(lane.load());
+                    }
+                }
+                for (TaskLane* lane : lanes) {
+                    QueuedTask item;
+                    while (PopFromLane(*lane, item, NowNanos())) {
+                        dropped.push_back(std::move(item));
+                    }
+                }
+            }
+            this->dropped_function_num_ += dropped.size();
+            if (!dropped.empty()) {
+                NotifyProducer();
+            }
+            return dropped.size();
+        }
+
+        //ʱҪworker_mutex_
+        void RetireThread(const ThreadWrapper& thread) {
+            const WorkerCounters& counters = thread.counters;
+            this->retired_stats_.executed_num += counters.executed_num.load(std::memory_order_relaxed);
+            this->retired_stats_.busy_ns += counters.busy_ns.load(std::memory_order_relaxed);
+            this->retired_stats_.steal_num += counters.steal_num.load(std::memory_order_relaxed);
+            this->retired_stats_.wakeup_num += counters.wakeup_num.load(std::memory_order_relaxed);
+            counters.queue_latency.AddTo(this->retired_stats_.queue_latency);
+            counters.run_time.AddTo(this->retired_stats_.run_time);
+        }
+
+        int GetNextThreadId() { return this->thread_id_++; }
+
+        bool IsValidConfig(ThreadPoolConfig config) {
+            if (config.core_threads < 1 || config.max_threads < config.core_threads || config.time_out.count() < 1) {
+                return false;
+            }
+            if (config.affinity == AffinityMode::kCpuList && config.cpu_list.empty()) {
+                return false;
+            }
+            if (config.scale_policy == ScalePolicy::kAutoScale &&
+                (config.scale_interval.count() < 1 || config.scale_down_utilization < 1 || config.scale_down_utilization > 100 ||
+                    config.scale_down_samples < 1)) {
+                return false;
+            }
+            if (config.affinity == AffinityMode::kCompact &&
+                (config.numa_node < 0 || config.numa_node >= CpuTopology::Get().NodeNum())) {
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        ThreadPoolConfig config_;
+
+        std::list<ThreadWrapperPtr> worker_threads_;
+        std::mutex worker_mutex_; //߳бȡʱҪ߳
+
+        std::vector<std::unique_ptr<TaskLane>> lanes_;  //ͨ±ͨid߳ٱ仯
+        std::vector<int> lane_order_;  //ȨشӴСеͨid
+        std::vector<int> fair_schedule_;  //Ȩƽȵת
+        std::vector<std::atomic<TaskLane*>> node_lanes_;  //ÿNUMAڵһУRunOnNodeύ񣬵һýڵύʱ
+        std::atomic<unsigned int> fair_cursor_;
+        std::mutex task_mutex_;
+        std::condition_variable task_cv_;
+        std::condition_variable space_cv_;  //нʱύ߳ڴ˵ȴ
+        EventCount event_count_;  //kSpinThenParkģʽ¿߳˯ߣtask_cv_
+        std::thread scaler_thread_;  //kAutoScaleģʽµ߳
+        std::mutex scaler_mutex_;
+        std::condition_variable scaler_cv_;  //߳ȴһβShutDownʱ˳
+        std::vector<ThreadPtr> exited_threads_;  //Ѿ˳ȴjoiṇ߳worker_mutex_
+        std::condition_variable exit_cv_;  //߳˳ʱ֪ͨworker_mutex_ʹ
         std::atomic<int> total_function_num_;
         std::atomic<int> waiting_thread_num_;
+        std::atomic<int> spinning_thread_num_;  //kSpinThenParkģʽ̸߳
+        std::atomic<int> blocked_producer_num_;
+        std::atomic<int> queued_task_num_;  //нģʽѾռͨڵкͱضе
+        std::atomic<int> rejected_function_num_;
+        std::atomic<uint64_t> caller_executed_num_;  //ύִ߳е
+        std::atomic<uint64_t> skipped_function_num_;  //ʱѾȡֹ߳ʱûִе
+        std::atomic<uint64_t> dropped_function_num_;  //رʱûִоͱ
+        std::atomic<int> blocking_thread_num_;  //ScopedBlocking̸߳
+        std::atomic<int> surplus_thread_num_;  //Ӧ˳Ĳ̸߳ΪʾѾԤ˳ĸ
+        std::atomic<int> compensating_thread_num_;  //̲߳һûнø
+        std::atomic<uint64_t> compensated_num_;  //Ϊ̵̲߳߳Ĵ
+        RetiredStats retired_stats_;
         std::atomic<int> thread_id_;
 
         std::atomic<bool> is_shutdown_now_;
@@ -1,35 +1,131 @@
 #ifndef __TIMER__
 #define __TIMER__
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
-#include <iostream>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
 
 #include "my_map.h"
 #include "thread_pool.h"
+#include "timer_wheel.h"
 
 
 //ʱҪݽṹ
 
-//ȼУд洢ÿʱʱȳӡ
+//ʱڵʹ洢ˣÿһڵУ¼ʱ䣬˰ʱ֯ڵ㣬ѡѻ߷ֲʱ֡
 //Ҫִʱ֪ͨڵȴ̴߳ȡִС
 //̳߳أִ̳߳С
 
 namespace wzq {
+    class TimerQueue;
+
+    /**
+     * һԶʱľAddFuncAfterDuration/AddFuncAtTimePointأֻ¼ڵ±generation⿽
+     * Cancel: ʱûдʱӺɾ񲻻ٽ̳߳أtrueѾڴѾȡʱfalse
+     * Reschedule: ʱûдʱ޸ĵʱ䣬ȻЧֵͬCancel
+     * ߶O(1)(Ѻ˵RescheduleҪO(log n))TimerQueue֮ʹ
+     */
+    class TimerHandle {
+    public:
+        TimerHandle() : queue_(nullptr), slot_(TimerNode::kNil), generation_(0) {}
+
+        bool Cancel();
+
+        bool Reschedule(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point);
+
+        template <typename R, typename P>
+        bool Reschedule(const std::chrono::duration<R, P>& time) {
+            std::chrono::time_point<std::chrono::high_resolution_clock> time_point = std::chrono::high_resolution_clock::now() + time;
+            return Reschedule(time_point);
+        }
+
+        //ĬϹľӦκζʱ
+        bool IsValid() const { return queue_ != nullptr; }
+
+    private:
+        friend class TimerQueue;
+
+        TimerHandle(TimerQueue* queue, uint32_t slot, uint32_t generation) : queue_(queue), slot_(slot), generation_(generation) {}
+
+        TimerQueue* queue_;
+        uint32_t slot_;
+        uint32_t generation_;
+    };
+
     class TimerQueue {
     public:
-        //еĵԪ
-        struct InternalS {
-            std::chrono::time_point<std::chrono::high_resolution_clock> time_point_;
-            std::function<void()> func_;
-            int repeated_id;
-            //أڱȽԪʱ
-            bool operator<(const InternalS& b) const { return time_point_ > b.time_point_; }
+        /**
+         * ʱĴ洢ˣʱѡ
+         * kHeap: ʱĶѣO(log n)ʱʱ㹻
+         * kWheel: ֲʱ֣ɾO(1)ڵĶʱͰȡ
+         * ʺͬʱڴӳʱඨʱĳtimer_wheel.h
+         */
+        enum class TimerBackend { kHeap = 0, kWheel = 1 };
+
+        /**
+         * ڶʱִзʽʱֻռһڵ㣬ÿִ֮ԭ·ˣִ֮вڴ
+         * ͬһʱִвصִʱ䳬ʱһƳٵִ֮
+         * kFixedRate: ̶ƵִУnεĵʱ״εʱ+n*periodִʱƯƣĴ
+         * kFixedRateSkip: ̶ͬƵʣĴֱһǵǰʱ֮ĵһ״εʱ+n*period
+         * kFixedDelay: ÿִ֮ٵperiodִʱ͵ӳٻۻ֮ĵʱ
+         */
+        enum class RepeatMode { kFixedRate = 0, kFixedRateSkip = 1, kFixedDelay = 2 };
+
+        /**
+         * ȴʱڵķʽʱѡ
+         * kCondition: ߳wait_for뵽ڲ1ĶʱֱӴ
+         * kTimerFd: CLOCK_MONOTONICtimerfdĵʱ䣬߳epoll_waitеȴ
+         * ʱǰ1ڣֻĵʱ仯ʱtimerfd
+         * kExternalLoop: kTimerFdһʹtimerfḍ߳ⲿ¼ѭGetTimerFd()ɶʱDispatchExpired
+         * timerfdֻLinux֧֣ƽ̨kTimerFdkExternalLoop˻ΪkConditionʱֺ˵ľȻ1
+         */
+        enum class DispatchMode { kCondition = 0, kTimerFd = 1, kExternalLoop = 2 };
+
+        /**
+         * ʱͳ
+         * pending_num: ûдĶʱ(ѭһִ)
+         * added_num/fired_num: ӵĶʱѾ̳߳صĶʱ
+         * cancelled_num: ֮ǰTimerHandle::CancelɾĶʱЩ񲻻ύ̳߳
+         * rescheduled_num: ֮ǰTimerHandle::Reschedule޸ĹʱĴ
+         * wakeup_num: ߳ڶʱĴposted_num: ̳߳صϲһʱֻһ
+         */
+        struct TimerStats {
+            size_t pending_num;
+            uint64_t added_num;
+            uint64_t fired_num;
+            uint64_t cancelled_num;
+            uint64_t rescheduled_num;
+            uint64_t wakeup_num;
+            uint64_t posted_num;
+        };
+
+        /**
+         * ʱƳٴʱ䣺ʱ[ʱ, ʱ+slack]֮κʱ̴
+         * ̰߳жʱʱʱѾ˵ʱĶʱһȡ
+         * ʱԾȲеĶʱ(гʱԵ)ϲͬһλУ
+         * ͬһȡдslackĶʱΪһ񽻸̳߳أͬһִ߳УûslackĶʱȻΪһ
+         * ϲֻƳٴöʱڵʱ䴥ʱְʱȡ룬slack1ʱҲ
+         */
+        struct Slack {
+            template <typename R, typename P>
+            explicit Slack(const std::chrono::duration<R, P>& time)
+                : slack_ns(std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(), 0)) {}
+
+            int64_t slack_ns;
         };
 
     public:
@@ -40,155 +136,608 @@ namespace wzq {
             if (!ret) {
                 return false;
             }
-            std::thread([this]() { RunLocal(); }).detach();
+            if (dispatch_mode_ == DispatchMode::kCondition) {
+                run_thread_ = std::thread([this]() { RunLocal(); });
+            }
+            else if (dispatch_mode_ == DispatchMode::kTimerFd) {
+                run_thread_ = std::thread([this]() { RunTimerFd(); });
+            }
             return true;
         }
 
+        //kTimerFdkExternalLoopʱtimerfdĶʱʱɶ-1
+        int GetTimerFd() const { return timer_fd_; }
+
+        //kExternalLoopʱⲿ¼ѭGetTimerFd()ɶʱãѵڵĶʱ̳߳أٰĵʱtimerfd
+        //ͬһʱֻһ̵߳
+        void DispatchExpired() {
+#ifdef __linux__
+            uint64_t expirations = 0;
+            ssize_t ret = read(timer_fd_, &expirations, sizeof(expirations));
+            (void)ret;
+#endif
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++wakeup_num_;
+            //timerfd֮ͲЧˣ֮ĵʱûб仯Ҫ
+            armed_ns_ = -1;
+            while (running_.load()) {
+                CollectExpired(NowNanos(), dispatch_tasks_);
+                if (dispatch_tasks_.empty()) {
+                    //Stopڳʱ޸running_timerfdڣֹ֮ͣٸ
+                    int64_t next_ns = NextDeadline();
+                    wakeup_ns_ = next_ns < 0 ? std::numeric_limits<int64_t>::max() : next_ns;
+                    ArmTimerFd(next_ns);
+                    return;
+                }
+                //̳߳ڼ¼ĶʱҪtimerfd֮ȡһ
+                wakeup_ns_ = std::numeric_limits<int64_t>::min();
+                lock.unlock();
+                for (Task& func : dispatch_tasks_) {
+                    thread_pool_.PostOnLane(ThreadPool::TaskPriority::kHigh, std::move(func));
+                }
+                dispatch_tasks_.clear();
+                lock.lock();
+            }
+        }
+
         bool IsAvailable() { return thread_pool_.IsAvailable(); }
 
-        int Size() { return queue_.size(); }
+        int Size() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return static_cast<int>(nodes_.Size());
+        }
+
+        TimerStats GetStats() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            TimerStats stats;
+            stats.pending_num = nodes_.Size();
+            stats.added_num = added_num_;
+            stats.fired_num = fired_num_;
+            stats.cancelled_num = cancelled_num_;
+            stats.rescheduled_num = rescheduled_num_;
+            stats.wakeup_num = wakeup_num_;
+            stats.posted_num = posted_num_;
+            return stats;
+        }
 
         //ιرնʱ
         //ʹrunning_־λƣ־λΪfalse̵߳ѭͻԶ˳ͲȴִУͬʱ̳߳Ҳر
+        //߳˳join֮Źر̳߳أʱʱڲѾû߳
         void Stop() {
-            running_.store(false);
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                running_.store(false);
+                //timerfdڣepoll_waitеȴĵ߳
+                ArmTimerFd(0);
+            }
             cond_.notify_all();
+            if (run_thread_.joinable() && run_thread_.get_id() != std::this_thread::get_id()) {
+                run_thread_.join();
+            }
             thread_pool_.ShutDown();
+            DropPending();
         }
 
         //ĳʱִ
-        //ݵǰʱʱιʱӶInternalSУ
+        //ݵǰʱʱιʱһʱڵУ
         //std::chrono::duration<R, P>& timeͣRʾһֵͣʾPPʾʾʱ䵥λ
+        //صľڴ֮ǰȡʱ޸ĵʱ
         template <typename R, typename P, typename F, typename... Args>
-        void AddFuncAfterDuration(const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
-            InternalS s;
+        TimerHandle AddFuncAfterDuration(const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
+            return AddFuncAfterDuration(time, Slack(std::chrono::nanoseconds(0)), std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        //ƳslackĶʱAddFuncAfterDuration(seconds(30), TimerQueue::Slack(seconds(1)), OnIdle)
+        template <typename R, typename P, typename F, typename... Args>
+        TimerHandle AddFuncAfterDuration(const std::chrono::duration<R, P>& time, Slack slack, F&& f, Args&&... args) {
             //ʱΪǰʱ+ʱ
-            s.time_point_ = std::chrono::high_resolution_clock::now() + time;
-            //ͨbindзװ
-            s.func_ = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-            //ӽУִ߳̽
-            std::unique_lock<std::mutex> lock(mutex_);
-            queue_.push(s);
-            cond_.notify_all();
+            std::chrono::time_point<std::chrono::high_resolution_clock> time_point = std::chrono::high_resolution_clock::now() + time;
+            return AddFuncAtTimePoint(time_point, slack, std::forward<F>(f), std::forward<Args>(args)...);
         }
 
         //ĳһʱִ
-        //ʱInternalSУ
+        //ʱһʱڵУ
         template <typename F, typename... Args>
-        void AddFuncAtTimePoint(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point, F&& f,
+        TimerHandle AddFuncAtTimePoint(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point, F&& f,
             Args&&... args) {
-            InternalS s;
-            //ʱΪʱ
-            s.time_point_ = time_point;
-            //ͨbindзװ
-            s.func_ = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-            //ӽУִ߳̽
+            return AddFuncAtTimePoint(time_point, Slack(std::chrono::nanoseconds(0)), std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        TimerHandle AddFuncAtTimePoint(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point, Slack slack,
+            F&& f, Args&&... args) {
+            //ͨbindзװɵö󲻴ʱֱӷڽڵڴ棬ص׳쳣CatchAllFuncд
+            Task func(MakeCatchAll(std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+            //ӽڵ㣬ʱڵ̼߳ƻʱʱŻ
             std::unique_lock<std::mutex> lock(mutex_);
-            queue_.push(s);
-            cond_.notify_all();
+            uint32_t slot = AddNode(ToNanos(time_point), slack.slack_ns, std::move(func));
+            WakeIfEarlier(nodes_[slot].Expiry());
+            return TimerHandle(this, slot, nodes_[slot].generation);
+        }
+
+#if WZQ_COROUTINE
+        //Эco_await timer.SleepFor(time)Э̹ʱ䵽֮ڶʱڲ̳߳мִУȴڼ䲻ռκ߳
+        //ʱָֻЭ̵ľҪص̳߳ؼִʱco_await pool.Schedule()
+        //ʱʱ䵽֮ǰStopʱЭڵStop߳ǰָЭ֡й©Stop֮SleepForֱӼִ
+        struct SleepAwaiter {
+            TimerQueue* timer;
+            std::chrono::time_point<std::chrono::high_resolution_clock> time_point;
+
+            bool await_ready() const noexcept { return time_point <= std::chrono::high_resolution_clock::now(); }
+
+            bool await_suspend(std::coroutine_handle<> handle) { return timer->AddSleep(time_point, handle); }
+
+            void await_resume() const noexcept {}
+        };
+
+        template <typename R, typename P>
+        SleepAwaiter SleepFor(const std::chrono::duration<R, P>& time) {
+            return SleepAwaiter{ this, std::chrono::high_resolution_clock::now() +
+                std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(time) };
+        }
+
+        SleepAwaiter SleepUntil(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point) {
+            return SleepAwaiter{ this, time_point };
+        }
+#endif
+
+        //ڶʱ״periodִ֮У֮modeظִУֱͨصľCancel
+        //Reschedule޸һεĵʱ䣬֮ʱ俪ʼִ
+        template <typename R, typename P, typename F, typename... Args>
+        TimerHandle AddPeriodicFunc(RepeatMode mode, const std::chrono::duration<R, P>& period, F&& f, Args&&... args) {
+            return AddPeriodicFuncLocal(mode, -1, period, std::forward<F>(f), std::forward<Args>(args)...);
         }
 
         //ѭִ
-        //ΪѭɱʶIDⲿͨIDȡִУ£ڲƵݹķʽѭִ
+        //ΪѭɱʶIDⲿͨIDȡִ
+        //ִrepeat_numΣrepeat_num<=0ʱһֱִУÿִ֮timeִһ(kFixedDelay)
         template <typename R, typename P, typename F, typename... Args>
         int AddRepeatedFunc(int repeat_num, const std::chrono::duration<R, P>& time, F&& f, Args&&... args) {
             //õһεظִдļ¼id
             int id = GetNextRepeatedFuncId();
-            //ϣвεѭıʶ
-            repeated_id_state_map_.Emplace(id, RepeatedIdState::kRunning);
-            //ͨbindзװ
-            auto tem_func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-            //úѭ
-            AddRepeatedFuncLocal(repeat_num - 1, time, id, std::move(tem_func));
+            //ڶʱϣм¼idӦľ
+            TimerHandle handle = AddPeriodicFuncLocal(RepeatMode::kFixedDelay, repeat_num > 0 ? repeat_num : -1, time,
+                std::forward<F>(f), std::forward<Args>(args)...);
+            repeated_handle_map_.Emplace(id, handle);
             return id;
         }
 
         //ȡѭִ
-        //ʱڲrepeated_id_state_map ݽṹڴ洢ѭIDȡִʱIDrepeatedid_state_mapƳѭͻԶȡ
-        void CancelRepeatedFuncId(int func_id) { repeated_id_state_map_.EraseKey(func_id); }
+        //ʱڲrepeated_handle_map_ݽṹ¼ѭIDӦľȡʱͨѶʱɾִеһִ֮Ͳִ
+        void CancelRepeatedFuncId(int func_id) {
+            TimerHandle handle;
+            if (repeated_handle_map_.GetValueFromKey(func_id, handle)) {
+                handle.Cancel();
+                repeated_handle_map_.EraseKey(func_id);
+            }
+        }
 
         //õһεظִдļ¼id
         int GetNextRepeatedFuncId() { return repeated_func_id_++; }
 
         //ڹ캯гʼҪúڲ̳߳أ̳߳гפ߳ĿǰΪ4ο֮ǰ̳߳
-        TimerQueue() : thread_pool_(wzq::ThreadPool::ThreadPoolConfig{ 4, 4, 40, std::chrono::seconds(4) }) {
+        explicit TimerQueue(TimerBackend backend = TimerBackend::kHeap, DispatchMode dispatch_mode = DispatchMode::kCondition)
+            : backend_(backend), dispatch_mode_(dispatch_mode), heap_(TimerNode::kHeap), wheel_(NowNanos()),
+              wakeup_ns_(std::numeric_limits<int64_t>::max()), timer_fd_(-1), epoll_fd_(-1), armed_ns_(-1), added_num_(0),
+              fired_num_(0), cancelled_num_(0), rescheduled_num_(0),
+              wakeup_num_(0), posted_num_(0),
+              thread_pool_(PoolConfig()) {
             repeated_func_id_.store(0);
             running_.store(true);
+            if (dispatch_mode_ != DispatchMode::kCondition && !OpenTimerFd()) {
+                dispatch_mode_ = DispatchMode::kCondition;
+            }
+            early_ns_ = dispatch_mode_ == DispatchMode::kCondition ? kPrecisionNs - 1 : 0;
         }
 
-        ~TimerQueue() { Stop(); }
-
-        enum class RepeatedIdState { kInit = 0, kRunning = 1, kStop = 2 };
+        ~TimerQueue() {
+            Stop();
+#ifdef __linux__
+            if (epoll_fd_ >= 0) {
+                close(epoll_fd_);
+            }
+            if (timer_fd_ >= 0) {
+                close(timer_fd_);
+            }
+#endif
+        }
 
     private:
+        friend class TimerHandle;
+
+        //kConditionʱ뵽ڲkPrecisionNsĶʱֱӴ
+        static const int64_t kPrecisionNs = 1000000;
+
+        //ڲ̳߳неһεڵĶʱĿʱɵֱִ߳
+        static const int kPoolTaskSize = 1024;
+
+        //ڲ̳߳صãڵĶʱɵ߳Ͷݣнʱõ߳ȴ֮ĶʱᱻƳ٣
+        //˾ɵֱִ߳(kCallerRuns)񲻻ᶪʧнеĲλʱһηãͶڴ
+        static ThreadPool::ThreadPoolConfig PoolConfig() {
+            ThreadPool::ThreadPoolConfig config{ 4, 4, kPoolTaskSize, std::chrono::seconds(4) };
+            config.overflow_policy = ThreadPool::OverflowPolicy::kCallerRuns;
+            return config;
+        }
+
         void RunLocal() {
+            std::vector<Task> expired;
             //ֻҪʱУͳѭ
             while (running_.load()) {
-                //ж϶û
+                //жûеڵ
                 std::unique_lock<std::mutex> lock(mutex_);
-                //ûͷ˯ȥ
-                if (queue_.empty()) {
-                    cond_.wait(lock);
-                    continue;
+                //Stopڳʱ޸running_ټһΣStop֪ͨ
+                if (!running_.load()) {
+                    break;
                 }
-                //͵õ
-                auto s = queue_.top();
-                //ȡ͵ڰʱʱ
-                auto diff = s.time_point_ - std::chrono::high_resolution_clock::now();
-                //ʱ仹ûͼͷ˯ȥ
-                if (std::chrono::duration_cast<std::chrono::milliseconds>(diff).count() > 0) {
-                    cond_.wait_for(lock, diff);
+                int64_t now_ns = NowNanos();
+                CollectExpired(now_ns, expired);
+                //ʱ䵽ˣһȡеڵӵ̳߳صУ̳߳ػỽ߳ȥִ
+                if (!expired.empty()) {
+                    lock.unlock();
+                    for (Task& func : expired) {
+                        thread_pool_.PostOnLane(ThreadPool::TaskPriority::kHigh, std::move(func));
+                    }
+                    expired.clear();
                     continue;
                 }
-                //ʱ䵽ˣȡӵ̳߳صУ̳߳ػỽһ߳ȥִ
+                //ûͷ˯ȥʱ仹û˯ĵʱ
+                //wakeup_ns_¼ƻʱ䣬µĶʱ絽ʱҪѵ߳
+                int64_t next_ns = NextDeadline();
+                if (next_ns < 0) {
+                    wakeup_ns_ = std::numeric_limits<int64_t>::max();
+                    cond_.wait(lock);
+                }
                 else {
-                    queue_.pop();
-                    lock.unlock();
-                    thread_pool_.Run(std::move(s.func_));
+                    wakeup_ns_ = next_ns;
+                    cond_.wait_for(lock, std::chrono::nanoseconds(next_ns - now_ns));
+                }
+                wakeup_ns_ = std::numeric_limits<int64_t>::min();
+                ++wakeup_num_;
+            }
+            WZQ_TRACE_INFO("timer queue stopped");
+        }
+
+        //kTimerFdĵ̣߳epoll_waitеȴtimerfdڣȻȡڵĶʱ
+        void RunTimerFd() {
+#ifdef __linux__
+            epoll_event event;
+            for (;;) {
+                DispatchExpired();
+                //DispatchExpiredreadѾStoptimerfdڵǴ֪ͨʱٽepoll_wait
+                //ûtimerfd̻߳һֱȥ֮Stopõĵڻûбepoll_wait
+                if (!running_.load()) {
+                    break;
                 }
+                epoll_wait(epoll_fd_, &event, 1, -1);
             }
-            cout << "ʱر" << endl;
+#endif
+            WZQ_TRACE_INFO("timer queue stopped");
         }
 
-        template <typename R, typename P, typename F>
-        void AddRepeatedFuncLocal(int repeat_num, const std::chrono::duration<R, P>& time, int id, F&& f) {
-            //жѭûȡ
-            if (!this->repeated_id_state_map_.IsKeyExist(id)) {
+        bool OpenTimerFd() {
+#ifdef __linux__
+            timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (timer_fd_ < 0) {
+                return false;
+            }
+            if (dispatch_mode_ == DispatchMode::kExternalLoop) {
+                return true;
+            }
+            epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = timer_fd_;
+            if (epoll_fd_ >= 0 && epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event) == 0) {
+                return true;
+            }
+            if (epoll_fd_ >= 0) {
+                close(epoll_fd_);
+                epoll_fd_ = -1;
+            }
+            close(timer_fd_);
+            timer_fd_ = -1;
+#endif
+            return false;
+        }
+
+        //timerfdΪdeadline_nsڣС0ʱȡϴõʱͬʱκ£ʱmutex_
+        void ArmTimerFd(int64_t deadline_ns) {
+#ifdef __linux__
+            if (timer_fd_ < 0 || deadline_ns == armed_ns_) {
                 return;
             }
-            //һнڵ
-            InternalS s;
-            //в
-            s.time_point_ = std::chrono::high_resolution_clock::now() + time;
-            auto tem_func = std::move(f);
-            s.repeated_id = id;
-            //˼ǣֻڴ˽ڵʱ䵽ȡִʱ򣬻һִкͬͬͽڵ㣬ֻظ-1
-            s.func_ = [this, &tem_func, repeat_num, time, id]() {
-                tem_func();
-                if (!this->repeated_id_state_map_.IsKeyExist(id) || repeat_num == 0) {
-                    return;
+            armed_ns_ = deadline_ns;
+            //ʱhigh_resolution_clockʱ䣬ʱãѾʱΪ1
+            itimerspec spec = {};
+            if (deadline_ns >= 0) {
+                int64_t delay_ns = std::max<int64_t>(deadline_ns - NowNanos(), 1);
+                spec.it_value.tv_sec = static_cast<time_t>(delay_ns / 1000000000);
+                spec.it_value.tv_nsec = static_cast<long>(delay_ns % 1000000000);
+            }
+            timerfd_settime(timer_fd_, 0, &spec, nullptr);
+#else
+            (void)deadline_ns;
+#endif
+        }
+
+        //µĵʱڵ̼߳ƻʱʱŻ(timerfd)ʱmutex_
+        void WakeIfEarlier(int64_t deadline_ns) {
+            if (deadline_ns >= wakeup_ns_) {
+                return;
+            }
+            wakeup_ns_ = deadline_ns;
+            if (dispatch_mode_ == DispatchMode::kCondition) {
+                cond_.notify_one();
+            }
+            else {
+                ArmTimerFd(deadline_ns);
+            }
+        }
+
+#if WZQ_COROUTINE
+        //ָЭ̵ûִоͱʱ(Stopڵ㡢̳߳ؾܾ)ڵǰָ̻߳Э̣ThreadPool::Scheduleһ
+        //ѾStopʱfalseЭ̲
+        bool AddSleep(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point, std::coroutine_handle<> handle) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!running_.load()) {
+                return false;
+            }
+            uint32_t slot = AddNode(ToNanos(time_point), 0, Task(ThreadPool::ScheduleAwaiter::ResumeTask(handle)));
+            WakeIfEarlier(nodes_[slot].Expiry());
+            return true;
+        }
+#endif
+
+        //Stop֮ʱٴûеڵĽڵ㣬ȴеЭʱָ
+        void DropPending() {
+            std::vector<Task> dropped;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                for (uint32_t slot = 0; slot < nodes_.Capacity(); ++slot) {
+                    TimerNode& node = nodes_[slot];
+                    if (node.state == TimerNode::kHeap || node.state == TimerNode::kWheel || node.state == TimerNode::kOverflow) {
+                        Remove(slot);
+                        dropped.push_back(std::move(node.func));
+                        nodes_.Free(slot);
+                    }
                 }
-                AddRepeatedFuncLocal(repeat_num - 1, time, id, std::move(tem_func));
-            };
-            //ڵ㣬ѹ߳
+            }
+        }
+
+        //һ½ڵ㲢ˣʱmutex_
+        uint32_t AddNode(int64_t deadline_ns, int64_t slack_ns, Task&& func) {
+            uint32_t slot = nodes_.Alloc();
+            TimerNode& node = nodes_[slot];
+            node.func = std::move(func);
+            node.deadline_ns = deadline_ns;
+            node.slack_ns = slack_ns;
+            Insert(slot);
+            ++added_num_;
+            return slot;
+        }
+
+        void Insert(uint32_t slot) {
+            if (backend_ == TimerBackend::kWheel) {
+                wheel_.Insert(nodes_, slot);
+            }
+            else {
+                heap_.Push(nodes_, slot);
+            }
+        }
+
+        void Remove(uint32_t slot) {
+            if (backend_ == TimerBackend::kWheel) {
+                wheel_.Remove(nodes_, slot);
+            }
+            else {
+                heap_.Remove(nodes_, slot);
+            }
+        }
+
+        //ӦĶʱǷڵȴʱmutex_
+        bool IsPending(uint32_t slot, uint32_t generation) {
+            if (slot >= nodes_.Capacity()) {
+                return false;
+            }
+            TimerNode& node = nodes_[slot];
+            return node.generation == generation && node.state != TimerNode::kFree && node.state != TimerNode::kCancelled;
+        }
+
+        bool CancelTimer(uint32_t slot, uint32_t generation) {
             std::unique_lock<std::mutex> lock(mutex_);
-            queue_.push(s);
-            lock.unlock();
-            cond_.notify_all();
+            if (!IsPending(slot, generation)) {
+                return false;
+            }
+            ++cancelled_num_;
+            //ڶʱִʱִִ֮߳ͷ
+            TimerNode& node = nodes_[slot];
+            if (node.state == TimerNode::kRunning || node.state == TimerNode::kRescheduled) {
+                node.state = TimerNode::kCancelled;
+                return true;
+            }
+            Remove(slot);
+            nodes_.Free(slot);
+            return true;
+        }
+
+        bool RescheduleTimer(uint32_t slot, uint32_t generation, int64_t deadline_ns) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!IsPending(slot, generation)) {
+                return false;
+            }
+            ++rescheduled_num_;
+            //ڶʱִʱִٰ֮µĵʱŻغ
+            TimerNode& node = nodes_[slot];
+            node.deadline_ns = deadline_ns;
+            if (node.state == TimerNode::kRunning || node.state == TimerNode::kRescheduled) {
+                node.state = TimerNode::kRescheduled;
+                return true;
+            }
+            Remove(slot);
+            Insert(slot);
+            //ʱǰˣҪʱѵ߳¼ȴʱ
+            WakeIfEarlier(node.Expiry());
+            return true;
+        }
+
+        //ȡпԴĽڵ㣬ƵexpiredУڵͷţʱmutex_
+        //slackĶʱϲһûslackĶʱһ
+        void CollectExpired(int64_t now_ns, std::vector<Task>& expired) {
+            if (backend_ == TimerBackend::kWheel) {
+                wheel_.Advance(nodes_, now_ns, expired_slots_);
+                wheel_.TakeEarly(nodes_, now_ns, expired_slots_);
+            }
+            else {
+                heap_.PopExpired(nodes_, now_ns + early_ns_, expired_slots_);
+            }
+            size_t expired_num = expired.size();
+            std::vector<Task> batch;
+            for (uint32_t slot : expired_slots_) {
+                TimerNode& node = nodes_[slot];
+                std::vector<Task>& tasks = node.slack_ns > 0 ? batch : expired;
+                if (node.period_ns == 0) {
+                    tasks.push_back(std::move(node.func));
+                    nodes_.Free(slot);
+                    continue;
+                }
+                //ڶʱڽڵУ̳߳صִֻС񣬿ԷŽTaskڲ
+                node.state = TimerNode::kRunning;
+                if (node.repeat_num > 0) {
+                    --node.repeat_num;
+                }
+                Task* func = &node.func;
+                tasks.push_back(Task([this, slot, func]() { RunPeriodic(slot, func); }));
+            }
+            if (batch.size() == 1) {
+                expired.push_back(std::move(batch[0]));
+            }
+            else if (!batch.empty()) {
+                expired.push_back(Task([batch = std::move(batch)]() mutable {
+                    for (Task& func : batch) {
+                        func();
+                    }
+                }));
+            }
+            fired_num_ += expired_slots_.size();
+            posted_num_ += expired.size() - expired_num;
+            expired_slots_.clear();
         }
 
+        //ʱװ̳߳زPost쳣ص׳쳣ﲶ񲢼¼̳߳ص̵߳std::terminate
+        //ڶʱĽڵҲΪ쳣ͣkRunning״̬֮ճִ
+        template <typename F>
+        struct CatchAllFunc {
+            F func;
+
+            void operator()() {
+                try {
+                    func();
+                }
+                catch (...) {
+                    WZQ_TRACE_ERROR("timer callback threw an exception");
+                }
+            }
+        };
+
+        template <typename F>
+        static CatchAllFunc<typename std::decay<F>::type> MakeCatchAll(F&& f) {
+            return CatchAllFunc<typename std::decay<F>::type>{ std::forward<F>(f) };
+        }
+
+        //ִڶʱȻִзʽһεĵʱ䣬ѽڵŻغ
+        //ڵkRunningڼֻfuncָڼʱȡãdequeеĽڵַı
+        void RunPeriodic(uint32_t slot, Task* func) {
+            (*func)();
+            int64_t now_ns = NowNanos();
+            std::unique_lock<std::mutex> lock(mutex_);
+            TimerNode& node = nodes_[slot];
+            if (node.state == TimerNode::kCancelled || node.repeat_num == 0) {
+                nodes_.Free(slot);
+                return;
+            }
+            if (node.state == TimerNode::kRunning) {
+                RepeatMode mode = static_cast<RepeatMode>(node.repeat_mode);
+                if (mode == RepeatMode::kFixedDelay) {
+                    node.deadline_ns = now_ns + node.period_ns;
+                }
+                else {
+                    node.deadline_ns += node.period_ns;
+                    if (mode == RepeatMode::kFixedRateSkip && node.deadline_ns <= now_ns) {
+                        node.deadline_ns += ((now_ns - node.deadline_ns) / node.period_ns + 1) * node.period_ns;
+                    }
+                }
+            }
+            Insert(slot);
+            WakeIfEarlier(node.Expiry());
+        }
+
+        template <typename R, typename P, typename F, typename... Args>
+        TimerHandle AddPeriodicFuncLocal(RepeatMode mode, int repeat_num, const std::chrono::duration<R, P>& period, F&& f, Args&&... args) {
+            //1룬״һִ֮
+            int64_t period_ns = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(period).count(), 1);
+            Task func(MakeCatchAll(std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+            std::unique_lock<std::mutex> lock(mutex_);
+            uint32_t slot = nodes_.Alloc();
+            TimerNode& node = nodes_[slot];
+            node.func = std::move(func);
+            node.deadline_ns = NowNanos() + period_ns;
+            node.period_ns = period_ns;
+            node.repeat_num = repeat_num;
+            node.repeat_mode = static_cast<uint8_t>(mode);
+            Insert(slot);
+            ++added_num_;
+            WakeIfEarlier(node.Expiry());
+            return TimerHandle(this, slot, node.generation);
+        }
+
+        //һҪʱ䣬ûжʱʱ-1ʱmutex_
+        int64_t NextDeadline() {
+            return backend_ == TimerBackend::kWheel ? wheel_.NextDeadline(nodes_) : heap_.NextDeadline(nodes_);
+        }
+
+        static int64_t ToNanos(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count();
+        }
+
+        static int64_t NowNanos() { return ToNanos(std::chrono::high_resolution_clock::now()); }
+
     private:
-        std::priority_queue<InternalS> queue_;  //ȼУд洢ÿʱʱȳӡ
+        TimerBackend backend_;
+        DispatchMode dispatch_mode_;
+        TimerNodePool nodes_;  //жʱڵ㣬mutex_
+        TimerHeap heap_;  //kHeapˣʱĶѣʱȳ
+        TimerWheel wheel_;  //kWheelˣֲʱ
+        std::vector<uint32_t> expired_slots_;  //CollectExpiredʹõʱ飬ÿ·
+        std::vector<Task> dispatch_tasks_;  //DispatchExpiredʹõʱ飬ֻеȵ̷߳
+        int64_t early_ns_;  //뵽ڲearly_ns_ĶʱֱӴ
+        int64_t wakeup_ns_;  //̼߳ƻʱ䣬ڴڵĶʱʱСֵmutex_
+        int timer_fd_;
+        int epoll_fd_;
+        int64_t armed_ns_;  //timerfdǰõĵʱ䣬-1ʾû
+        //ͳݣmutex_
+        uint64_t added_num_;
+        uint64_t fired_num_;
+        uint64_t cancelled_num_;
+        uint64_t rescheduled_num_;
+        uint64_t wakeup_num_;
+        uint64_t posted_num_;
         std::atomic<bool> running_;
         std::mutex mutex_;  //Ҫִʱ֪ͨڵȴ̴߳ȡִС
         std::condition_variable cond_;
+        std::thread run_thread_;  //̣߳ȴں̳߳
 
         wzq::ThreadPool thread_pool_;  //ִ̳߳С
 
         std::atomic<int> repeated_func_id_;  //ʾѭĵǰִ
-        wzq::ThreadSafeMap<int, RepeatedIdState> repeated_id_state_map_;  //ϣڼ¼ѭִ״̬
+        wzq::ThreadSafeMap<int, TimerHandle> repeated_handle_map_;  //ϣ¼ѭIDӦľ
     };
 
+    inline bool TimerHandle::Cancel() { return queue_ != nullptr && queue_->CancelTimer(slot_, generation_); }
+
+    inline bool TimerHandle::Reschedule(const std::chrono::time_point<std::chrono::high_resolution_clock>& time_point) {
+        return queue_ != nullptr && queue_->RescheduleTimer(slot_, generation_, TimerQueue::ToNanos(time_point));
+    }
+
 } 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,461 @@
+#ifndef __TIMER_WHEEL__
+#define __TIMER_WHEEL__
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "task.h"
+
+/*
+TimerQueueִ洢ˣTimerQueuemutex_
+    TimerHeap: ʱСѣO(log n)ɾǶԵģڵͷźļ¼ڳʱű
+    TimerWheel: 4ֲʱ֣1룬0256Ͱ1~364Ͱ2^26(Լ18.6Сʱ)
+        ʱȡ룬ʱƳ1봥ǰ
+        ԶĶʱȷУʱֵķΧƽɾO(1)
+        ʱͰһȡ߲ͰڶӦʱ·ŵͲ㣻ÿһǿͰλͼ
+        еʱֱҪһһƽ
+        ·ŵĴһƽе1һͰ(256)мʱʱƽҪ룬ͰĶʱҲƳ٣
+        ʱҪ׼ʱʱTimerHeap
+ʱڵTimerNodePoolУ±(slot)ãڵͷʱgeneration1ɵþʧЧˡ
+ֺ˶֧O(1)ɾڵ㣬ɾ֮޸ĵʱ²룬ͬһڵԷȡ
+ʱslack[deadline_ns, deadline_ns + slack_ns]֮䴥ԡ˰ʱ(Expiry)
+ȡڽڵʱ˳ȡʱѾ˵Ľڵ㣬ʱĶʱϲͬһλС
+*/
+
+namespace wzq {
+
+    struct TimerNode {
+        static const uint32_t kNil = 0xffffffff;
+
+        //ڵ㵱ǰССʱС
+        //ڶʱ֮ںУִڼkRunningִڼ䱻ȡµʱΪkCancelledkRescheduled
+        enum State : uint8_t { kFree = 0, kHeap = 1, kWheel = 2, kOverflow = 3, kRunning = 4, kCancelled = 5, kRescheduled = 6 };
+
+        Task func;
+        int64_t deadline_ns = 0;
+        int64_t slack_ns = 0;  //Ƴٴʱ
+        uint32_t generation = 0;
+        //ÿηм1µȺ֮ǰļ¼͹
+        uint32_t version = 0;
+        //ڶʱڣ0ʾһԶʱrepeat_numʣִдС0ʾһֱִ
+        int64_t period_ns = 0;
+        int32_t repeat_num = 0;
+        uint8_t repeat_mode = 0;
+        //ʱͬһͰĽڵ˫ʱnext
+        uint32_t prev = kNil;
+        uint32_t next = kNil;
+        uint16_t bucket = 0;
+        State state = kFree;
+
+        //Ĵʱ䣬˰
+        int64_t Expiry() const { return deadline_ns + slack_ns; }
+    };
+
+    class TimerNodePool {
+    public:
+        TimerNodePool() : free_head_(TimerNode::kNil), used_num_(0) {}
+
+        uint32_t Alloc() {
+            uint32_t slot = free_head_;
+            if (slot != TimerNode::kNil) {
+                free_head_ = nodes_[slot].next;
+                nodes_[slot].next = TimerNode::kNil;
+            }
+            else {
+                slot = static_cast<uint32_t>(nodes_.size());
+                nodes_.emplace_back();
+            }
+            ++used_num_;
+            return slot;
+        }
+
+        //ͷŽڵ㣺еgeneration1֮ǰȫʧЧ
+        void Free(uint32_t slot) {
+            TimerNode& node = nodes_[slot];
+            node.func = Task();
+            node.state = TimerNode::kFree;
+            node.slack_ns = 0;
+            node.period_ns = 0;
+            ++node.generation;
+            node.prev = TimerNode::kNil;
+            node.next = free_head_;
+            free_head_ = slot;
+            --used_num_;
+        }
+
+        TimerNode& operator[](uint32_t slot) { return nodes_[slot]; }
+
+        size_t Size() const { return used_num_; }
+
+        size_t Capacity() const { return nodes_.size(); }
+
+    private:
+        //dequeβԪʱƶеĽڵ㣬ʱҪᶯ
+        std::deque<TimerNode> nodes_;
+        uint32_t free_head_;
+        size_t used_num_;
+    };
+
+    class TimerHeap {
+    public:
+        //stateǽڵʱ״̬ʱ״̬versionԲϵļ¼ѾɾµȹĽڵ
+        explicit TimerHeap(TimerNode::State state) : state_(state), stale_num_(0) {}
+
+        void Push(TimerNodePool& nodes, uint32_t slot) {
+            TimerNode& node = nodes[slot];
+            node.state = state_;
+            ++node.version;
+            heap_.push(Entry{ node.Expiry(), slot, node.version });
+        }
+
+        //ɾеĽڵ㣬ļ¼ʱٶļ¼һʱؽһζѣһֱռڴ
+        //֮ɵͷŽڵ
+        void Remove(TimerNodePool& nodes, uint32_t slot) {
+            nodes[slot].state = TimerNode::kFree;
+            ++stale_num_;
+            if (stale_num_ > kCompactMin && stale_num_ * 2 > heap_.size()) {
+                Compact(nodes);
+            }
+        }
+
+        //絽ڵĽڵ㣬Ϊʱfalse
+        bool Top(TimerNodePool& nodes, uint32_t& slot) {
+            while (!heap_.empty()) {
+                const Entry& entry = heap_.top();
+                if (IsLive(nodes, entry)) {
+                    slot = entry.slot;
+                    return true;
+                }
+                heap_.pop();
+                --stale_num_;
+            }
+            return false;
+        }
+
+        void Pop() { heap_.pop(); }
+
+        //ʱ˳ȡ紥ʱ䲻deadline_nsĽڵ㣬һܴĽڵֹͣ
+        //ʱѾ˵ĽڵһᱻȡĽڵлԴ֮ȡ
+        void PopExpired(TimerNodePool& nodes, int64_t deadline_ns, std::vector<uint32_t>& expired) {
+            uint32_t slot = 0;
+            while (Top(nodes, slot) && nodes[slot].deadline_ns <= deadline_ns) {
+                heap_.pop();
+                expired.push_back(slot);
+            }
+        }
+
+        //ʱ䣬ûнڵʱ-1
+        int64_t NextDeadline(TimerNodePool& nodes) {
+            uint32_t slot = 0;
+            return Top(nodes, slot) ? nodes[slot].Expiry() : -1;
+        }
+
+        size_t Size() const { return heap_.size() - stale_num_; }
+
+    private:
+        static const size_t kCompactMin = 1024;
+
+        struct Entry {
+            int64_t deadline_ns;
+            uint32_t slot;
+            uint32_t version;
+
+            bool operator<(const Entry& b) const { return deadline_ns > b.deadline_ns; }
+        };
+
+        bool IsLive(TimerNodePool& nodes, const Entry& entry) {
+            TimerNode& node = nodes[entry.slot];
+            return node.version == entry.version && node.state == state_;
+        }
+
+        void Compact(TimerNodePool& nodes) {
+            std::vector<Entry> entries;
+            entries.reserve(heap_.size() - stale_num_);
+            while (!heap_.empty()) {
+                if (IsLive(nodes, heap_.top())) {
+                    entries.push_back(heap_.top());
+                }
+                heap_.pop();
+            }
+            heap_ = std::priority_queue<Entry>(std::less<Entry>(), std::move(entries));
+            stale_num_ = 0;
+        }
+
+        TimerNode::State state_;
+        std::priority_queue<Entry> heap_;
+        size_t stale_num_;
+    };
+
+    class TimerWheel {
+    public:
+        static const int64_t kTickNs = 1000000;
+
+        explicit TimerWheel(int64_t now_ns) : current_tick_(TickOf(now_ns)), wheel_num_(0), overflow_(TimerNode::kOverflow) {
+            for (uint32_t& head : heads_) {
+                head = TimerNode::kNil;
+            }
+            for (uint64_t& bits : bits_) {
+                bits = 0;
+            }
+        }
+
+        void Insert(TimerNodePool& nodes, uint32_t slot) {
+            TimerNode& node = nodes[slot];
+            uint64_t tick = std::max(DueTickOf(node.Expiry()), current_tick_);
+            uint64_t delta = tick - current_tick_;
+            if (delta >= kRange) {
+                overflow_.Push(nodes, slot);
+                return;
+            }
+            int bucket = 0;
+            if (delta < kLevel0Size) {
+                bucket = static_cast<int>(tick & (kLevel0Size - 1));
+            }
+            else {
+                int level = 1;
+                while (delta >= (kLevel0Size << (kLevelBits * level))) {
+                    ++level;
+                }
+                bucket = BucketOf(level, tick);
+            }
+            Link(nodes, slot, bucket);
+        }
+
+        //ʱеĽڵֱӴժеĽڵɾ֮ɵͷŽڵ
+        void Remove(TimerNodePool& nodes, uint32_t slot) {
+            TimerNode& node = nodes[slot];
+            if (node.state == TimerNode::kWheel) {
+                Unlink(nodes, slot);
+            }
+            else if (node.state == TimerNode::kOverflow) {
+                overflow_.Remove(nodes, slot);
+            }
+        }
+
+        //ƽnow_nsڵĺ룬ȡڼ䵽ڵнڵ
+        void Advance(TimerNodePool& nodes, int64_t now_ns, std::vector<uint32_t>& expired) {
+            uint64_t now_tick = TickOf(now_ns);
+            while (current_tick_ <= now_tick) {
+                PullOverflow(nodes);
+                uint64_t next_tick = NextEventTick(nodes);
+                if (next_tick > now_tick) {
+                    current_tick_ = now_tick + 1;
+                    PullOverflow(nodes);
+                    break;
+                }
+                current_tick_ = next_tick;
+                //ȰѸ߲㵽ʱͰ·ţȡ0㵱ǰͰ
+                if ((current_tick_ & (kLevel0Size - 1)) == 0) {
+                    for (int level = kLevelNum - 1; level >= 1; --level) {
+                        uint64_t mask = (kLevel0Size << (kLevelBits * (level - 1))) - 1;
+                        if ((current_tick_ & mask) == 0) {
+                            Cascade(nodes, BucketOf(level, current_tick_));
+                        }
+                    }
+                }
+                TakeBucket(nodes, static_cast<int>(current_tick_ & (kLevel0Size - 1)), expired);
+                ++current_tick_;
+            }
+        }
+
+        //Advance֮ãӵ0֮Ͱмȡ紥ʱ䲻now_nsĽڵ㣬
+        //Ͱ˳ȡһûпԴĽڵͰֹͣͰ֮ĽڵԼʱ
+        void TakeEarly(TimerNodePool& nodes, int64_t now_ns, std::vector<uint32_t>& expired) {
+            uint64_t end_tick = current_tick_ + kLevel0Size;
+            for (uint64_t tick = current_tick_; tick < end_tick; ++tick) {
+                int distance = NextSetBit(bits_, static_cast<int>(kLevel0Size), static_cast<int>(tick & (kLevel0Size - 1)));
+                //0ͰֻӦ[current_tick_, current_tick_ + 256)ƻͰٿ
+                if (distance < 0 || tick + distance >= end_tick) {
+                    return;
+                }
+                tick += distance;
+                bool is_taken = false;
+                for (uint32_t slot = heads_[tick & (kLevel0Size - 1)]; slot != TimerNode::kNil;) {
+                    uint32_t next = nodes[slot].next;
+                    if (nodes[slot].deadline_ns <= now_ns) {
+                        Unlink(nodes, slot);
+                        expired.push_back(slot);
+                        is_taken = true;
+                    }
+                    slot = next;
+                }
+                if (!is_taken) {
+                    return;
+                }
+            }
+        }
+
+        //һҪƽʱ(ͰڻҪ·)ûнڵʱ-1
+        int64_t NextDeadline(TimerNodePool& nodes) {
+            uint64_t tick = NextEventTick(nodes);
+            return tick == kNoTick ? -1 : static_cast<int64_t>(tick) * kTickNs;
+        }
+
+        size_t Size() const { return wheel_num_ + overflow_.Size(); }
+
+    private:
+        static const int kLevelNum = 4;
+        static const int kLevelBits = 6;
+        static const uint64_t kLevel0Size = 256;
+        static const uint64_t kLevelSize = 64;
+        static const int kBucketNum = 256 + 64 * 3;
+        static const uint64_t kRange = kLevel0Size << (kLevelBits * (kLevelNum - 1));
+        static const uint64_t kNoTick = UINT64_MAX;
+
+        //nsڵĺ룬ڵǰʱ
+        static uint64_t TickOf(int64_t ns) { return ns > 0 ? static_cast<uint64_t>(ns / kTickNs) : 0; }
+
+        //nsĵһ룬ڽڵĵʱ䣺ڵͰƽʱѾĵʱ䣬ǰ
+        static uint64_t DueTickOf(int64_t ns) { return ns > 0 ? static_cast<uint64_t>((ns + kTickNs - 1) / kTickNs) : 0; }
+
+        //level(>=1)tickڵͰ
+        static int BucketOf(int level, uint64_t tick) {
+            int shift = 8 + kLevelBits * (level - 1);
+            return static_cast<int>(kLevel0Size + kLevelSize * (level - 1) + ((tick >> shift) & (kLevelSize - 1)));
+        }
+
+        void Link(TimerNodePool& nodes, uint32_t slot, int bucket) {
+            TimerNode& node = nodes[slot];
+            node.state = TimerNode::kWheel;
+            node.bucket = static_cast<uint16_t>(bucket);
+            node.prev = TimerNode::kNil;
+            node.next = heads_[bucket];
+            if (node.next != TimerNode::kNil) {
+                nodes[node.next].prev = slot;
+            }
+            heads_[bucket] = slot;
+            bits_[bucket / 64] |= uint64_t(1) << (bucket % 64);
+            ++wheel_num_;
+        }
+
+        void Unlink(TimerNodePool& nodes, uint32_t slot) {
+            TimerNode& node = nodes[slot];
+            if (node.prev != TimerNode::kNil) {
+                nodes[node.prev].next = node.next;
+            }
+            else {
+                heads_[node.bucket] = node.next;
+            }
+            if (node.next != TimerNode::kNil) {
+                nodes[node.next].prev = node.prev;
+            }
+            if (heads_[node.bucket] == TimerNode::kNil) {
+                bits_[node.bucket / 64] &= ~(uint64_t(1) << (node.bucket % 64));
+            }
+            node.prev = TimerNode::kNil;
+            node.next = TimerNode::kNil;
+            node.state = TimerNode::kFree;
+            --wheel_num_;
+        }
+
+        //Ͱժͷ
+        uint32_t Detach(int bucket) {
+            uint32_t head = heads_[bucket];
+            heads_[bucket] = TimerNode::kNil;
+            bits_[bucket / 64] &= ~(uint64_t(1) << (bucket % 64));
+            return head;
+        }
+
+        void TakeBucket(TimerNodePool& nodes, int bucket, std::vector<uint32_t>& expired) {
+            for (uint32_t slot = Detach(bucket); slot != TimerNode::kNil;) {
+                TimerNode& node = nodes[slot];
+                uint32_t next = node.next;
+                node.prev = TimerNode::kNil;
+                node.next = TimerNode::kNil;
+                node.state = TimerNode::kFree;
+                --wheel_num_;
+                expired.push_back(slot);
+                slot = next;
+            }
+        }
+
+        //߲Ͱʱʣʱ·Ͳ㣻ժͰ·ŻͬһͰĽڵҪһȦ
+        void Cascade(TimerNodePool& nodes, int bucket) {
+            for (uint32_t slot = Detach(bucket); slot != TimerNode::kNil;) {
+                uint32_t next = nodes[slot].next;
+                --wheel_num_;
+                Insert(nodes, slot);
+                slot = next;
+            }
+        }
+
+        //нʱַΧĽڵƵʱ
+        void PullOverflow(TimerNodePool& nodes) {
+            uint32_t slot = 0;
+            while (overflow_.Top(nodes, slot) && DueTickOf(nodes[slot].Expiry()) < current_tick_ + kRange) {
+                overflow_.Pop();
+                Insert(nodes, slot);
+            }
+        }
+
+        //fromʼ(ѭ)ҵһǿյͰfromľ룬ûʱ-1size64ı
+        static int NextSetBit(const uint64_t* bits, int size, int from) {
+            int word_num = size / 64;
+            int first_word = from / 64;
+            //ȿfromڵfrom֮λο֣صfromڵfrom֮ǰλ
+            for (int i = 0; i <= word_num; ++i) {
+                int word = (first_word + i) % word_num;
+                uint64_t masked = bits[word];
+                if (i == 0) {
+                    masked &= ~uint64_t(0) << (from % 64);
+                }
+                else if (i == word_num) {
+                    masked &= ~(~uint64_t(0) << (from % 64));
+                }
+                if (masked != 0) {
+                    int found = word * 64 + CountTrailingZeros(masked);
+                    return (found - from + size) % size;
+                }
+            }
+            return -1;
+        }
+
+        static int CountTrailingZeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(value);
+#else
+            int n = 0;
+            for (uint64_t bit = 1; (value & bit) == 0; bit <<= 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+
+        uint64_t NextEventTick(TimerNodePool& nodes) {
+            uint64_t best = kNoTick;
+            int distance = NextSetBit(bits_, static_cast<int>(kLevel0Size), static_cast<int>(current_tick_ & (kLevel0Size - 1)));
+            if (distance >= 0) {
+                best = current_tick_ + distance;
+            }
+            for (int level = 1; level < kLevelNum; ++level) {
+                int shift = 8 + kLevelBits * (level - 1);
+                const uint64_t* bits = &bits_[(kLevel0Size + kLevelSize * (level - 1)) / 64];
+                //һͰֻڵshiftλΪ0ʱ·ţbasecurrent_tick_֮һʱ
+                uint64_t base = (current_tick_ + (uint64_t(1) << shift) - 1) >> shift;
+                distance = NextSetBit(bits, static_cast<int>(kLevelSize), static_cast<int>(base & (kLevelSize - 1)));
+                if (distance >= 0) {
+                    best = std::min(best, (base + distance) << shift);
+                }
+            }
+            uint32_t slot = 0;
+            if (overflow_.Top(nodes, slot)) {
+                uint64_t tick = DueTickOf(nodes[slot].Expiry());
+                best = std::min(best, std::max(tick - kRange + 1, current_tick_));
+            }
+            return best;
+        }
+
+        uint64_t current_tick_;  //һҪĺ
+        size_t wheel_num_;
+        uint32_t heads_[kBucketNum];
+        uint64_t bits_[kBucketNum / 64];
+        TimerHeap overflow_;
+    };
+}  // namespace wzq
+
+#endif
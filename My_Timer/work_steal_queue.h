@@ -0,0 +1,132 @@
+#ifndef __WORK_STEAL_QUEUE__
+#define __WORK_STEAL_QUEUE__
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace wzq {
+
+    /**
+     * ȡ˫˶УChase-Lev deque
+     * ֻӵ߳̿ԵPush/PopڶβbottomȳѺã
+     * ̵߳StealӶͷtopȡȽȳֻںӵһԪʱҪCAS
+     * ԪҪܷŽstd::atomic̳߳ŵָ롣
+     */
+    template <typename T>
+    class WorkStealQueue {
+        static_assert(std::is_trivially_copyable<T>::value, "WorkStealQueue element must be trivially copyable");
+
+        //飬Ϊ2ݣʱһС
+        struct Array {
+            int64_t capacity;
+            int64_t mask;
+            std::atomic<T>* data;
+
+            explicit Array(int64_t cap) : capacity(cap), mask(cap - 1), data(new std::atomic<T>[cap]) {}
+            ~Array() { delete[] data; }
+
+            void Put(int64_t i, T item) { data[i & mask].store(item, std::memory_order_relaxed); }
+            T Get(int64_t i) { return data[i & mask].load(std::memory_order_relaxed); }
+
+            Array* Resize(int64_t bottom, int64_t top) {
+                Array* new_array = new Array(capacity * 2);
+                for (int64_t i = top; i != bottom; ++i) {
+                    new_array->Put(i, Get(i));
+                }
+                return new_array;
+            }
+        };
+
+    public:
+        explicit WorkStealQueue(int64_t capacity = 256) {
+            int64_t cap = 1;
+            while (cap < capacity) {
+                cap <<= 1;
+            }
+            top_.store(0);
+            bottom_.store(0);
+            array_.store(new Array(cap));
+        }
+
+        WorkStealQueue(const WorkStealQueue&) = delete;
+        WorkStealQueue& operator=(const WorkStealQueue&) = delete;
+
+        //ܻڱȡ߶ȡݺͷţͳһʱ
+        ~WorkStealQueue() {
+            for (Array* a : garbage_) {
+                delete a;
+            }
+            delete array_.load();
+        }
+
+        //ӵ߳ڶβԪ
+        void Push(T item) {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            Array* a = array_.load(std::memory_order_relaxed);
+            if (b - t > a->capacity - 1) {
+                Array* new_array = a->Resize(b, t);
+                garbage_.push_back(a);
+                a = new_array;
+                array_.store(a, std::memory_order_release);
+            }
+            a->Put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+
+        //ӵ̴߳ӶβȡԪ
+        bool Pop(T& item) {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* a = array_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            item = a->Get(b);
+            if (t == b) {
+                //ֻʣһԪأȡ߾
+                bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        //̴߳ӶͷȡԪأʧܷfalse÷Իһ
+        bool Steal(T& item) {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b) {
+                return false;
+            }
+            Array* a = array_.load(std::memory_order_acquire);
+            item = a->Get(t);
+            return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        //ƴСֻжǷ͵֤ȷ
+        int64_t Size() const {
+            int64_t b = bottom_.load(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_seq_cst);
+            return b > t ? b - t : 0;
+        }
+
+        bool Empty() const { return Size() == 0; }
+
+    private:
+        std::atomic<int64_t> top_;
+        std::atomic<int64_t> bottom_;
+        std::atomic<Array*> array_;
+        std::vector<Array*> garbage_;
+    };
+
+}  // namespace wzq
+
+#endif
@@ -11,29 +11,101 @@
 #ifndef __THREAD_POOL__
 #define __THREAD_POOL__
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <condition_variable>
+#include <exception>
 #include <functional>
 #include <future>
-#include <iostream>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
-using std::cout;
-using std::endl;
+#include "bounded_queue.h"
+#include "cancellation.h"
+#include "coroutine.h"
+#include "cpu_topology.h"
+#include "event_count.h"
+#include "latency_histogram.h"
+#include "slab_allocator.h"
+#include "task.h"
+#include "trace.h"
+#include "work_steal_queue.h"
 
 namespace wzq {
 
     class ThreadPool {
     public:
         using PoolSeconds = std::chrono::seconds;
+        using PoolMilliseconds = std::chrono::milliseconds;
+
+        /**
+         * 任务的调度模式
+         * kGlobalQueue: 所有线程共用一个全局任务队列，由task_mutex_保护
+         * kWorkStealing: 每个线程有自己的无锁本地队列，线程内部提交的任务放入本地队列，外部提交的任务放入全局注入队列，
+         * 空闲线程会去其他线程的本地队列中窃取任务
+         */
+        enum class ScheduleMode { kGlobalQueue = 0, kWorkStealing = 1 };
+
+        /**
+         * 任务队列满时Run的处理策略
+         * kBlock: 阻塞提交任务的线程，直到队列有空位（线程池中的线程提交时改为由自己执行，避免所有线程互相等待）
+         * kReject: 拒绝任务，Run返回nullptr
+         * kCallerRuns: 由提交任务的线程直接执行
+         * kDiscardOldest: 丢弃队列中最早的任务，被丢弃任务的future会得到broken_promise异常，
+         * 任务要放入的通道中没有可以丢弃的任务(名额被其他通道或者本地队列占用)时改为由提交任务的线程执行
+         */
+        enum class OverflowPolicy { kBlock = 0, kReject = 1, kCallerRuns = 2, kDiscardOldest = 3 };
+
+        /**
+         * 任务的优先级，对应线程池内置的三条任务通道(id为0、1、2，权重为16、4、1)，Run/Submit/Post的任务放入kNormal通道
+         */
+        enum class TaskPriority { kHigh = 0, kNormal = 1, kLow = 2 };
+
+        /**
+         * 多条任务通道之间的调度策略
+         * kStrictPriority: 总是先取权重最大的非空通道中的任务
+         * kWeightedFair: 按照权重的比例轮流从各个通道中取任务
+         * 两种策略下，非空的通道超过starvation_time没有被取过任务时都会被优先处理，避免低优先级的任务饿死
+         */
+        enum class LanePolicy { kStrictPriority = 0, kWeightedFair = 1 };
+
+        /**
+         * 线程的CPU绑定方式，只在Linux下生效，其他平台上线程不做绑定
+         * kNone: 不绑定，由操作系统调度
+         * kCpuList: 第i个创建的线程绑定到cpu_list[i % cpu_list.size()]这一个CPU上
+         * kSpread: 线程轮流绑定到各个NUMA节点上，可以在节点内的所有CPU上运行
+         * kCompact: 所有线程都绑定到numa_node这一个节点上
+         */
+        enum class AffinityMode { kNone = 0, kCpuList = 1, kSpread = 2, kCompact = 3 };
+
+        /**
+         * 线程没有任务可执行时的等待方式
+         * kBlock: 直接在task_cv_上等待，由条件变量唤醒
+         * kSpinThenPark: 先用pause指令自旋spin_count次，再让出CPU yield_count次，仍然没有任务才在事件计数(Linux下是futex)上睡眠，
+         * 提交任务时只唤醒需要的线程个数，任务密集时线程基本不会睡眠，省掉了唤醒和上下文切换的开销，代价是空闲时多占一点CPU；
+         * 同时自旋的线程不超过CPU个数的一半，只有一个CPU时不自旋，直接睡眠
+         */
+        enum class IdlePolicy { kBlock = 0, kSpinThenPark = 1 };
+
+        /**
+         * 线程个数的伸缩方式，线程数总是在[core_threads, max_threads]之间
+         * kOnDemand: 提交任务时没有空闲线程就创建一个Cache线程，Cache线程空闲超过time_out后退出
+         * kAutoScale: 由后台的伸缩线程每隔scale_interval采样一次排队时间和线程利用率，
+         * 有任务排队并且这段时间内排队时间的p99达到scale_up_wait(或者一个任务都没能开始执行)时立即扩容，最多把线程数翻倍；
+         * 连续scale_down_samples次采样的利用率都低于scale_down_utilization%时，一次性让多余的空闲Cache线程退出。
+         * 扩容和缩容的条件之间留有间隔，线程数不会在两者之间来回抖动
+         */
+        enum class ScalePolicy { kOnDemand = 0, kAutoScale = 1 };
 
         /** 线程池的配置
          * core_threads:核心线程个数，线程池中拥有的最小线程个数，初始化就会创建好的线程，常驻与线程池
@@ -41,16 +113,139 @@ namespace wzq {
          * max_threads: >= core_threads，当任务的个数太多线程池执行不过来时，内部就会创建更多的线程用于执行更多的任务
          * 内部线程数不会超过max_threads
          *
-         * max_task_size: 内部允许存储的最大任务个数，暂时没有使用
+         * max_task_size: 内部允许存储的最大任务个数，大于0时使用有界无锁队列存储任务，<=0表示不限制，线程池启动后不能修改，
+         * 这是整个线程池的上限，所有任务通道、NUMA节点队列和工作窃取的本地队列中排队的任务加起来不超过它
          *
          * time_out: Cache线程的超时时间，Cache线程指的是max_threads-core_threads的线程，当time_out时间内没有执行任务，
          * 此线程就被自动回收
+         *
+         * schedule_mode: 任务调度模式，默认使用全局队列，线程池启动后不能修改
+         *
+         * overflow_policy: 任务个数达到max_task_size时Run的处理策略，默认阻塞等待
+         *
+         * lane_policy: 多条任务通道之间的调度策略，默认严格按照优先级
+         *
+         * starvation_time: 通道中的任务等待超过这个时间就优先处理，<=0表示不做防饿死处理
+         *
+         * affinity/cpu_list/numa_node: 线程的CPU绑定方式，以及kCpuList使用的CPU列表和kCompact使用的节点，只影响之后创建的线程
+         *
+         * idle_policy/spin_count/yield_count: 线程空闲时的等待方式以及自旋和让出CPU的次数，idle_policy在线程池启动后不能修改
+         *
+         * scale_policy/scale_interval/scale_up_wait/scale_down_utilization/scale_down_samples: 线程个数的伸缩方式和自动伸缩的参数，
+         * scale_policy在线程池启动后不能修改
          */
         struct ThreadPoolConfig {
             int core_threads;
             int max_threads;
             int max_task_size;
             PoolSeconds time_out;
+            ScheduleMode schedule_mode = ScheduleMode::kGlobalQueue;
+            OverflowPolicy overflow_policy = OverflowPolicy::kBlock;
+            LanePolicy lane_policy = LanePolicy::kStrictPriority;
+            PoolMilliseconds starvation_time = PoolMilliseconds(100);
+            AffinityMode affinity = AffinityMode::kNone;
+            std::vector<int> cpu_list{};
+            int numa_node = 0;
+            IdlePolicy idle_policy = IdlePolicy::kBlock;
+            int spin_count = 1000;
+            int yield_count = 10;
+            ScalePolicy scale_policy = ScalePolicy::kOnDemand;
+            PoolMilliseconds scale_interval = PoolMilliseconds(10);
+            PoolMilliseconds scale_up_wait = PoolMilliseconds(2);
+            int scale_down_utilization = 50;
+            int scale_down_samples = 20;
+        };
+
+        /**
+         * 任务通道的统计信息
+         * depth: 当前排队的任务个数
+         * popped_num: 已经被取出执行的任务个数
+         * avg_wait_us/p99_wait_us/max_wait_us: 任务从放入通道到被取出的等待时间(微秒)，p99由对数线性直方图估算，误差不超过1/16
+         */
+        struct LaneStats {
+            std::string name;
+            int weight;
+            size_t depth;
+            uint64_t popped_num;
+            uint64_t avg_wait_us;
+            uint64_t p99_wait_us;
+            uint64_t max_wait_us;
+        };
+
+        /**
+         * ShutDown/ShutDownNow的结果
+         * completed_num: 从开始关闭到返回期间执行完的任务个数
+         * dropped_num: 从开始关闭到返回期间没有执行就被丢弃的任务个数，包括被取消或者超过截止时间而跳过的任务，这些任务的future会得到broken_promise异常
+         * is_finished: 返回时所有线程是否都已经退出并回收，超过timeout时为false，这时队列中剩余的任务会被丢弃，
+         * 正在执行的任务会继续执行完，线程在析构函数中回收
+         */
+        struct ShutDownStats {
+            uint64_t completed_num;
+            uint64_t dropped_num;
+            bool is_finished;
+        };
+
+        /**
+         * 单个线程的统计信息
+         * executed_num: 执行过的任务个数
+         * busy_ns/idle_ns: 线程启动以来执行任务的时间和没有在执行任务的时间(纳秒)，idle_ns/(busy_ns+idle_ns)就是线程的空闲率
+         * steal_num: 从其他线程的本地队列偷到的任务个数
+         * wakeup_num: 线程进入等待后被唤醒的次数
+         * local_depth: 本地队列中排队的任务个数，只有工作窃取模式下才不为0
+         */
+        struct WorkerStats {
+            int id;
+            bool is_core;
+            int numa_node;
+            uint64_t executed_num;
+            uint64_t busy_ns;
+            uint64_t idle_ns;
+            uint64_t steal_num;
+            uint64_t wakeup_num;
+            size_t local_depth;
+        };
+
+        /**
+         * 线程池的统计快照，各项数据是分别读取的，彼此之间不保证严格一致
+         * queue_depth: 所有任务通道、NUMA节点队列和本地队列中排队的任务个数
+         * submitted_num/executed_num/rejected_num: 提交成功、已经执行完以及被拒绝或丢弃的任务个数
+         * skipped_num: 出队时已经被取消或者超过截止时间，没有执行就被丢弃的任务个数
+         * blocking_threads: 正在ScopedBlocking中阻塞的线程个数，compensated_num: 为阻塞的线程补偿线程的次数
+         * slab: 任务节点和放不进Task缓冲区的可调用对象所用的slab分配器的统计，整个进程的所有线程池共用，见slab_allocator.h
+         * queue_latency: 任务从放入队列到开始执行的时间(纳秒)，run_time: 任务的执行时间(纳秒)，
+         * 两者只统计线程池中的线程执行的任务，kCallerRuns时由提交线程执行的任务只计入executed_num
+         * busy_ns: 所有线程执行任务的总时间(纳秒)
+         * executed_num/busy_ns/steal_num/wakeup_num/queue_latency/run_time包含已经退出的线程，只会增加
+         */
+        struct PoolStats {
+            int total_threads;
+            int waiting_threads;
+            int blocking_threads;
+            size_t queue_depth;
+            uint64_t submitted_num;
+            uint64_t executed_num;
+            uint64_t rejected_num;
+            uint64_t skipped_num;
+            uint64_t compensated_num;
+            uint64_t busy_ns;
+            uint64_t steal_num;
+            uint64_t wakeup_num;
+            HistogramSnapshot queue_latency;
+            HistogramSnapshot run_time;
+            std::vector<WorkerStats> workers;
+            std::vector<LaneStats> lanes;
+            SlabStats slab;
+        };
+
+        /**
+         * RunWith/SubmitWith/PostWith提交任务时的选项
+         * token: 任务出队时token已经被取消就直接丢弃，不会被调用；任务执行期间可以用CancellationToken::Current()轮询
+         * deadline: 任务出队时已经超过截止时间也直接丢弃，默认没有截止时间
+         * 丢弃的任务计入GetSkippedFuncNum()，RunWith/SubmitWith得到的future会收到broken_promise异常
+         */
+        struct TaskOptions {
+            CancellationToken token;
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
         };
 
         /**
@@ -68,20 +263,91 @@ namespace wzq {
         using ThreadStateAtomic = std::atomic<ThreadState>;
         using ThreadFlagAtomic = std::atomic<ThreadFlag>;
 
+        /**
+         * 在队列中排队的任务，记录放入的时间(纳秒)用于统计排队时间
+         * 带TaskOptions提交的任务还记录截止时间(纳秒，0表示没有)和取消token，出队时检查
+         */
+        struct QueuedTask {
+            Task task;
+            int64_t enqueue_ns;
+            int64_t deadline_ns;
+            CancellationToken token;
+
+            QueuedTask() : enqueue_ns(0), deadline_ns(0) {}
+            QueuedTask(Task&& t, int64_t ns, const TaskOptions* options = nullptr) : task(std::move(t)), enqueue_ns(ns), deadline_ns(0) {
+                if (options != nullptr) {
+                    token = options->token;
+                    if (options->deadline != std::chrono::steady_clock::time_point::max()) {
+                        deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(options->deadline.time_since_epoch()).count();
+                    }
+                }
+            }
+        };
+
+        /**
+         * 线程自己记录的统计数据，只有所属的线程会写，GetStats时其他线程只读，所以计数器不需要原子的读改写操作
+         * 前后各填充一个缓存行，不会和其他线程频繁读写的数据落在同一个缓存行上
+         */
+        struct WorkerCounters {
+            static const size_t kCacheLineSize = 64;
+
+            char pad0[kCacheLineSize];
+            std::atomic<uint64_t> executed_num;
+            std::atomic<uint64_t> busy_ns;
+            std::atomic<uint64_t> steal_num;
+            std::atomic<uint64_t> wakeup_num;
+            std::atomic<int64_t> start_ns;
+            LatencyHistogram queue_latency;
+            LatencyHistogram run_time;
+            char pad1[kCacheLineSize];
+
+            WorkerCounters() : executed_num(0), busy_ns(0), steal_num(0), wakeup_num(0), start_ns(0) {}
+
+            void OnRun(int64_t wait_ns, int64_t run_ns) {
+                Add(executed_num, 1);
+                Add(busy_ns, static_cast<uint64_t>(run_ns));
+                queue_latency.RecordLocal(static_cast<uint64_t>(std::max<int64_t>(wait_ns, 0)));
+                run_time.RecordLocal(static_cast<uint64_t>(run_ns));
+            }
+
+            static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+                counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+        };
+
         /**
          * 线程池中存在的基本单位，每个线程都有个自定义ID，有线程种类标识和状态
+         * local_tasks是工作窃取模式下线程自己的任务队列，只有本线程会放入任务，其他线程只能窃取
          */
         struct ThreadWrapper {
             ThreadPtr ptr;
             ThreadId id;
             ThreadFlagAtomic flag;
             ThreadStateAtomic state;
+            std::unique_ptr<WorkStealQueue<QueuedTask*>> local_tasks;
+            unsigned int steal_index;
+            int numa_node;
+            std::atomic<bool> is_retiring;  //Resize要求线程退出，线程下次空闲时看到后退出
+            int blocking_depth;  //ScopedBlocking的嵌套层数，只有本线程读写
+            WorkerCounters counters;
 
 
             ThreadWrapper() {
                 ptr = nullptr;
                 id = 0;
                 state.store(ThreadState::kInit);
+                steal_index = 0;
+                numa_node = -1;
+                is_retiring.store(false);
+                blocking_depth = 0;
+            }
+
+            //ShutDownNow后本地队列中可能还残留没有执行的任务
+            ~ThreadWrapper() {
+                QueuedTask* task = nullptr;
+                while (local_tasks != nullptr && local_tasks->Pop(task)) {
+                    SlabDelete(task);
+                }
             }
         };
 
@@ -90,12 +356,30 @@ namespace wzq {
 
         //线程池的初始化:
         //在构造函数中将各个成员变量都附初值
-        ThreadPool(ThreadPoolConfig config) : config_(config) {
+        ThreadPool(ThreadPoolConfig config) : config_(config), node_lanes_(CpuTopology::Get().NodeNum()) {
             this->total_function_num_.store(0);
             this->waiting_thread_num_.store(0);
+            this->spinning_thread_num_.store(0);
+            this->blocked_producer_num_.store(0);
+            this->queued_task_num_.store(0);
+            this->rejected_function_num_.store(0);
+            this->caller_executed_num_.store(0);
+            this->skipped_function_num_.store(0);
+            this->blocking_thread_num_.store(0);
+            this->surplus_thread_num_.store(0);
+            this->compensating_thread_num_.store(0);
+            this->compensated_num_.store(0);
+            this->dropped_function_num_.store(0);
             this->thread_id_.store(0);
             this->is_shutdown_.store(false);
             this->is_shutdown_now_.store(false);
+            this->fair_cursor_.store(0);
+            CreateLane("high", 16);
+            CreateLane("normal", 4);
+            CreateLane("low", 1);
+            for (auto& lane : this->node_lanes_) {
+                lane.store(nullptr);
+            }
             if (IsValidConfig(config_)) {
                 is_aviailable_.store(true);
             }
@@ -104,7 +388,13 @@ namespace wzq {
             }
         }
 
-        ~ThreadPool() { ShutDown(); }
+        //析构时等待队列中的任务执行完，所有线程退出并join之后才返回
+        ~ThreadPool() {
+            ShutDown();
+            for (auto& lane : this->node_lanes_) {
+                delete lane.load();
+            }
+        }
            
         //重启线程池
          bool Reset(ThreadPoolConfig config) {
@@ -114,6 +404,10 @@ namespace wzq {
             if (config_.core_threads != config.core_threads) {
                 return false;
             }
+            if (config_.schedule_mode != config.schedule_mode || config_.max_task_size != config.max_task_size ||
+                config_.idle_policy != config.idle_policy || config_.scale_policy != config.scale_policy) {
+                return false;
+            }
             config_ = config;
             return true;
          }
@@ -127,50 +421,395 @@ namespace wzq {
                 return false;
             }
             int core_thread_num = config_.core_threads;
-            cout << "Init thread num " << core_thread_num << endl;
+            WZQ_TRACE_INFO("init thread num", core_thread_num);
             while (core_thread_num-- > 0) {
                 AddThread(GetNextThreadId());
             }
-            cout << "Init thread end" << endl;
+            if (config_.scale_policy == ScalePolicy::kAutoScale) {
+                this->scaler_thread_ = std::thread([this]() { this->ScaleLoop(); });
+            }
+            WZQ_TRACE_INFO("init thread end");
             return true;
         }
 
         //如何获取当前线程池中线程的总个数？
-        int GetTotalThreadSize() { return this->worker_threads_.size(); }
+        int GetTotalThreadSize() {
+            ThreadPoolLock lock(this->worker_mutex_);
+            return this->worker_threads_.size();
+        }
 
         //如何获取当前线程池中空闲线程的个数？
         int GetWaitingThreadSize() { return this->waiting_thread_num_.load(); }
 
+        //正在ScopedBlocking中阻塞的线程个数
+        int GetBlockingThreadSize() { return this->blocking_thread_num_.load(); }
+
         //如何将任务放入线程池中执行？
-        //见如下代码，将任务使用std::bind封装成std::function放入任务队列中，
+        //见如下代码，将任务使用std::bind封装成Task放入任务队列中，
         //任务较多时内部还会判断是否有空闲线程，如果没有空闲线程，会自动创建出最多(max_threads-core_threads)个Cache线程用于执行任务。
+        //工作窃取模式下，如果是线程池中的线程在任务里继续提交任务，任务会放入该线程的本地队列，不再竞争task_mutex_
 
         //放在线程池中执行函数
         template <typename F, typename... Args>
         auto Run(F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
-            if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
+            using return_type = std::result_of_t<F(Args...)>;
+            std::future<return_type> res = Submit(std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
                 return nullptr;
             }
-            if (GetWaitingThreadSize() == 0 && GetTotalThreadSize() < config_.max_threads) {
-                AddThread(GetNextThreadId(), ThreadFlag::kCache);
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
+
+        // 和Run一样，但是直接返回std::future，线程池不可用或任务被拒绝时返回的future是无效的(valid()==false)
+        // packaged_task直接放进Task的内部缓冲区，整个提交过程只有packaged_task共享状态这一次内存分配
+        template <typename F, typename... Args>
+        auto Submit(F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            return SubmitOnLane(kNormalLane, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        // 只执行不关心结果的任务，不创建future，可调用对象不超过Task::kInlineSize字节时提交过程不申请堆内存
+        // 任务中抛出的异常没有地方接收，Post的任务不能抛出异常
+        template <typename F, typename... Args>
+        bool Post(F&& f, Args &&... args) {
+            return PostOnLane(kNormalLane, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        // 以下三个函数和Run/Submit/Post一样，只是任务带上options中的取消token和截止时间，
+        // 出队时已经被取消或者超过截止时间的任务不会被调用，见TaskOptions
+        template <typename F, typename... Args>
+        auto RunWith(const TaskOptions& options, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
+            using return_type = std::result_of_t<F(Args...)>;
+            std::future<return_type> res = SubmitWith(options, std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
+                return nullptr;
+            }
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
+
+        template <typename F, typename... Args>
+        auto SubmitWith(const TaskOptions& options, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            return SubmitToLane(*this->lanes_[kNormalLane], &options, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        bool PostWith(const TaskOptions& options, F&& f, Args &&... args) {
+            return PostToLane(*this->lanes_[kNormalLane], &options, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+#if WZQ_COROUTINE
+        // 协程中co_await pool.Schedule()把当前协程挂起，放到线程池的线程中继续执行
+        // 恢复协程的任务里只有协程句柄，直接放在Task的缓冲区里，不申请堆内存；线程池不可用或者任务被拒绝时不挂起，在当前线程继续执行
+        // 任务进入队列之后又被丢弃（ShutDownNow、kDiscardOldest、线程退出时清理）时，在丢弃它的线程中恢复协程，协程帧不会泄漏，SyncWait也不会一直等下去
+        struct ScheduleAwaiter {
+            ThreadPool* pool;
+
+            bool await_ready() const noexcept { return false; }
+
+            // 恢复协程的任务，只能移动。没有执行就被析构时在当前线程恢复协程
+            struct ResumeTask {
+                std::coroutine_handle<> handle;
+
+                explicit ResumeTask(std::coroutine_handle<> h) noexcept : handle(h) {}
+                ResumeTask(ResumeTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+                ResumeTask(const ResumeTask&) = delete;
+                ResumeTask& operator=(const ResumeTask&) = delete;
+                ResumeTask& operator=(ResumeTask&&) = delete;
+
+                // Post还没返回就在提交线程里被析构，是任务被同步拒绝，交给await_suspend返回false继续执行，这里不能再恢复一次
+                ~ResumeTask() {
+                    if (handle && PostingHandle() != handle.address()) {
+                        handle.resume();
+                    }
+                }
+
+                void operator()() { std::exchange(handle, nullptr).resume(); }
+            };
+
+            // 当前线程正在Post的协程句柄
+            static void*& PostingHandle() {
+                static thread_local void* posting_handle = nullptr;
+                return posting_handle;
+            }
+
+            // Post成功之后协程可能已经在其他线程中恢复执行，不能再访问协程帧里的任何东西，包括awaiter自己
+            bool await_suspend(std::coroutine_handle<> handle) {
+                void*& posting_handle = PostingHandle();
+                void* saved_handle = posting_handle;
+                posting_handle = handle.address();
+                bool is_posted = pool->Post(ResumeTask(handle));
+                posting_handle = saved_handle;
+                return is_posted;
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        ScheduleAwaiter Schedule() { return ScheduleAwaiter{this}; }
+#endif
+
+        // 添加一条自定义的任务通道，返回通道id，weight(1~100)越大越优先，严格优先级调度时同权重的通道按添加顺序排列
+        // 通道需要在Start之前添加，同名的通道已经存在、权重不合法或者线程池已经有线程时返回-1
+        int AddLane(const std::string& name, int weight) {
+            if (weight < 1 || weight > kMaxLaneWeight || GetLaneId(name) >= 0 || GetTotalThreadSize() > 0) {
+                return -1;
+            }
+            return CreateLane(name, weight);
+        }
+
+        // 根据名字查找任务通道的id，不存在时返回-1
+        int GetLaneId(const std::string& name) {
+            for (size_t i = 0; i < this->lanes_.size(); ++i) {
+                if (this->lanes_[i]->name == name) {
+                    return static_cast<int>(i);
+                }
             }
+            return -1;
+        }
+
+        // 以下三组函数和Run/Submit/Post一样，只是把任务放入指定的任务通道，通道id不存在时按照提交失败处理
+        template <typename F, typename... Args>
+        auto RunOnLane(int lane_id, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
             using return_type = std::result_of_t<F(Args...)>;
-            auto task = std::make_shared<std::packaged_task<return_type()>>(
-                std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-            total_function_num_++;
+            std::future<return_type> res = SubmitOnLane(lane_id, std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
+                return nullptr;
+            }
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
 
-            std::future<return_type> res = task->get_future();
-            {
+        template <typename F, typename... Args>
+        auto RunOnLane(TaskPriority priority, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
+            return RunOnLane(static_cast<int>(priority), std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        auto SubmitOnLane(int lane_id, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            if (!IsValidLane(lane_id)) {
+                return std::future<std::result_of_t<F(Args...)>>();
+            }
+            return SubmitToLane(*this->lanes_[lane_id], nullptr, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        auto SubmitOnLane(TaskPriority priority, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            return SubmitOnLane(static_cast<int>(priority), std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        bool PostOnLane(int lane_id, F&& f, Args &&... args) {
+            if (!IsValidLane(lane_id)) {
+                return false;
+            }
+            return PostToLane(*this->lanes_[lane_id], nullptr, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        bool PostOnLane(TaskPriority priority, F&& f, Args &&... args) {
+            return PostOnLane(static_cast<int>(priority), std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        // 获取NUMA节点的个数，RunOnNode等函数的node参数范围是[0, GetNumaNodeNum())，不是NUMA架构的机器上只有一个节点
+        int GetNumaNodeNum() { return static_cast<int>(this->node_lanes_.size()); }
+
+        // 以下三个函数把任务放入指定NUMA节点的任务队列，绑定在这个节点上的线程会先执行本节点队列中的任务，
+        // 其他线程没有别的任务可做时也会帮忙执行，所以节点上没有线程时任务也不会一直得不到执行；节点不存在时按照提交失败处理
+        template <typename F, typename... Args>
+        auto RunOnNode(int node, F&& f, Args &&... args) -> std::shared_ptr<std::future<std::result_of_t<F(Args...)>>> {
+            using return_type = std::result_of_t<F(Args...)>;
+            std::future<return_type> res = SubmitOnNode(node, std::forward<F>(f), std::forward<Args>(args)...);
+            if (!res.valid()) {
+                return nullptr;
+            }
+            return std::make_shared<std::future<return_type>>(std::move(res));
+        }
+
+        template <typename F, typename... Args>
+        auto SubmitOnNode(int node, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            if (node < 0 || node >= GetNumaNodeNum()) {
+                return std::future<std::result_of_t<F(Args...)>>();
+            }
+            return SubmitToLane(NodeLane(node), nullptr, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+        template <typename F, typename... Args>
+        bool PostOnNode(int node, F&& f, Args &&... args) {
+            if (node < 0 || node >= GetNumaNodeNum()) {
+                return false;
+            }
+            return PostToLane(NodeLane(node), nullptr, std::forward<F>(f), std::forward<Args>(args)...);
+        }
+
+
+        // 批量提交[first, last)中的可调用对象，全局队列只加一次锁，唤醒的线程数不超过任务数
+        // 返回一个代表整批任务的future，所有任务执行完后就绪；任务抛出异常或者被拒绝时，future中保存第一个异常
+        template <typename Iter>
+        std::future<void> RunBatch(Iter first, Iter last) {
+            using Func = typename std::decay<decltype(*first)>::type;
+            if (!BeforeSubmit()) {
+                return std::future<void>();
+            }
+            auto state = std::make_shared<BatchState>(std::distance(first, last));
+            std::future<void> res = state->promise.get_future();
+            std::vector<Task> tasks;
+            tasks.reserve(state->remaining.load());
+            for (; first != last; ++first) {
+                BatchItem item(state);
+                Func func = *first;
+                tasks.emplace_back([item = std::move(item), func]() mutable { item.Run(func); });
+            }
+            PushTasks(tasks);
+            return res;
+        }
+
+        // 批量提交n个任务，第i个任务执行f(i)，f只保存一份，所有任务共享
+        template <typename F>
+        std::future<void> RunBulk(size_t n, F&& f) {
+            using Func = typename std::decay<F>::type;
+            if (!BeforeSubmit()) {
+                return std::future<void>();
+            }
+            auto state = std::make_shared<BatchState>(n);
+            std::future<void> res = state->promise.get_future();
+            auto func = std::make_shared<Func>(std::forward<F>(f));
+            std::vector<Task> tasks;
+            tasks.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                BatchItem item(state);
+                tasks.emplace_back([item = std::move(item), func, i]() mutable { item.Run([&func, i]() { (*func)(i); }); });
+            }
+            PushTasks(tasks);
+            return res;
+        }
+
+        // 获取当前线程池已经执行过的函数个数，不包括还在排队和正在执行的任务
+        int GetRunnedFuncNum() { return static_cast<int>(GetExecutedNum()); }
+
+        // 获取因为队列已满被拒绝或丢弃的任务个数
+        int GetRejectedFuncNum() { return rejected_function_num_.load(); }
+
+        // 获取出队时已经被取消或者超过截止时间，没有执行就被丢弃的任务个数
+        uint64_t GetSkippedFuncNum() { return skipped_function_num_.load(); }
+
+        // 获取每条任务通道的排队个数和等待时间，下标就是通道id
+        std::vector<LaneStats> GetLaneStats() {
+            std::vector<LaneStats> stats;
+            for (auto& lane : this->lanes_) {
+                LaneStats s;
+                s.name = lane->name;
+                s.weight = lane->weight;
+                s.depth = static_cast<size_t>(std::max<int64_t>(lane->depth.load(), 0));
+                HistogramSnapshot wait_ns = lane->wait_ns.Snapshot();
+                s.popped_num = wait_ns.Count();
+                s.avg_wait_us = wait_ns.Mean() / 1000;
+                s.p99_wait_us = wait_ns.Percentile(0.99) / 1000;
+                s.max_wait_us = wait_ns.Max() / 1000;
+                stats.push_back(std::move(s));
+            }
+            return stats;
+        }
+
+        // 获取线程池的统计快照：排队个数、排队时间和执行时间的分布、每个线程的忙闲时间，用来判断线程数是否合适
+        // 线程只在自己的计数器上记录，这里加worker_mutex_遍历线程列表再合并，不影响任务的执行
+        PoolStats GetStats() {
+            PoolStats stats;
+            stats.waiting_threads = GetWaitingThreadSize();
+            stats.submitted_num = static_cast<uint64_t>(this->total_function_num_.load());
+            stats.rejected_num = static_cast<uint64_t>(this->rejected_function_num_.load());
+            stats.skipped_num = this->skipped_function_num_.load();
+            stats.blocking_threads = GetBlockingThreadSize();
+            stats.compensated_num = this->compensated_num_.load();
+            stats.slab = GetSlabStats();
+            stats.lanes = GetLaneStats();
+            stats.queue_depth = 0;
+            for (auto& lane : stats.lanes) {
+                stats.queue_depth += lane.depth;
+            }
+            for (auto& node_lane : this->node_lanes_) {
+                TaskLane* lane = node_lane.load();
+                if (lane != nullptr) {
+                    stats.queue_depth += static_cast<size_t>(std::max<int64_t>(lane->depth.load(), 0));
+                }
+            }
+            int64_t now_ns = NowNanos();
+            ThreadPoolLock lock(this->worker_mutex_);
+            stats.total_threads = static_cast<int>(this->worker_threads_.size());
+            stats.executed_num = this->retired_stats_.executed_num + this->caller_executed_num_.load();
+            stats.busy_ns = this->retired_stats_.busy_ns;
+            stats.steal_num = this->retired_stats_.steal_num;
+            stats.wakeup_num = this->retired_stats_.wakeup_num;
+            stats.queue_latency.Merge(this->retired_stats_.queue_latency);
+            stats.run_time.Merge(this->retired_stats_.run_time);
+            for (auto& thread_ptr : this->worker_threads_) {
+                const WorkerCounters& counters = thread_ptr->counters;
+                WorkerStats w;
+                w.id = thread_ptr->id.load();
+                w.is_core = thread_ptr->flag.load() == ThreadFlag::kCore;
+                w.numa_node = thread_ptr->numa_node;
+                w.executed_num = counters.executed_num.load(std::memory_order_relaxed);
+                w.busy_ns = counters.busy_ns.load(std::memory_order_relaxed);
+                w.steal_num = counters.steal_num.load(std::memory_order_relaxed);
+                w.wakeup_num = counters.wakeup_num.load(std::memory_order_relaxed);
+                int64_t alive_ns = now_ns - counters.start_ns.load(std::memory_order_relaxed);
+                w.idle_ns = static_cast<uint64_t>(std::max<int64_t>(alive_ns - static_cast<int64_t>(w.busy_ns), 0));
+                w.local_depth = static_cast<size_t>(thread_ptr->local_tasks->Size());
+                counters.queue_latency.AddTo(stats.queue_latency);
+                counters.run_time.AddTo(stats.run_time);
+                stats.executed_num += w.executed_num;
+                stats.busy_ns += w.busy_ns;
+                stats.steal_num += w.steal_num;
+                stats.wakeup_num += w.wakeup_num;
+                stats.queue_depth += w.local_depth;
+                stats.workers.push_back(w);
+            }
+            return stats;
+        }
+
+        // 从任务队列中取出一个任务在当前线程执行，没有可执行的任务时返回false
+        // 需要等待其他任务结果的线程可以循环调用它帮忙执行任务，而不是阻塞等待
+        bool RunPendingTask() {
+            QueuedTask item;
+            ThreadWrapper* thread_ptr = GetCurrentThread();
+            bool found = TryGetTask(thread_ptr, item);
+            if (!found && !IsBounded()) {
                 ThreadPoolLock lock(this->task_mutex_);
-                this->tasks_.emplace([task]() { (*task)(); });
+                found = !this->is_shutdown_now_ && PopQueuedTask(thread_ptr, item);
             }
-            this->task_cv_.notify_one();
-            return std::make_shared<std::future<std::result_of_t<F(Args...)>>>(std::move(res));
+            if (!found) {
+                return false;
+            }
+            RunTask(thread_ptr, item);
+            return true;
         }
 
+        /**
+         * 任务中执行会阻塞的调用(recv/send、磁盘IO、sleep等)时在外面包一层：
+         *     { ThreadPool::ScopedBlocking blocking; n = recv(fd, buf, len, 0); }
+         * 进入时如果有任务在排队又没有空闲线程，就留下一个本来要退出的补偿线程，或者新建一个Cache线程(线程总数不超过max_threads)，
+         * 线程都卡在系统调用上时排队的任务也能继续执行；离开时多出来的一个Cache线程在下次空闲时退出。
+         * 不是在线程池的线程中创建时什么都不做；可以嵌套，只有最外层生效
+         */
+        class ScopedBlocking {
+        public:
+            ScopedBlocking() : pool_(CurrentWorker().first), worker_(CurrentWorker().second), is_compensated_(false) {
+                if (worker_ != nullptr && worker_->blocking_depth++ == 0) {
+                    is_compensated_ = pool_->EnterBlocking();
+                }
+            }
+
+            ~ScopedBlocking() {
+                if (worker_ != nullptr && --worker_->blocking_depth == 0) {
+                    pool_->LeaveBlocking(is_compensated_);
+                }
+            }
 
-        // 获取当前线程池已经执行过的函数个数
-        int GetRunnedFuncNum() { return total_function_num_.load(); }
+            ScopedBlocking(const ScopedBlocking&) = delete;
+            ScopedBlocking& operator=(const ScopedBlocking&) = delete;
+
+        private:
+            ThreadPool* pool_;
+            ThreadWrapper* worker_;
+            bool is_compensated_;
+        };
 
         // 当前线程池是否可用
         bool IsAvailable() { return is_aviailable_.load(); }
@@ -179,144 +818,1213 @@ namespace wzq {
         //这里有两个标志位，isshutdown_now置为true表示立即关闭线程，isshutdown置为true则表示先执行完队列里的任务再关闭线程池
 
         //关掉线程池，内部还没有执行的任务会继续执行
-        void ShutDown() {
-            ShutDown(false);
-            cout << "shutdown" << endl;
+        //timeout是等待任务执行完和线程退出的最长时间，默认一直等待，返回关闭期间执行完和丢弃的任务个数
+        ShutDownStats ShutDown(PoolMilliseconds timeout = PoolMilliseconds::max()) {
+            ShutDownStats stats = StopThreads(false, timeout);
+            WZQ_TRACE_INFO("shutdown", stats.completed_num, stats.dropped_num, stats.is_finished);
+            return stats;
         }
 
         //执行关掉线程池，内部还没有执行的任务会直接取消，不再执行
-        void ShutDownNow() {
-            ShutDown(true);
-            cout << "shutdown now" << endl;
+        //正在执行的任务仍然会执行完，timeout是等待它们执行完和线程退出的最长时间
+        ShutDownStats ShutDownNow(PoolMilliseconds timeout = PoolMilliseconds::max()) {
+            ShutDownStats stats = StopThreads(true, timeout);
+            WZQ_TRACE_INFO("shutdown now", stats.completed_num, stats.dropped_num, stats.is_finished);
+            return stats;
         }
 
         
 
      private:
-        void ShutDown(bool is_now) {
-             if (is_aviailable_.load()) {
-                 if (is_now) {
-                     this->is_shutdown_now_.store(true);
-                 }
-                 else {
-                     this->is_shutdown_.store(true);
-                 }
-                 //条件变量唤醒所有等待此条件变量的线程开始抢锁
-                 this->task_cv_.notify_all();
-                 is_aviailable_.store(false);
-             }
-        }
+        /**
+         * RunBatch/RunBulk中整批任务共享的状态，最后一个完成的任务负责设置promise
+         */
+        static const int kNormalLane = static_cast<int>(TaskPriority::kNormal);
+        static const int kMaxLaneWeight = 100;
 
+        /**
+         * 任务通道：max_task_size>0时每条通道使用一个容量为max_task_size的有界无锁队列，否则使用由task_mutex_保护的std::queue
+         * 有界模式下所有通道共用queued_task_num_记录的max_task_size个名额，单条通道最多可以用完全部名额
+         * 有界队列在通道第一次放入任务时才创建，没有用到的通道(低优先级通道、自定义通道、节点队列)不占用环形队列的内存
+         * depth在放入后加一、取出后减一，并发时可能短暂为负数
+         * last_serve_ns是最近一次从通道取出任务，或者通道由空变为非空的时间，用于判断通道是否饿死
+         * wait_ns记录任务从放入通道到被取出的等待时间，取任务的线程都会写，所以使用可以并发记录的直方图
+         */
+        struct TaskLane {
+            std::string name;
+            int weight;
+            std::queue<QueuedTask> tasks;
+            std::atomic<BoundedQueue<QueuedTask>*> bounded_tasks;  //有界模式下第一次放入时创建，之前为空
+            std::atomic<int64_t> depth;
+            std::atomic<int64_t> last_serve_ns;
+            LatencyHistogram wait_ns;
+            int capacity;
 
-        //如何为线程池添加线程？
-        //见AddThread()函数，默认会创建Core线程，也可以选择创建Cache线程，线程内部会有一个死循环，不停的等待任务，有任务到来时就会执行，
-        //同时内部会判断是否是Cache线程，如果是Cache线程，timeout时间内没有任务执行就会自动退出循环，线程结束。
+            TaskLane(const std::string& lane_name, int lane_weight, int max_task_size)
+                : name(lane_name), weight(lane_weight), bounded_tasks(nullptr), depth(0), last_serve_ns(0),
+                  capacity(max_task_size) {}
 
-        // 这里还会检查is_shutdown和isshutdown_now标志，根据两个标志位是否为true来判断是否结束线程
-        void AddThread(int id) { AddThread(id, ThreadFlag::kCore); }
+            ~TaskLane() { delete bounded_tasks.load(); }
 
-        void AddThread(int id, ThreadFlag thread_flag) {
-            cout << "Addthread " << id << " flag " << static_cast<int>(thread_flag) << endl;
-            ThreadWrapperPtr thread_ptr = std::make_shared<ThreadWrapper>();
-            thread_ptr->id.store(id);
-            thread_ptr->flag.store(thread_flag);
-            //使用lamda表达式创建匿名函数
-            auto func = [this, thread_ptr]() {
-                for (;;) {
-                    std::function<void()> task; //使用函数封装器，接下来时函数的内容，应该是这样
-                    {
-                        ThreadPoolLock lock(this->task_mutex_); //对任务队列上锁
-                        if (thread_ptr->state.load() == ThreadState::kStop) {  //线程状态为终止，退出循环
-                            break;
-                        }
-                        cout << "thread id " << thread_ptr->id.load() << "running start" << endl;
-                        thread_ptr->state.store(ThreadState::kWaiting);
-                        ++this->waiting_thread_num_;
-                        bool is_timeout = false;
-                        //线程抢到锁后，执行相应的函数，判断此线程是否需要运行
-                        if (thread_ptr->flag.load() == ThreadFlag::kCore) {
-                            this->task_cv_.wait(lock, [this, thread_ptr] {
-                                return (this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                    thread_ptr->state.load() == ThreadState::kStop);
-                                });
-                        }
-                        else {
-                            this->task_cv_.wait_for(lock, this->config_.time_out, [this, thread_ptr] {
-                                return (this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                    thread_ptr->state.load() == ThreadState::kStop);
-                                });
-                            is_timeout = !(this->is_shutdown_ || this->is_shutdown_now_ || !this->tasks_.empty() ||
-                                thread_ptr->state.load() == ThreadState::kStop);
-                        }
-                        --this->waiting_thread_num_;
-                        cout << "thread id " << thread_ptr->id.load() << " running wait end" << endl;
-                        if (is_timeout) {
-                            thread_ptr->state.store(ThreadState::kStop);
-                        }
-                        if (thread_ptr->state.load() == ThreadState::kStop) {
-                            cout << "thread id " << thread_ptr->id.load() << " state stop" << endl;
-                            break;
-                        }
-                        if (this->is_shutdown_ && this->tasks_.empty()) {
-                            cout << "thread id " << thread_ptr->id.load() << " shutdown" << endl;
-                            break;
-                        }
-                        if (this->is_shutdown_now_) {
-                            cout << "thread id " << thread_ptr->id.load() << " shutdown now" << endl;
-                            break;
-                        }
-                        //如果线程可以运行，就改变它的状态，并取出任务队列中的一个任务分配给他
-                        thread_ptr->state.store(ThreadState::kRunning);
-                        task = std::move(this->tasks_.front());
-                        this->tasks_.pop();
+            //放入时使用：还没有创建时创建一个，多个线程同时创建时只保留一个
+            BoundedQueue<QueuedTask>& BoundedTasks() {
+                BoundedQueue<QueuedTask>* queue = bounded_tasks.load(std::memory_order_acquire);
+                if (queue == nullptr) {
+                    std::unique_ptr<BoundedQueue<QueuedTask>> created(new BoundedQueue<QueuedTask>(capacity));
+                    if (bounded_tasks.compare_exchange_strong(queue, created.get(), std::memory_order_acq_rel)) {
+                        queue = created.release();
                     }
-                    task(); 
                 }
-                cout << "thread id " << thread_ptr->id.load() << " running end" << endl;
-            };
-            thread_ptr->ptr = std::make_shared<std::thread>(std::move(func));
-            if (thread_ptr->ptr->joinable()) {
-                thread_ptr->ptr->detach();
+                return *queue;
             }
-            this->worker_threads_.emplace_back(std::move(thread_ptr));  //加入工作线程列表
-        }
 
-        void Resize(int thread_num) {
-            if (thread_num < config_.core_threads) return;
-            int old_thread_num = worker_threads_.size();
-            cout << "old num " << old_thread_num << " resize " << thread_num << endl;
-            if (thread_num > old_thread_num) {
-                while (thread_num-- > old_thread_num) {
-                    AddThread(GetNextThreadId());
-                }
+            //取出时使用：还没有创建说明从来没有放入过任务
+            bool TryPopBounded(QueuedTask& item) {
+                BoundedQueue<QueuedTask>* queue = bounded_tasks.load(std::memory_order_acquire);
+                return queue != nullptr && queue->TryPop(item);
             }
-            else {
-                int diff = old_thread_num - thread_num;
-                auto iter = worker_threads_.begin();
-                while (iter != worker_threads_.end()) {
-                    if (diff == 0) {
-                        break;
-                    }
-                    auto thread_ptr = *iter;
-                    if (thread_ptr->flag.load() == ThreadFlag::kCache &&
-                        thread_ptr->state.load() == ThreadState::kWaiting) {  // wait
-                        thread_ptr->state.store(ThreadState::kStop);          // stop;
-                        --diff;
-                        iter = worker_threads_.erase(iter);
-                    }
-                    else {
-                        ++iter;
-                    }
+
+            bool Empty() const { return depth.load() <= 0; }
+
+            void OnPush(int64_t now_ns) {
+                if (depth.fetch_add(1) <= 0) {
+                    last_serve_ns.store(now_ns);
                 }
-                this->task_cv_.notify_all();
             }
-        }
 
-        int GetNextThreadId() { return this->thread_id_++; }
+            void OnPop(int64_t now_ns, int64_t enqueue_ns) {
+                --depth;
+                last_serve_ns.store(now_ns);
+                wait_ns.Record(static_cast<uint64_t>(std::max<int64_t>(now_ns - enqueue_ns, 0)));
+            }
+        };
 
-        //判断线程池的ThreadPoolConfig结构体是否合法
-        bool IsValidConfig(ThreadPoolConfig config) {
-            if (config.core_threads < 1 || config.max_threads < config.core_threads || config.time_out.count() < 1) {
+        /**
+         * 已经退出的线程留下的统计数据，由worker_mutex_保护
+         */
+        struct RetiredStats {
+            uint64_t executed_num = 0;
+            uint64_t busy_ns = 0;
+            uint64_t steal_num = 0;
+            uint64_t wakeup_num = 0;
+            HistogramSnapshot queue_latency;
+            HistogramSnapshot run_time;
+        };
+
+        //Submit系列函数的实现
+        template <typename F, typename... Args>
+        auto SubmitToLane(TaskLane& lane, const TaskOptions* options, F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+            using return_type = std::result_of_t<F(Args...)>;
+            if (!BeforeSubmit()) {
+                return std::future<return_type>();
+            }
+            std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+            std::future<return_type> res = task.get_future();
+            if (!PushTask(Task(std::move(task)), lane, options)) {
+                return std::future<return_type>();
+            }
+            total_function_num_++;
+            return res;
+        }
+
+        //Post系列函数的实现
+        template <typename F, typename... Args>
+        bool PostToLane(TaskLane& lane, const TaskOptions* options, F&& f, Args &&... args) {
+            if (!BeforeSubmit()) {
+                return false;
+            }
+            if (!PushTask(Task(std::bind(std::forward<F>(f), std::forward<Args>(args)...)), lane, options)) {
+                return false;
+            }
+            total_function_num_++;
+            return true;
+        }
+
+        struct BatchState {
+            std::atomic<size_t> remaining;
+            std::atomic<bool> has_error;
+            std::exception_ptr error;
+            std::promise<void> promise;
+
+            explicit BatchState(size_t count) : remaining(count), has_error(false) {
+                if (count == 0) {
+                    promise.set_value();
+                }
+            }
+
+            void Finish(std::exception_ptr e) {
+                if (e && !has_error.exchange(true)) {
+                    error = e;
+                }
+                if (remaining.fetch_sub(1) == 1) {
+                    if (error) {
+                        promise.set_exception(error);
+                    }
+                    else {
+                        promise.set_value();
+                    }
+                }
+            }
+        };
+
+        /**
+         * 批量任务中的一项，任务被拒绝或者丢弃而没有执行时，析构时也会完成计数，保证整批的future一定会就绪
+         */
+        struct BatchItem {
+            std::shared_ptr<BatchState> state;
+
+            explicit BatchItem(std::shared_ptr<BatchState> s) : state(std::move(s)) {}
+            BatchItem(BatchItem&&) = default;
+            BatchItem& operator=(BatchItem&&) = default;
+
+            ~BatchItem() {
+                if (state != nullptr) {
+                    state->Finish(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                }
+            }
+
+            template <typename F>
+            void Run(F&& func) {
+                std::exception_ptr e;
+                try {
+                    func();
+                }
+                catch (...) {
+                    e = std::current_exception();
+                }
+                std::shared_ptr<BatchState> s = std::move(state);
+                s->Finish(e);
+            }
+        };
+
+        //关闭线程池：设置关闭标志并唤醒所有线程，ShutDownNow时立即丢弃排队的任务，然后等待线程退出并join
+        //超过timeout还没有执行完时，改为ShutDownNow的方式丢弃剩下的任务，不再等待正在执行的任务
+        //已经关闭过的线程池可以再次调用，例如先ShutDown(timeout)，超时后再调用ShutDownNow()
+        ShutDownStats StopThreads(bool is_now, PoolMilliseconds timeout) {
+            ShutDownStats stats{0, 0, true};
+            if (!IsAvailable() && !this->is_shutdown_ && !this->is_shutdown_now_) {
+                return stats;
+            }
+            bool has_deadline = timeout != PoolMilliseconds::max();
+            auto deadline = std::chrono::steady_clock::now();
+            if (has_deadline) {
+                deadline += timeout;
+            }
+            uint64_t executed_num = GetExecutedNum();
+            uint64_t dropped_num = this->dropped_function_num_.load() + this->skipped_function_num_.load();
+            this->is_aviailable_.store(false);
+            if (is_now) {
+                this->is_shutdown_now_.store(true);
+            }
+            else {
+                this->is_shutdown_.store(true);
+            }
+            WakeAllThreads();
+            if (this->scaler_thread_.joinable() && this->scaler_thread_.get_id() != std::this_thread::get_id()) {
+                this->scaler_thread_.join();
+            }
+            if (is_now) {
+                DropQueuedTasks();
+            }
+            stats.is_finished = WaitThreads(has_deadline, deadline);
+            if (!stats.is_finished && !this->is_shutdown_now_) {
+                this->is_shutdown_now_.store(true);
+                WakeAllThreads();
+                DropQueuedTasks();
+            }
+            stats.completed_num = GetExecutedNum() - executed_num;
+            stats.dropped_num = this->dropped_function_num_.load() + this->skipped_function_num_.load() - dropped_num;
+            return stats;
+        }
+
+        //唤醒所有等待中的线程和伸缩线程，让它们重新检查关闭标志
+        //先加锁再通知，避免线程刚检查完条件还没开始等待时错过通知
+        void WakeAllThreads() {
+            { ThreadPoolLock lock(this->task_mutex_); }
+            this->task_cv_.notify_all();
+            this->space_cv_.notify_all();
+            this->event_count_.NotifyAll();
+            { ThreadPoolLock lock(this->scaler_mutex_); }
+            this->scaler_cv_.notify_all();
+        }
+
+
+        //如何为线程池添加线程？
+        //见AddThread()函数，默认会创建Core线程，也可以选择创建Cache线程，线程内部会有一个死循环，不停的等待任务，有任务到来时就会执行，
+        //同时内部会判断是否是Cache线程，如果是Cache线程，timeout时间内没有任务执行就会自动退出循环，线程结束。
+
+        // 这里还会检查is_shutdown和isshutdown_now标志，根据两个标志位是否为true来判断是否结束线程
+        void AddThread(int id) { AddThread(id, ThreadFlag::kCore); }
+
+        void AddThread(int id, ThreadFlag thread_flag) {
+            JoinExitedThreads();
+            WZQ_TRACE_INFO("add thread", id, static_cast<int>(thread_flag));
+            ThreadWrapperPtr thread_ptr = std::make_shared<ThreadWrapper>();
+            thread_ptr->id.store(id);
+            thread_ptr->flag.store(thread_flag);
+            //线程先绑定CPU再创建本地队列，Linux按照首次访问分配物理内存，本地队列就会分配在线程所在的节点上
+            //初始化完成后线程自己加入列表，其他线程窃取时不会看到还没有创建的本地队列，退出时也由线程自己从列表中移除
+            auto ready = std::make_shared<std::promise<void>>();
+            std::future<void> ready_future = ready->get_future();
+            //使用lamda表达式创建匿名函数
+            auto func = [this, thread_ptr, ready]() {
+                this->PlaceCurrentThread(thread_ptr.get());
+                thread_ptr->local_tasks.reset(new WorkStealQueue<QueuedTask*>());
+                thread_ptr->counters.start_ns.store(NowNanos());
+                SetCurrentWorker(thread_ptr.get());
+                {
+                    ThreadPoolLock lock(this->worker_mutex_);
+                    this->worker_threads_.push_back(thread_ptr);
+                }
+                ready->set_value();
+                bool is_surplus = false;  //是否已经认领了一个多出来的补偿线程名额
+                for (;;) {
+                    QueuedTask item; //取到的任务和它放入队列的时间
+                    //先取本地队列和通道，再去其他线程那里偷，都没有任务时才去抢全局队列的锁等待
+                    if (this->TryGetTask(thread_ptr.get(), item)) {
+                        thread_ptr->state.store(ThreadState::kRunning);
+                        this->RunTask(thread_ptr.get(), item);
+                        continue;
+                    }
+                    if (this->config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                        this->SpinWait();
+                    }
+                    {
+                        ThreadPoolLock lock(this->task_mutex_); //对任务队列上锁
+                        //线程被要求退出，或者是阻塞结束后多出来的补偿线程，退出循环
+                        if (thread_ptr->is_retiring.load()) {
+                            break;
+                        }
+                        if (this->TakeSurplusThread(thread_ptr.get())) {
+                            is_surplus = true;
+                            break;
+                        }
+                        WZQ_TRACE_DEBUG("thread wait start", thread_ptr->id.load());
+                        thread_ptr->state.store(ThreadState::kWaiting);
+                        ++this->waiting_thread_num_;
+                        bool is_timeout = false;
+                        auto is_ready = [this, thread_ptr] {
+                            return (this->is_shutdown_ || this->is_shutdown_now_ || this->HasQueuedTask() ||
+                                thread_ptr->is_retiring.load() || this->HasSurplusThread(thread_ptr.get()) || this->HasStealableTask());
+                        };
+                        //线程抢到锁后，执行相应的函数，判断此线程是否需要运行
+                        if (this->config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                            is_timeout = !this->ParkWorker(lock, thread_ptr->flag.load() == ThreadFlag::kCore, is_ready);
+                        }
+                        else if (thread_ptr->flag.load() == ThreadFlag::kCore) {
+                            this->task_cv_.wait(lock, is_ready);
+                        }
+                        else {
+                            this->task_cv_.wait_for(lock, this->config_.time_out, is_ready);
+                            is_timeout = !is_ready();
+                        }
+                        --this->waiting_thread_num_;
+                        WorkerCounters::Add(thread_ptr->counters.wakeup_num, 1);
+                        WZQ_TRACE_DEBUG("thread wait end", thread_ptr->id.load());
+                        is_surplus = this->TakeSurplusThread(thread_ptr.get());
+                        if (is_surplus || is_timeout || thread_ptr->is_retiring.load()) {
+                            WZQ_TRACE_INFO("thread stop", thread_ptr->id.load());
+                            break;
+                        }
+                        if (this->is_shutdown_ && !this->HasQueuedTask() && !this->HasStealableTask()) {
+                            WZQ_TRACE_DEBUG("thread shutdown", thread_ptr->id.load());
+                            break;
+                        }
+                        if (this->is_shutdown_now_) {
+                            WZQ_TRACE_DEBUG("thread shutdown now", thread_ptr->id.load());
+                            break;
+                        }
+                        //被唤醒是因为其他线程的本地队列里有任务，回到循环开头去窃取
+                        if (!this->PopQueuedTask(thread_ptr.get(), item)) {
+                            continue;
+                        }
+                        //如果线程可以运行，就改变它的状态，并取出任务队列中的一个任务分配给他
+                        thread_ptr->state.store(ThreadState::kRunning);
+                    }
+                    this->RunTask(thread_ptr.get(), item);
+                }
+                //Cache线程因为Resize、超时或者关闭退出时也要抵掉一个补偿线程名额，否则之后还会有别的Cache线程为它多退出一次
+                if (!is_surplus) {
+                    this->SettleSurplusThread(thread_ptr.get());
+                }
+                thread_ptr->state.store(ThreadState::kStop);
+                this->RemoveThread(thread_ptr.get());
+                WZQ_TRACE_INFO("thread exit", thread_ptr->id.load());
+            };
+            {
+                //线程加入和移出列表时都需要worker_mutex_，先保存好线程对象，线程退出时才能把它交给exited_threads_等待回收
+                ThreadPoolLock lock(this->worker_mutex_);
+                thread_ptr->ptr = std::make_shared<std::thread>(std::move(func));
+            }
+            ready_future.wait();
+        }
+
+        //工作窃取模式下记录当前线程属于哪个线程池的哪个线程，用于判断提交任务的是不是本线程池中的线程
+        static std::pair<ThreadPool*, ThreadWrapper*>& CurrentWorker() {
+            static thread_local std::pair<ThreadPool*, ThreadWrapper*> current(nullptr, nullptr);
+            return current;
+        }
+
+        void SetCurrentWorker(ThreadWrapper* thread_ptr) { CurrentWorker() = std::make_pair(this, thread_ptr); }
+
+        ThreadWrapper* GetCurrentWorker() {
+            if (config_.schedule_mode != ScheduleMode::kWorkStealing) {
+                return nullptr;
+            }
+            return GetCurrentThread();
+        }
+
+        //和调度模式无关，当前线程是本线程池中的线程时返回它的ThreadWrapper
+        ThreadWrapper* GetCurrentThread() {
+            auto& current = CurrentWorker();
+            return current.first == this ? current.second : nullptr;
+        }
+
+        //按照affinity配置绑定当前线程，并记录线程所在的NUMA节点，绑定失败时当作没有绑定
+        void PlaceCurrentThread(ThreadWrapper* thread_ptr) {
+            const CpuTopology& topology = CpuTopology::Get();
+            int index = thread_ptr->id.load();
+            std::vector<int> cpus;
+            int node = -1;
+            switch (config_.affinity) {
+            case AffinityMode::kCpuList:
+                cpus.push_back(config_.cpu_list[index % config_.cpu_list.size()]);
+                node = topology.NodeOfCpu(cpus.front());
+                break;
+            case AffinityMode::kSpread:
+                node = index % topology.NodeNum();
+                cpus = topology.NodeCpus(node);
+                break;
+            case AffinityMode::kCompact:
+                node = config_.numa_node;
+                cpus = topology.NodeCpus(node);
+                break;
+            default:
+                break;
+            }
+            if (!cpus.empty() && !CpuTopology::BindCurrentThread(cpus)) {
+                node = -1;
+            }
+            thread_ptr->numa_node = node;
+        }
+
+        bool IsWorkerThread() { return CurrentWorker().first == this; }
+
+        //提交任务前的检查：线程池是否可用，没有空闲线程时创建Cache线程
+        bool BeforeSubmit() {
+            if (this->is_shutdown_.load() || this->is_shutdown_now_.load() || !IsAvailable()) {
+                return false;
+            }
+            if (config_.scale_policy == ScalePolicy::kOnDemand && GetWaitingThreadSize() == 0 &&
+                GetTotalThreadSize() < config_.max_threads) {
+                AddThread(GetNextThreadId(), ThreadFlag::kCache);
+            }
+            return true;
+        }
+
+        //把任务放入队列：工作窃取模式下线程池内部提交的任务放入本地队列，其余的放入有界队列或者全局队列
+        //有界队列满时按照overflow_policy处理，返回false表示任务被拒绝
+        //本地队列不区分优先级，只有放入kNormal通道的任务才会进入本地队列
+        bool PushTask(Task&& task, TaskLane& lane, const TaskOptions* options = nullptr) {
+            ThreadWrapper* worker = GetCurrentWorker();
+            if (worker != nullptr && &lane == this->lanes_[kNormalLane].get() && (!IsBounded() || TryAcquireSlot())) {
+                worker->local_tasks->Push(SlabNew<QueuedTask>(std::move(task), NowNanos(), options));
+                NotifyWaiter();
+                return true;
+            }
+            if (!IsBounded()) {
+                {
+                    ThreadPoolLock lock(this->task_mutex_);
+                    int64_t now_ns = NowNanos();
+                    lane.tasks.emplace(std::move(task), now_ns, options);
+                    lane.OnPush(now_ns);
+                }
+                if (config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                    this->event_count_.Notify(1);
+                }
+                else {
+                    this->task_cv_.notify_one();
+                }
+                return true;
+            }
+            if (!PushBoundedTask(lane, std::move(task), options)) {
+                return false;
+            }
+            NotifyWaiter();
+            return true;
+        }
+
+        //批量放入任务：全局队列只加一次锁，最后按任务个数唤醒等待的线程
+        //被拒绝的任务在析构时由BatchItem完成计数
+        void PushTasks(std::vector<Task>& tasks) {
+            size_t pushed_num = tasks.size();
+            ThreadWrapper* worker = GetCurrentWorker();
+            if (worker != nullptr) {
+                int64_t now_ns = NowNanos();
+                for (auto& task : tasks) {
+                    //有界模式下名额用完时和外部提交的任务一样按照overflow_policy处理
+                    if (!IsBounded() || TryAcquireSlot()) {
+                        worker->local_tasks->Push(SlabNew<QueuedTask>(std::move(task), now_ns));
+                    }
+                    else if (!PushBoundedTask(*this->lanes_[kNormalLane], std::move(task))) {
+                        --pushed_num;
+                    }
+                }
+            }
+            else if (!IsBounded()) {
+                TaskLane& lane = *this->lanes_[kNormalLane];
+                ThreadPoolLock lock(this->task_mutex_);
+                int64_t now_ns = NowNanos();
+                for (auto& task : tasks) {
+                    lane.tasks.emplace(std::move(task), now_ns);
+                    lane.OnPush(now_ns);
+                }
+            }
+            else {
+                for (auto& task : tasks) {
+                    if (!PushBoundedTask(*this->lanes_[kNormalLane], std::move(task))) {
+                        --pushed_num;
+                    }
+                }
+            }
+            total_function_num_ += static_cast<int>(pushed_num);
+            NotifyWaiter(pushed_num);
+        }
+
+        //放入有界队列，线程池的名额用完时按照overflow_policy处理，不负责唤醒线程
+        bool PushBoundedTask(TaskLane& lane, Task&& task, const TaskOptions* options = nullptr) {
+            QueuedTask item(std::move(task), NowNanos(), options);
+            //通道的容量等于max_task_size，占到名额后放入不会失败
+            while (!TryAcquireSlot() || !lane.BoundedTasks().TryPush(std::move(item))) {
+                OverflowPolicy policy = config_.overflow_policy;
+                if (policy == OverflowPolicy::kBlock && IsWorkerThread()) {
+                    policy = OverflowPolicy::kCallerRuns;
+                }
+                if (policy == OverflowPolicy::kReject) {
+                    ++this->rejected_function_num_;
+                    return false;
+                }
+                if (policy == OverflowPolicy::kDiscardOldest) {
+                    QueuedTask oldest;
+                    if (lane.TryPopBounded(oldest)) {
+                        --lane.depth;
+                        --this->queued_task_num_;
+                        ++this->rejected_function_num_;
+                        continue;
+                    }
+                    //名额被其他通道或者本地队列占用，这条通道没有可以丢弃的任务，改为由提交线程执行
+                    policy = OverflowPolicy::kCallerRuns;
+                }
+                if (policy == OverflowPolicy::kCallerRuns) {
+                    RunTask(GetCurrentThread(), item);
+                    return true;
+                }
+                //kBlock: 等待线程取走任务后再重试，批量提交时任务还没有唤醒过线程，阻塞前先唤醒
+                NotifyWaiter(config_.max_task_size);
+                ThreadPoolLock lock(this->task_mutex_);
+                ++this->blocked_producer_num_;
+                this->space_cv_.wait(lock, [this] {
+                    return this->is_shutdown_ || this->is_shutdown_now_ ||
+                        this->queued_task_num_.load() < config_.max_task_size;
+                    });
+                --this->blocked_producer_num_;
+                if (this->is_shutdown_ || this->is_shutdown_now_) {
+                    return false;
+                }
+            }
+            lane.OnPush(item.enqueue_ns);
+            return true;
+        }
+
+        //有界模式下为一个任务占用一个名额，所有名额都被占用时返回false
+        bool TryAcquireSlot() {
+            int num = this->queued_task_num_.load();
+            while (num < config_.max_task_size) {
+                if (this->queued_task_num_.compare_exchange_weak(num, num + 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //本地队列中的任务被取出后调用，有界模式下归还名额并唤醒阻塞的提交线程
+        void ReleaseLocalSlot() {
+            if (IsBounded()) {
+                --this->queued_task_num_;
+                NotifyProducer();
+            }
+        }
+
+        //不用等待就能取到的任务，两种模式下顺序相同：有通道饿了超过starvation_time时先取通道中的任务，
+        //然后是自己的本地队列、共享的通道，最后去其他线程的本地队列偷，本地队列一直有任务时外部提交的任务也不会饿死
+        //thread_ptr为空表示调用者不是线程池中的线程，没有本地队列
+        bool TryGetTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (this->is_shutdown_now_) {
+                return false;
+            }
+            bool is_work_stealing = config_.schedule_mode == ScheduleMode::kWorkStealing;
+            if (is_work_stealing && HasStarvingLane(NowNanos()) && TryPopSharedTask(thread_ptr, item)) {
+                return true;
+            }
+            QueuedTask* local_task = nullptr;
+            if (is_work_stealing && thread_ptr != nullptr && thread_ptr->local_tasks->Pop(local_task)) {
+                item = std::move(*local_task);
+                SlabDelete(local_task);
+                ReleaseLocalSlot();
+                return true;
+            }
+            if ((IsBounded() || is_work_stealing) && TryPopSharedTask(thread_ptr, item)) {
+                return true;
+            }
+            if (is_work_stealing && StealTask(thread_ptr, local_task)) {
+                item = std::move(*local_task);
+                SlabDelete(local_task);
+                ReleaseLocalSlot();
+                return true;
+            }
+            return false;
+        }
+
+        //从共享的通道中取任务：有界模式无锁，无界模式只在通道不为空时才加task_mutex_
+        bool TryPopSharedTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (IsBounded()) {
+                if (!PopSharedTask(thread_ptr, item)) {
+                    return false;
+                }
+                NotifyProducer();
+                return true;
+            }
+            //depth是原子变量，不加锁读到的只是提示，真正取任务时再加锁确认
+            if (!HasQueuedTask()) {
+                return false;
+            }
+            ThreadPoolLock lock(this->task_mutex_);
+            return !this->is_shutdown_now_ && PopSharedTask(thread_ptr, item);
+        }
+
+        //是否有非空的通道超过starvation_time没有被取过任务，判断方式和PickLane相同
+        bool HasStarvingLane(int64_t now_ns) {
+            int64_t starvation_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.starvation_time).count();
+            if (starvation_ns <= 0) {
+                return false;
+            }
+            for (auto& lane : this->lanes_) {
+                if (lane->last_serve_ns.load() < now_ns - starvation_ns && !lane->Empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //执行取到的任务，线程池中的线程同时在自己的计数器上记录排队时间和执行时间
+        //thread_ptr为空表示由提交任务的线程执行，只计数
+        void RunTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (item.token.IsCancelled() || (item.deadline_ns != 0 && NowNanos() > item.deadline_ns)) {
+                //不调用任务，直接销毁，Run/Submit得到的future马上收到broken_promise异常
+                item.task = Task();
+                ++this->skipped_function_num_;
+                return;
+            }
+            CancellationToken::Scope scope(item.token);
+            if (thread_ptr == nullptr) {
+                item.task();
+                ++this->caller_executed_num_;
+                return;
+            }
+            int64_t start_ns = NowNanos();
+            item.task();
+            thread_ptr->counters.OnRun(start_ns - item.enqueue_ns, NowNanos() - start_ns);
+        }
+
+        //持有task_mutex_时结果准确，不加锁调用时只能当作提示
+        bool HasQueuedTask() {
+            for (auto& lane : this->lanes_) {
+                if (!lane->Empty()) {
+                    return true;
+                }
+            }
+            for (auto& node_lane : this->node_lanes_) {
+                TaskLane* lane = node_lane.load();
+                if (lane != nullptr && !lane->Empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //调用时需要持有task_mutex_，有界队列中的任务可能已经被其他线程取走，所以可能返回false
+        bool PopQueuedTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            if (!PopSharedTask(thread_ptr, item)) {
+                return false;
+            }
+            if (IsBounded() && this->blocked_producer_num_.load() > 0) {
+                this->space_cv_.notify_all();
+            }
+            return true;
+        }
+
+        //有界队列空出位置后唤醒阻塞在Run中的提交线程，它们可能在等不同的通道，所以全部唤醒
+        void NotifyProducer() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (this->blocked_producer_num_.load() > 0) {
+                { ThreadPoolLock lock(this->task_mutex_); }
+                this->space_cv_.notify_all();
+            }
+        }
+
+        bool IsBounded() const { return config_.max_task_size > 0; }
+
+        bool IsValidLane(int lane_id) const { return lane_id >= 0 && lane_id < static_cast<int>(this->lanes_.size()); }
+
+        static int64_t NowNanos() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //节点队列在第一次向该节点提交任务时才创建，没有用到RunOnNode等函数时不占用内存，取任务时也不用逐个检查
+        TaskLane& NodeLane(int node) {
+            TaskLane* lane = this->node_lanes_[node].load(std::memory_order_acquire);
+            if (lane == nullptr) {
+                std::unique_ptr<TaskLane> created(new TaskLane("node" + std::to_string(node), 1, config_.max_task_size));
+                if (this->node_lanes_[node].compare_exchange_strong(lane, created.get(), std::memory_order_acq_rel)) {
+                    lane = created.release();
+                }
+            }
+            return *lane;
+        }
+
+        //创建任务通道，重新计算严格优先级的顺序和加权公平调度的轮转表，只能在线程启动之前调用
+        int CreateLane(const std::string& name, int weight) {
+            this->lanes_.emplace_back(new TaskLane(name, weight, config_.max_task_size));
+            int lane_num = static_cast<int>(this->lanes_.size());
+            this->lane_order_.resize(lane_num);
+            for (int i = 0; i < lane_num; ++i) {
+                this->lane_order_[i] = i;
+            }
+            std::stable_sort(this->lane_order_.begin(), this->lane_order_.end(),
+                [this](int a, int b) { return this->lanes_[a]->weight > this->lanes_[b]->weight; });
+
+            //平滑加权轮询：每轮所有通道加上自己的权重，选出当前值最大的通道，再减去总权重
+            //这样一个周期内每条通道出现的次数等于它的权重，并且同一条通道不会扎堆出现
+            int total_weight = 0;
+            for (auto& lane : this->lanes_) {
+                total_weight += lane->weight;
+            }
+            std::vector<int> current(lane_num, 0);
+            this->fair_schedule_.clear();
+            for (int round = 0; round < total_weight; ++round) {
+                int best = 0;
+                for (int i = 0; i < lane_num; ++i) {
+                    current[i] += this->lanes_[i]->weight;
+                    if (current[i] > current[best]) {
+                        best = i;
+                    }
+                }
+                current[best] -= total_weight;
+                this->fair_schedule_.push_back(best);
+            }
+            return lane_num - 1;
+        }
+
+        //按照调度策略选出下一个取任务的通道，所有通道都为空时返回-1
+        //优先选择饿得最久的通道，其次按照加权公平的轮转表，轮到的通道为空或者严格优先级时按权重从大到小选择
+        int PickLane(int64_t now_ns) {
+            int64_t starvation_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(config_.starvation_time).count();
+            if (starvation_ns > 0) {
+                int starving = -1;
+                int64_t oldest_ns = now_ns - starvation_ns;
+                for (size_t i = 0; i < this->lanes_.size(); ++i) {
+                    TaskLane& lane = *this->lanes_[i];
+                    int64_t serve_ns = lane.last_serve_ns.load();
+                    if (serve_ns < oldest_ns && !lane.Empty()) {
+                        starving = static_cast<int>(i);
+                        oldest_ns = serve_ns;
+                    }
+                }
+                if (starving >= 0) {
+                    return starving;
+                }
+            }
+            if (config_.lane_policy == LanePolicy::kWeightedFair) {
+                int lane_id = this->fair_schedule_[this->fair_cursor_++ % this->fair_schedule_.size()];
+                if (!this->lanes_[lane_id]->Empty()) {
+                    return lane_id;
+                }
+            }
+            for (int lane_id : this->lane_order_) {
+                if (!this->lanes_[lane_id]->Empty()) {
+                    return lane_id;
+                }
+            }
+            return -1;
+        }
+
+        //从选出的通道中取任务，被其他线程抢先取走时按优先级顺序尝试其余通道
+        //无界模式下调用时需要持有task_mutex_
+        bool PopLaneTask(QueuedTask& item) {
+            int64_t now_ns = NowNanos();
+            int first = PickLane(now_ns);
+            if (first < 0) {
+                return false;
+            }
+            if (PopFromLane(*this->lanes_[first], item, now_ns)) {
+                return true;
+            }
+            for (int lane_id : this->lane_order_) {
+                if (lane_id != first && PopFromLane(*this->lanes_[lane_id], item, now_ns)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //线程先取自己所在节点队列中的任务，再按调度策略取各个任务通道中的任务，最后帮其他节点执行
+        //无界模式下调用时需要持有task_mutex_
+        bool PopSharedTask(ThreadWrapper* thread_ptr, QueuedTask& item) {
+            int node = thread_ptr != nullptr ? thread_ptr->numa_node : -1;
+            TaskLane* own_lane = node >= 0 ? this->node_lanes_[node].load(std::memory_order_acquire) : nullptr;
+            if (own_lane != nullptr && PopFromLane(*own_lane, item, NowNanos())) {
+                return true;
+            }
+            if (PopLaneTask(item)) {
+                return true;
+            }
+            for (size_t i = 0; i < this->node_lanes_.size(); ++i) {
+                TaskLane* lane = this->node_lanes_[i].load(std::memory_order_acquire);
+                if (static_cast<int>(i) != node && lane != nullptr && !lane->Empty() && PopFromLane(*lane, item, NowNanos())) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool PopFromLane(TaskLane& lane, QueuedTask& item, int64_t now_ns) {
+            if (IsBounded()) {
+                if (!lane.TryPopBounded(item)) {
+                    return false;
+                }
+                --this->queued_task_num_;
+            }
+            else {
+                if (lane.tasks.empty()) {
+                    return false;
+                }
+                item = std::move(lane.tasks.front());
+                lane.tasks.pop();
+            }
+            lane.OnPop(now_ns, item.enqueue_ns);
+            return true;
+        }
+
+        //从上次的位置开始轮流尝试其他线程的本地队列，避免所有空闲线程都去偷同一个线程
+        bool StealTask(ThreadWrapper* thief, QueuedTask*& task) {
+            ThreadPoolLock lock(this->worker_mutex_);
+            size_t thread_num = this->worker_threads_.size();
+            if (thread_num == 0) {
+                return false;
+            }
+            auto iter = this->worker_threads_.begin();
+            std::advance(iter, thief != nullptr ? thief->steal_index++ % thread_num : 0);
+            for (size_t i = 0; i < thread_num; ++i, ++iter) {
+                if (iter == this->worker_threads_.end()) {
+                    iter = this->worker_threads_.begin();
+                }
+                if (iter->get() != thief && (*iter)->local_tasks->Steal(task)) {
+                    if (thief != nullptr) {
+                        WorkerCounters::Add(thief->counters.steal_num, 1);
+                    }
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool HasStealableTask() {
+            if (config_.schedule_mode != ScheduleMode::kWorkStealing) {
+                return false;
+            }
+            ThreadPoolLock lock(this->worker_mutex_);
+            for (auto& thread_ptr : this->worker_threads_) {
+                if (!thread_ptr->local_tasks->Empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //放入task_num个任务后，如果有线程在等待就唤醒，唤醒的个数不超过任务个数
+        //先加锁再通知，保证等待线程要么在检查条件时看到了新任务，要么已经进入等待能收到通知
+        void NotifyWaiter(size_t task_num = 1) {
+            if (config_.idle_policy == IdlePolicy::kSpinThenPark) {
+                this->event_count_.Notify(task_num);
+                return;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            size_t waiting_num = static_cast<size_t>(std::max(this->waiting_thread_num_.load(), 0));
+            if (waiting_num == 0 || task_num == 0) {
+                return;
+            }
+            { ThreadPoolLock lock(this->task_mutex_); }
+            if (task_num >= waiting_num) {
+                this->task_cv_.notify_all();
+                return;
+            }
+            while (task_num-- > 0) {
+                this->task_cv_.notify_one();
+            }
+        }
+
+        //当前线程进入阻塞调用，返回是否为它补偿了一个线程
+        //有空闲线程或者没有任务排队时不需要补偿，阻塞期间再提交的任务由BeforeSubmit按照原来的规则创建线程
+        bool EnterBlocking() {
+            ++this->blocking_thread_num_;
+            if (this->is_shutdown_ || this->is_shutdown_now_ || GetWaitingThreadSize() > 0 || (!HasQueuedTask() && !HasStealableTask())) {
+                return false;
+            }
+            //之前的阻塞结束后还没来得及退出的Cache线程直接留下，不用再创建
+            int surplus_num = this->surplus_thread_num_.load();
+            while (surplus_num > 0) {
+                if (this->surplus_thread_num_.compare_exchange_weak(surplus_num, surplus_num - 1)) {
+                    ++this->compensating_thread_num_;
+                    ++this->compensated_num_;
+                    return true;
+                }
+            }
+            if (GetActiveThreadSize() >= config_.max_threads) {
+                return false;
+            }
+            WZQ_TRACE_DEBUG("compensate blocking thread");
+            ++this->compensating_thread_num_;
+            AddThread(GetNextThreadId(), ThreadFlag::kCache);
+            ++this->compensated_num_;
+            return true;
+        }
+
+        void LeaveBlocking(bool is_compensated) {
+            --this->blocking_thread_num_;
+            if (!is_compensated) {
+                return;
+            }
+            //空闲的Cache线程醒来后退出一个，正在执行任务的Cache线程执行完之后检查
+            ++this->surplus_thread_num_;
+            --this->compensating_thread_num_;
+            { ThreadPoolLock lock(this->task_mutex_); }
+            this->task_cv_.notify_all();
+            this->event_count_.NotifyAll();
+        }
+
+        bool HasSurplusThread(ThreadWrapper* thread_ptr) {
+            return thread_ptr->flag.load() == ThreadFlag::kCache && this->surplus_thread_num_.load() > 0;
+        }
+
+        //Cache线程认领一个多出来的补偿线程名额，认领成功的线程退出
+        bool TakeSurplusThread(ThreadWrapper* thread_ptr) {
+            if (thread_ptr->flag.load() != ThreadFlag::kCache) {
+                return false;
+            }
+            int surplus_num = this->surplus_thread_num_.load();
+            while (surplus_num > 0) {
+                if (this->surplus_thread_num_.compare_exchange_weak(surplus_num, surplus_num - 1)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //Cache线程因为Resize、超时或者关闭退出，而不是认领名额退出时调用：有多出来的名额就抵掉一个，
+        //补偿过线程的阻塞调用还没有结束时预先抵掉它结束后产生的名额，名额最多减到负的未结束调用个数
+        void SettleSurplusThread(ThreadWrapper* thread_ptr) {
+            if (thread_ptr->flag.load() != ThreadFlag::kCache) {
+                return;
+            }
+            int surplus_num = this->surplus_thread_num_.load();
+            while (surplus_num > -this->compensating_thread_num_.load()) {
+                if (this->surplus_thread_num_.compare_exchange_weak(surplus_num, surplus_num - 1)) {
+                    return;
+                }
+            }
+        }
+
+        //kSpinThenPark模式下先自旋再让出CPU，看到新任务就提前返回
+        //自旋的线程也算作空闲线程，提交任务时不会因为它们在自旋而创建Cache线程
+        //同时自旋的线程不超过MaxSpinningThreads()个，其余的直接睡眠：CPU不够时自旋和让出CPU的线程会把提交任务的线程挤下CPU，
+        //这时线程又没有睡眠，提交任务也唤醒不了它，新任务反而要多等一个调度周期
+        void SpinWait() {
+            if (++this->spinning_thread_num_ > MaxSpinningThreads()) {
+                --this->spinning_thread_num_;
+                return;
+            }
+            ++this->waiting_thread_num_;
+            for (int i = 0; i < config_.spin_count && !HasQueuedTask(); ++i) {
+                CpuRelax();
+            }
+            for (int i = 0; i < config_.yield_count && !HasQueuedTask() && !HasStealableTask(); ++i) {
+                std::this_thread::yield();
+            }
+            --this->waiting_thread_num_;
+            --this->spinning_thread_num_;
+        }
+
+        //CPU个数的一半，只有一个CPU时为0，取不到CPU个数时为1
+        static int MaxSpinningThreads() {
+            static const int max_num = std::thread::hardware_concurrency() == 0 ? 1 : static_cast<int>(std::thread::hardware_concurrency() / 2);
+            return max_num;
+        }
+
+        //kSpinThenPark模式下在事件计数上睡眠，调用时持有task_mutex_，睡眠期间释放
+        //Cache线程超过time_out还没有等到任务时返回false
+        template <typename Pred>
+        bool ParkWorker(ThreadPoolLock& lock, bool is_core, Pred is_ready) {
+            auto deadline = std::chrono::steady_clock::now() + this->config_.time_out;
+            while (!is_ready()) {
+                EventCount::Key key = this->event_count_.PrepareWait();
+                if (is_ready()) {
+                    this->event_count_.CancelWait();
+                    break;
+                }
+                lock.unlock();
+                if (is_core) {
+                    this->event_count_.Wait(key);
+                }
+                else {
+                    auto now = std::chrono::steady_clock::now();
+                    bool notified = now < deadline && this->event_count_.WaitFor(key, deadline - now);
+                    if (!notified) {
+                        if (now >= deadline) {
+                            this->event_count_.CancelWait();
+                        }
+                        lock.lock();
+                        return is_ready();
+                    }
+                }
+                lock.lock();
+            }
+            return true;
+        }
+
+        //调整线程个数，结果限制在[core_threads, max_threads]之间，返回调整后的线程个数
+        //增加的是Cache线程；减少时只标记正在等待任务的Cache线程，线程醒来后自己退出并从列表中移除，
+        //不会停掉正在执行任务的线程，也不会在其他线程遍历列表时修改列表，空闲的Cache线程不够时实际减少的个数会少一些
+        int Resize(int thread_num) {
+            thread_num = std::max(config_.core_threads, std::min(thread_num, config_.max_threads));
+            int old_thread_num = GetActiveThreadSize();
+            if (thread_num == old_thread_num || this->is_shutdown_ || this->is_shutdown_now_) {
+                return old_thread_num;
+            }
+            WZQ_TRACE_INFO("resize thread num", old_thread_num, thread_num);
+            if (thread_num > old_thread_num) {
+                for (int i = old_thread_num; i < thread_num; ++i) {
+                    AddThread(GetNextThreadId(), ThreadFlag::kCache);
+                }
+                return thread_num;
+            }
+            int diff = old_thread_num - thread_num;
+            {
+                //后创建的线程在列表末尾，优先回收
+                ThreadPoolLock lock(this->worker_mutex_);
+                for (auto iter = this->worker_threads_.rbegin(); iter != this->worker_threads_.rend() && diff > 0; ++iter) {
+                    ThreadWrapper& thread = **iter;
+                    if (thread.flag.load() == ThreadFlag::kCache && thread.state.load() == ThreadState::kWaiting &&
+                        !thread.is_retiring.exchange(true)) {
+                        --diff;
+                    }
+                }
+            }
+            //线程检查等待条件时持有task_mutex_，先加锁再通知，避免线程刚检查完条件还没开始等待时错过通知
+            { ThreadPoolLock lock(this->task_mutex_); }
+            this->task_cv_.notify_all();
+            this->event_count_.NotifyAll();
+            return thread_num + diff;
+        }
+
+        //没有被要求退出的线程个数
+        int GetActiveThreadSize() {
+            ThreadPoolLock lock(this->worker_mutex_);
+            int thread_num = 0;
+            for (auto& thread_ptr : this->worker_threads_) {
+                if (!thread_ptr->is_retiring.load()) {
+                    ++thread_num;
+                }
+            }
+            return thread_num;
+        }
+
+        //kAutoScale模式下伸缩线程的循环：每隔scale_interval取一次统计快照，和上一次的快照相减得到这段时间内的排队时间和利用率
+        //利用率按执行完的任务的执行时间计算，执行时间很长的任务在执行完之前不计入，但是正在执行任务的线程不会被回收
+        void ScaleLoop() {
+            PoolStats last = GetStats();
+            int64_t last_ns = NowNanos();
+            int idle_samples = 0;
+            for (;;) {
+                {
+                    ThreadPoolLock lock(this->scaler_mutex_);
+                    this->scaler_cv_.wait_for(lock, config_.scale_interval,
+                        [this] { return this->is_shutdown_ || this->is_shutdown_now_; });
+                    if (this->is_shutdown_ || this->is_shutdown_now_) {
+                        break;
+                    }
+                }
+                JoinExitedThreads();
+                PoolStats stats = GetStats();
+                int64_t now_ns = NowNanos();
+                HistogramSnapshot window = stats.queue_latency;
+                window.Subtract(last.queue_latency);
+                int thread_num = GetActiveThreadSize();
+                double capacity_ns = static_cast<double>(std::max<int64_t>(now_ns - last_ns, 1)) * std::max(thread_num, 1);
+                double utilization = 100.0 * static_cast<double>(stats.busy_ns - last.busy_ns) / capacity_ns;
+                uint64_t scale_up_wait_ns = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(config_.scale_up_wait).count());
+
+                //有任务在排队，并且排队时间超标，或者这段时间所有线程都忙得没有开始执行任何新任务
+                bool is_overloaded = stats.queue_depth > 0 && (window.Percentile(0.99) >= scale_up_wait_ns ||
+                    (window.Count() == 0 && stats.waiting_threads == 0));
+                if (is_overloaded) {
+                    idle_samples = 0;
+                    if (thread_num < config_.max_threads) {
+                        int step = static_cast<int>(std::min(stats.queue_depth, static_cast<size_t>(thread_num)));
+                        WZQ_TRACE_INFO("scale up", thread_num, std::max(step, 1));
+                        Resize(thread_num + std::max(step, 1));
+                    }
+                }
+                else if (stats.queue_depth == 0 && utilization < config_.scale_down_utilization) {
+                    if (++idle_samples >= config_.scale_down_samples && thread_num > config_.core_threads) {
+                        //保留的线程数让利用率回到scale_down_utilization附近
+                        int needed = static_cast<int>(utilization * thread_num / config_.scale_down_utilization) + 1;
+                        WZQ_TRACE_INFO("scale down", thread_num, needed);
+                        Resize(needed);
+                        idle_samples = 0;
+                    }
+                }
+                else {
+                    idle_samples = 0;
+                }
+                last = std::move(stats);
+                last_ns = now_ns;
+            }
+        }
+
+        //线程退出时把自己从列表中移除，统计数据累加到retired_stats_，线程对象放入exited_threads_等待join
+        //只有ShutDownNow或者超时后线程才会带着本地队列中的任务退出，这些任务计入丢弃的个数
+        void RemoveThread(ThreadWrapper* thread_ptr) {
+            QueuedTask* task = nullptr;
+            while (thread_ptr->local_tasks->Pop(task)) {
+                SlabDelete(task);
+                ++this->dropped_function_num_;
+                ReleaseLocalSlot();
+            }
+            {
+                ThreadPoolLock lock(this->worker_mutex_);
+                for (auto iter = this->worker_threads_.begin(); iter != this->worker_threads_.end(); ++iter) {
+                    if (iter->get() == thread_ptr) {
+                        RetireThread(*thread_ptr);
+                        this->exited_threads_.push_back(std::move(thread_ptr->ptr));
+                        this->worker_threads_.erase(iter);
+                        break;
+                    }
+                }
+            }
+            this->exit_cv_.notify_all();
+        }
+
+        //回收已经退出的线程，它们从列表中移除后只剩下很少的收尾工作，join很快就会返回
+        void JoinExitedThreads() {
+            std::vector<ThreadPtr> exited_threads;
+            {
+                ThreadPoolLock lock(this->worker_mutex_);
+                exited_threads.swap(this->exited_threads_);
+            }
+            for (auto& thread : exited_threads) {
+                if (thread != nullptr && thread->joinable()) {
+                    thread->join();
+                }
+            }
+        }
+
+        //等待所有线程退出并回收，has_deadline为true时最多等到deadline，超时返回false
+        //在线程池中的线程里调用时不等待自己
+        bool WaitThreads(bool has_deadline, std::chrono::steady_clock::time_point deadline) {
+            size_t self_num = IsWorkerThread() ? 1 : 0;
+            bool is_exited = true;
+            {
+                ThreadPoolLock lock(this->worker_mutex_);
+                auto all_exited = [this, self_num] { return this->worker_threads_.size() <= self_num; };
+                if (has_deadline) {
+                    is_exited = this->exit_cv_.wait_until(lock, deadline, all_exited);
+                }
+                else {
+                    this->exit_cv_.wait(lock, all_exited);
+                }
+            }
+            JoinExitedThreads();
+            return is_exited && self_num == 0;
+        }
+
+        //线程池中的线程执行完的任务个数，加上由提交线程执行的任务个数
+        uint64_t GetExecutedNum() {
+            ThreadPoolLock lock(this->worker_mutex_);
+            uint64_t executed_num = this->retired_stats_.executed_num + this->caller_executed_num_.load();
+            for (auto& thread_ptr : this->worker_threads_) {
+                executed_num += thread_ptr->counters.executed_num.load(std::memory_order_relaxed);
+            }
+            return executed_num;
+        }
+
+        //丢弃任务通道和节点队列中的所有任务，返回丢弃的个数，任务在锁外析构
+        uint64_t DropQueuedTasks() {
+            std::vector<QueuedTask> dropped;
+            {
+                ThreadPoolLock lock(this->task_mutex_);
+                std::vector<TaskLane*> lanes;
+                for (auto& lane : this->lanes_) {
+                    lanes.push_back(lane.get());
+                }
+                for (auto& lane : this->node_lanes_) {
+                    if (lane.load() != nullptr) {
+                        lanes.push_back(lane.load());
+                    }
+                }
+                for (TaskLane* lane : lanes) {
+                    QueuedTask item;
+                    while (PopFromLane(*lane, item, NowNanos())) {
+                        dropped.push_back(std::move(item));
+                    }
+                }
+            }
+            this->dropped_function_num_ += dropped.size();
+            if (!dropped.empty()) {
+                NotifyProducer();
+            }
+            return dropped.size();
+        }
+
+        //调用时需要持有worker_mutex_
+        void RetireThread(const ThreadWrapper& thread) {
+            const WorkerCounters& counters = thread.counters;
+            this->retired_stats_.executed_num += counters.executed_num.load(std::memory_order_relaxed);
+            this->retired_stats_.busy_ns += counters.busy_ns.load(std::memory_order_relaxed);
+            this->retired_stats_.steal_num += counters.steal_num.load(std::memory_order_relaxed);
+            this->retired_stats_.wakeup_num += counters.wakeup_num.load(std::memory_order_relaxed);
+            counters.queue_latency.AddTo(this->retired_stats_.queue_latency);
+            counters.run_time.AddTo(this->retired_stats_.run_time);
+        }
+
+        int GetNextThreadId() { return this->thread_id_++; }
+
+        //判断线程池的ThreadPoolConfig结构体是否合法
+        bool IsValidConfig(ThreadPoolConfig config) {
+            if (config.core_threads < 1 || config.max_threads < config.core_threads || config.time_out.count() < 1) {
+                return false;
+            }
+            if (config.affinity == AffinityMode::kCpuList && config.cpu_list.empty()) {
+                return false;
+            }
+            if (config.scale_policy == ScalePolicy::kAutoScale &&
+                (config.scale_interval.count() < 1 || config.scale_down_utilization < 1 || config.scale_down_utilization > 100 ||
+                    config.scale_down_samples < 1)) {
+                return false;
+            }
+            if (config.affinity == AffinityMode::kCompact &&
+                (config.numa_node < 0 || config.numa_node >= CpuTopology::Get().NodeNum())) {
                 return false;
             }
             return true;
@@ -328,14 +2036,38 @@ namespace wzq {
         ThreadPoolConfig config_; //定义线程池状态结构体
 
         std::list<ThreadWrapperPtr> worker_threads_; //定义线程列表
+        std::mutex worker_mutex_; //保护线程列表，窃取任务时需要遍历其他线程
 
-        std::queue<std::function<void()>> tasks_;  //定义任务队列
+        std::vector<std::unique_ptr<TaskLane>> lanes_;  //任务通道，下标就是通道id，线程启动后不再变化
+        std::vector<int> lane_order_;  //按权重从大到小排列的通道id
+        std::vector<int> fair_schedule_;  //加权公平调度的轮转表
+        std::vector<std::atomic<TaskLane*>> node_lanes_;  //每个NUMA节点一个任务队列，存放RunOnNode提交的任务，第一次向该节点提交时创建
+        std::atomic<unsigned int> fair_cursor_;
         std::mutex task_mutex_; //定义任务队列的控制锁
         std::condition_variable task_cv_;  //定义控制多线程的条件变量，和任务队列控制锁配合使用
+        std::condition_variable space_cv_;  //有界队列满时提交任务的线程在此等待
+        EventCount event_count_;  //kSpinThenPark模式下空闲线程在这里睡眠，代替task_cv_
+        std::thread scaler_thread_;  //kAutoScale模式下的伸缩线程
+        std::mutex scaler_mutex_;
+        std::condition_variable scaler_cv_;  //伸缩线程在这里等待下一次采样，ShutDown时唤醒它退出
+        std::vector<ThreadPtr> exited_threads_;  //已经退出等待join的线程，由worker_mutex_保护
+        std::condition_variable exit_cv_;  //线程退出时通知，和worker_mutex_配合使用
 
 
         std::atomic<int> total_function_num_;
         std::atomic<int> waiting_thread_num_;
+        std::atomic<int> spinning_thread_num_;  //kSpinThenPark模式下正在自旋的线程个数
+        std::atomic<int> blocked_producer_num_;
+        std::atomic<int> queued_task_num_;  //有界模式下已经占用名额的任务个数，包括通道、节点队列和本地队列中的任务
+        std::atomic<int> rejected_function_num_;
+        std::atomic<uint64_t> caller_executed_num_;  //由提交任务的线程执行的任务个数
+        std::atomic<uint64_t> skipped_function_num_;  //出队时已经被取消或者超过截止时间而没有执行的任务个数
+        std::atomic<uint64_t> dropped_function_num_;  //关闭时没有执行就被丢弃的任务个数
+        std::atomic<int> blocking_thread_num_;  //正在ScopedBlocking中阻塞的线程个数
+        std::atomic<int> surplus_thread_num_;  //阻塞结束后应该退出的补偿线程个数，为负数表示已经预先退出的个数
+        std::atomic<int> compensating_thread_num_;  //补偿过线程并且还没有结束的阻塞调用个数
+        std::atomic<uint64_t> compensated_num_;  //为阻塞的线程补偿线程的次数
+        RetiredStats retired_stats_;
         std::atomic<int> thread_id_; //用于为新线程分配id
 
         std::atomic<bool> is_shutdown_now_;
@@ -0,0 +1,45 @@
+#ifndef __BARRIER__
+#define __BARRIER__
+
+#include "event_count.h"
+#include "noncopyable.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace wzq {
+
+    /**
+     * 可以重复使用的屏障：每一轮count个线程都调用ArriveAndWait之后才一起返回，然后自动开始下一轮
+     * 最后一个到达的线程重置计数并把轮次加一，其他线程等待轮次变化，所以上一轮的线程被唤醒前下一轮就可以开始
+     * 在线程池的任务中使用时，线程池至少要有count个线程同时执行这些任务：
+     * 等待时不能帮线程池执行排队的任务，否则代执行的任务可能进入下一轮，而被压在栈底的任务永远到不了下一轮
+     */
+    class Barrier : NonCopyAble {
+    public:
+        explicit Barrier(uint32_t count) : count_(count), remaining_(count), generation_(0) {}
+
+        //返回true表示当前线程是这一轮最后一个到达的
+        bool ArriveAndWait() {
+            uint32_t generation = generation_.load(std::memory_order_acquire);
+            if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                remaining_.store(count_, std::memory_order_relaxed);
+                generation_.fetch_add(1, std::memory_order_release);
+                event_.NotifyAll();
+                return true;
+            }
+            event_.Await([this, generation] { return generation_.load(std::memory_order_acquire) != generation; });
+            return false;
+        }
+
+        uint32_t GetCount() const { return count_; }
+
+    private:
+        const uint32_t count_;
+        std::atomic<uint32_t> remaining_;
+        std::atomic<uint32_t> generation_;
+        EventCount event_;
+    };
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef __BOUNDED_QUEUE__
+#define __BOUNDED_QUEUE__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace wzq {
+
+    /**
+     * 有界无锁多生产者多消费者队列（Vyukov MPMC环形队列）
+     * 每个槽位带一个序号，生产者和消费者通过CAS抢占位置，再根据序号判断槽位是否可写/可读，
+     * 所有槽位在构造时一次性分配，运行过程中不会再申请内存。
+     * 队列满时TryPush返回false，队列空时TryPop返回false，由调用方决定如何处理。
+     */
+    template <typename T>
+    class BoundedQueue {
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        static const size_t kCacheLineSize = 64;
+
+    public:
+        explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1), cells_(new Cell[capacity_]) {
+            for (size_t i = 0; i < capacity_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            enqueue_pos_.store(0, std::memory_order_relaxed);
+            dequeue_pos_.store(0, std::memory_order_relaxed);
+        }
+
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        //只有抢到槽位时才会移动item，失败时item保持不变，调用方可以重试
+        bool TryPush(T&& item) {
+            size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells_[pos % capacity_];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.data = std::move(item);
+                        cell.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;  //队列已满
+                }
+                else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool TryPop(T& item) {
+            size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells_[pos % capacity_];
+                size_t seq = cell.sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        item = std::move(cell.data);
+                        cell.data = T();  //及时释放任务捕获的资源
+                        cell.sequence.store(pos + capacity_, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;  //队列为空
+                }
+                else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        //近似大小，并发修改时只能作为参考
+        size_t Size() const {
+            size_t enqueue_pos = enqueue_pos_.load(std::memory_order_seq_cst);
+            size_t dequeue_pos = dequeue_pos_.load(std::memory_order_seq_cst);
+            return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+        }
+
+        bool Empty() const { return Size() == 0; }
+
+        size_t Capacity() const { return capacity_; }
+
+    private:
+        const size_t capacity_;
+        std::unique_ptr<Cell[]> cells_;
+
+        //生产者和消费者的位置放在不同的缓存行，避免伪共享
+        char pad0_[kCacheLineSize];
+        std::atomic<size_t> enqueue_pos_;
+        char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> dequeue_pos_;
+        char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    };
+
+}  // namespace wzq
+
+#endif
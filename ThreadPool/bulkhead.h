@@ -0,0 +1,419 @@
+#ifndef __BULKHEAD__
+#define __BULKHEAD__
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "latency_histogram.h"
+#include "noncopyable.h"
+#include "task.h"
+
+/*
+舱壁隔离：在同一个线程池上创建多个有名字的执行器，每个执行器有自己的有界队列、并发上限和保证的最少线程数，
+某个执行器的任务堆积或者执行很慢时，只会占满它自己的队列和并发额度，不会拖住其他执行器。
+执行器的任务不直接进入线程池的队列，而是由BulkheadGroup投递到线程池的“调度任务”取出来执行，
+调度任务的个数不超过worker_num，每次按照以下顺序选择下一个要执行的任务：
+    1. 正在执行的任务个数少于min_workers并且有任务排队的执行器优先，空出来的线程先补足它们的保证额度；
+    2. 所有执行器的min_workers之和是保留的线程数，即使它们的所有者当前没有任务也不会借给别人，
+       超出min_workers的部分只能使用剩下的worker_num-保留数个共享线程，这样突发的任务总能马上拿到自己保留的线程；
+    3. 共享线程按照赤字轮转（DRR）：每一轮每个执行器得到weight*kQuantumNs纳秒的额度，任务执行完后扣除实际的执行时间，
+       额度用完的执行器要等其他执行器也用完、进入下一轮之后才能继续，所以执行时间长的任务不会挤占别人的份额；
+    4. 正在执行的任务个数达到max_concurrency的执行器不参与选择。
+调度任务只在有任务可以执行时占用线程池的线程，没有可执行的任务时立即退出，线程池中的其他任务不受影响。
+*/
+
+namespace wzq {
+
+    class BulkheadGroup : NonCopyAble {
+    public:
+        /**
+         * 执行器的配置
+         * queue_capacity: 排队任务个数的上限，队列满时提交失败，<=0表示不限制
+         * max_concurrency: 同时执行的任务个数上限，<=0表示只受worker_num限制
+         * min_workers: 保证的最少线程数，所有执行器的min_workers之和必须小于worker_num，至少留一个共享线程
+         * weight: DRR的权重，取值[1, kMaxWeight]，每一轮得到的执行时间额度和weight成正比
+         */
+        struct ExecutorConfig {
+            int queue_capacity = 1024;
+            int max_concurrency = 0;
+            int min_workers = 0;
+            int weight = 1;
+        };
+
+        /**
+         * 执行器的统计信息
+         * depth: 当前排队的任务个数
+         * running_num: 当前正在执行的任务个数
+         * submitted_num: 成功提交的任务个数
+         * rejected_num: 因为队列满而被拒绝的任务个数，以及线程池关闭时还在排队而被丢弃的任务个数
+         * executed_num: 执行完的任务个数
+         * busy_ns: 所有任务的执行时间之和
+         * queue_latency: 任务从提交到开始执行的等待时间分布，单位纳秒
+         * run_time: 任务的执行时间分布，单位纳秒
+         */
+        struct ExecutorStats {
+            std::string name;
+            size_t depth;
+            int running_num;
+            uint64_t submitted_num;
+            uint64_t rejected_num;
+            uint64_t executed_num;
+            uint64_t busy_ns;
+            HistogramSnapshot queue_latency;
+            HistogramSnapshot run_time;
+        };
+
+        class Executor : NonCopyAble {
+        public:
+            // 和ThreadPool::Submit一样，队列满或者线程池不可用时返回的future是无效的(valid()==false)
+            template <typename F, typename... Args>
+            auto Submit(F&& f, Args &&... args) -> std::future<std::result_of_t<F(Args...)>> {
+                using return_type = std::result_of_t<F(Args...)>;
+                std::packaged_task<return_type()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+                std::future<return_type> res = task.get_future();
+                if (!group_.Push(*this, Task(std::move(task)))) {
+                    return std::future<return_type>();
+                }
+                return res;
+            }
+
+            // 和ThreadPool::Post一样，任务不能抛出异常，队列满或者线程池不可用时返回false
+            template <typename F, typename... Args>
+            bool Post(F&& f, Args &&... args) {
+                return group_.Push(*this, Task(std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+            }
+
+            const std::string& GetName() const { return name_; }
+
+            const ExecutorConfig& GetConfig() const { return config_; }
+
+            ExecutorStats GetStats() { return group_.GetStats(*this); }
+
+        private:
+            friend class BulkheadGroup;
+
+            struct Item {
+                Item(Task&& t, int64_t ns) : task(std::move(t)), enqueue_ns(ns) {}
+
+                Task task;
+                int64_t enqueue_ns;
+            };
+
+            Executor(BulkheadGroup& group, const std::string& name, const ExecutorConfig& config)
+                : group_(group), name_(name), config_(config), running_num_(0), deficit_ns_(0),
+                  submitted_num_(0), rejected_num_(0), executed_num_(0), busy_ns_(0) {}
+
+            bool IsFull() const { return config_.queue_capacity > 0 && tasks_.size() >= static_cast<size_t>(config_.queue_capacity); }
+
+            bool IsAtLimit() const { return config_.max_concurrency > 0 && running_num_ >= config_.max_concurrency; }
+
+            //有任务排队并且没有达到并发上限
+            bool IsRunnable() const { return !tasks_.empty() && !IsAtLimit(); }
+
+            BulkheadGroup& group_;
+            std::string name_;
+            ExecutorConfig config_;
+
+            //以下成员都由group_.mutex_保护
+            std::deque<Item> tasks_;
+            int running_num_;
+            //本轮剩余的执行时间额度，任务执行完后才扣除，可能是负数，负数部分在下一轮补上
+            int64_t deficit_ns_;
+            uint64_t submitted_num_;
+            uint64_t rejected_num_;
+            uint64_t executed_num_;
+            uint64_t busy_ns_;
+
+            //在锁外记录
+            LatencyHistogram queue_latency_;
+            LatencyHistogram run_time_;
+        };
+
+        static const int kMaxWeight = 100;
+        //每一轮每个权重单位得到的执行时间额度
+        static const int64_t kQuantumNs = 1000000;
+
+        //worker_num是同时占用线程池线程的调度任务个数上限，<=0时使用线程池当前的线程个数
+        explicit BulkheadGroup(ThreadPool& pool, int worker_num = 0) : pool_(pool), worker_num_(worker_num), runner_num_(0), cursor_(0), reserved_num_(0) {
+            if (worker_num_ <= 0) {
+                worker_num_ = std::max(pool_.GetTotalThreadSize(), 1);
+            }
+        }
+
+        //等待所有已经提交的任务执行完
+        ~BulkheadGroup() { Wait(); }
+
+        //创建一个执行器，名字重复或者配置不合法时返回nullptr，执行器的生命周期和BulkheadGroup相同
+        Executor* AddExecutor(const std::string& name, const ExecutorConfig& config) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (FindExecutor(name) != nullptr || config.weight < 1 || config.weight > kMaxWeight || config.min_workers < 0 ||
+                reserved_num_ + config.min_workers >= worker_num_ || (config.max_concurrency > 0 && config.max_concurrency < config.min_workers)) {
+                return nullptr;
+            }
+            executors_.emplace_back(new Executor(*this, name, config));
+            reserved_num_ += config.min_workers;
+            return executors_.back().get();
+        }
+
+        Executor* AddExecutor(const std::string& name) { return AddExecutor(name, ExecutorConfig()); }
+
+        Executor* GetExecutor(const std::string& name) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return FindExecutor(name);
+        }
+
+        std::vector<ExecutorStats> GetStats() {
+            std::vector<ExecutorStats> stats;
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats.reserve(executors_.size());
+            for (auto& executor : executors_) {
+                stats.push_back(StatsOf(*executor));
+            }
+            return stats;
+        }
+
+        //等待所有已经提交的任务执行完，不要在执行器的任务中调用
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_cv_.wait(lock, [this]() { return runner_num_ == 0 && IsEmpty(); });
+        }
+
+        int GetWorkerNum() const { return worker_num_; }
+
+    private:
+        bool Push(Executor& executor, Task&& task) {
+            if (!pool_.IsAvailable()) {
+                return false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (executor.IsFull()) {
+                    ++executor.rejected_num_;
+                    return false;
+                }
+                executor.tasks_.emplace_back(std::move(task), NowNs());
+                ++executor.submitted_num_;
+                if (runner_num_ >= worker_num_ || !executor.IsRunnable()) {
+                    //已有的调度任务执行完手上的任务后会重新选择，不需要新的调度任务
+                    return true;
+                }
+                ++runner_num_;
+            }
+            //线程池拒绝或者丢弃调度任务时由Runner的析构函数处理，见DropRunner
+            pool_.Post(Runner(this));
+            return true;
+        }
+
+        //投递到线程池的调度任务，只能移动。线程池不可用、按照溢出策略拒绝或者丢弃、关闭时丢弃它，任务没有执行就被析构，
+        //析构函数调用DropRunner释放它占用的调度任务名额，runner_num_最终会减到0，Wait和析构函数不会一直等下去
+        struct Runner {
+            explicit Runner(BulkheadGroup* owner) noexcept : group(owner) {}
+
+            Runner(Runner&& other) noexcept : group(other.group) { other.group = nullptr; }
+
+            Runner(const Runner&) = delete;
+            Runner& operator=(const Runner&) = delete;
+            Runner& operator=(Runner&&) = delete;
+
+            ~Runner() {
+                if (group != nullptr) {
+                    group->DropRunner();
+                }
+            }
+
+            void operator()() {
+                BulkheadGroup* owner = group;
+                group = nullptr;
+                owner->RunLoop();
+            }
+
+            BulkheadGroup* group;
+        };
+
+        //调度任务没有执行就被线程池销毁：线程池还可用时(被拒绝或者被kDiscardOldest丢弃)在当前线程执行调度任务，
+        //保证已经入队的任务都能执行；线程池已经关闭时丢弃所有排队的任务，Submit得到的future收到broken_promise异常
+        void DropRunner() {
+            if (pool_.IsAvailable()) {
+                RunLoop();
+                return;
+            }
+            std::vector<Executor::Item> dropped;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto& executor : executors_) {
+                    executor->rejected_num_ += executor->tasks_.size();
+                    for (auto& item : executor->tasks_) {
+                        dropped.push_back(std::move(item));
+                    }
+                    executor->tasks_.clear();
+                }
+                if (--runner_num_ == 0 && IsEmpty()) {
+                    idle_cv_.notify_all();
+                }
+            }
+            //任务在锁外析构，析构时可能会唤醒等待future的线程
+        }
+
+        //调度任务：不断选择下一个任务执行，没有可执行的任务时退出
+        void RunLoop() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for (;;) {
+                Executor* executor = PickExecutor();
+                if (executor == nullptr) {
+                    break;
+                }
+                Executor::Item item = std::move(executor->tasks_.front());
+                executor->tasks_.pop_front();
+                ++executor->running_num_;
+                lock.unlock();
+
+                int64_t start_ns = NowNs();
+                executor->queue_latency_.Record(static_cast<uint64_t>(std::max<int64_t>(start_ns - item.enqueue_ns, 0)));
+                item.task();
+                item.task = Task();
+                int64_t cost_ns = std::max<int64_t>(NowNs() - start_ns, 0);
+                executor->run_time_.Record(static_cast<uint64_t>(cost_ns));
+
+                lock.lock();
+                --executor->running_num_;
+                ++executor->executed_num_;
+                executor->busy_ns_ += static_cast<uint64_t>(cost_ns);
+                executor->deficit_ns_ -= cost_ns;
+            }
+            //在锁内通知，Wait拿到锁之后才会返回，所以通知时BulkheadGroup一定还没有被销毁
+            if (--runner_num_ == 0 && IsEmpty()) {
+                idle_cv_.notify_all();
+            }
+        }
+
+        //调用时必须持有mutex_
+        Executor* PickExecutor() {
+            size_t n = executors_.size();
+            //先补足保证的最少线程数，多个执行器都不足时从游标开始轮流
+            for (size_t i = 0; i < n; ++i) {
+                Executor& executor = *executors_[(cursor_ + i) % n];
+                if (executor.IsRunnable() && executor.running_num_ < executor.config_.min_workers) {
+                    return &executor;
+                }
+            }
+
+            //共享线程都被占用时，即使还有任务也不能再借用保留的线程
+            int shared_num = 0;
+            for (auto& executor : executors_) {
+                shared_num += std::max(executor->running_num_ - executor->config_.min_workers, 0);
+            }
+            if (shared_num >= worker_num_ - reserved_num_) {
+                return nullptr;
+            }
+
+            Executor* picked = FindDeficit();
+            if (picked != nullptr) {
+                return picked;
+            }
+            //可以执行的执行器额度都用完了，开始新的一轮；额度可能欠了好几轮，直接补到第一个执行器额度为正为止，
+            //相当于一轮一轮地补，但不用真的循环那么多次
+            int64_t round_num = -1;
+            for (auto& executor : executors_) {
+                if (executor->IsRunnable()) {
+                    int64_t quantum = Quantum(*executor);
+                    int64_t need = -executor->deficit_ns_ / quantum + 1;
+                    round_num = round_num < 0 ? need : std::min(round_num, need);
+                }
+            }
+            if (round_num < 0) {
+                return nullptr;
+            }
+            for (auto& executor : executors_) {
+                if (executor->IsRunnable()) {
+                    executor->deficit_ns_ += round_num * Quantum(*executor);
+                }
+            }
+            return FindDeficit();
+        }
+
+        //从游标开始找第一个有剩余额度的执行器，游标停在它上面，额度用完之前一直选它
+        //没有任务排队的执行器清空剩余额度，空闲期间不能攒额度，欠的额度保留
+        Executor* FindDeficit() {
+            size_t n = executors_.size();
+            for (size_t i = 0; i < n; ++i) {
+                size_t index = (cursor_ + i) % n;
+                Executor& executor = *executors_[index];
+                if (executor.tasks_.empty()) {
+                    executor.deficit_ns_ = std::min<int64_t>(executor.deficit_ns_, 0);
+                }
+                else if (!executor.IsAtLimit() && executor.deficit_ns_ > 0) {
+                    cursor_ = index;
+                    return &executor;
+                }
+            }
+            return nullptr;
+        }
+
+        static int64_t Quantum(const Executor& executor) { return executor.config_.weight * kQuantumNs; }
+
+        bool IsEmpty() const {
+            for (auto& executor : executors_) {
+                if (!executor->tasks_.empty() || executor->running_num_ > 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        Executor* FindExecutor(const std::string& name) {
+            for (auto& executor : executors_) {
+                if (executor->name_ == name) {
+                    return executor.get();
+                }
+            }
+            return nullptr;
+        }
+
+        ExecutorStats GetStats(Executor& executor) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return StatsOf(executor);
+        }
+
+        //调用时必须持有mutex_
+        ExecutorStats StatsOf(const Executor& executor) const {
+            ExecutorStats stats;
+            stats.name = executor.name_;
+            stats.depth = executor.tasks_.size();
+            stats.running_num = executor.running_num_;
+            stats.submitted_num = executor.submitted_num_;
+            stats.rejected_num = executor.rejected_num_;
+            stats.executed_num = executor.executed_num_;
+            stats.busy_ns = executor.busy_ns_;
+            stats.queue_latency = executor.queue_latency_.Snapshot();
+            stats.run_time = executor.run_time_.Snapshot();
+            return stats;
+        }
+
+        static int64_t NowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        ThreadPool& pool_;
+        int worker_num_;
+
+        std::mutex mutex_;
+        std::condition_variable idle_cv_;
+        std::vector<std::unique_ptr<Executor>> executors_;
+        int runner_num_;
+        size_t cursor_;
+        int reserved_num_;
+    };
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __CANCELLATION__
+#define __CANCELLATION__
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace wzq {
+
+    class CancellationToken;
+
+    /**
+     * 取消信号的发出方：一个请求对应一个CancellationSource，请求的所有子任务都带上它的token，
+     * 客户端断开或者请求超时时调用Cancel，还在排队的子任务出队时直接丢弃，正在执行的任务可以通过token发现自己被取消了
+     * 可以拷贝，拷贝出来的对象共享同一个取消状态
+     */
+    class CancellationSource {
+    public:
+        CancellationSource() : state_(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void Cancel() { state_->store(true, std::memory_order_release); }
+
+        bool IsCancelled() const { return state_->load(std::memory_order_acquire); }
+
+        CancellationToken GetToken() const;
+
+    private:
+        std::shared_ptr<std::atomic<bool>> state_;
+    };
+
+    /**
+     * 取消信号的接收方，只能查询不能取消；默认构造的token永远不会被取消
+     * 线程池执行带token的任务时会把它设为当前token，任务中可以用CancellationToken::Current()轮询，不需要自己捕获
+     */
+    class CancellationToken {
+    public:
+        CancellationToken() {}
+
+        bool IsCancelled() const { return state_ != nullptr && state_->load(std::memory_order_acquire); }
+
+        //是否关联了CancellationSource，默认构造的token返回false
+        bool CanBeCancelled() const { return state_ != nullptr; }
+
+        //当前线程正在执行的任务的token，不在执行带token的任务时返回永远不会被取消的token
+        static const CancellationToken& Current() {
+            static const CancellationToken kNone;
+            const CancellationToken* current = CurrentSlot();
+            return current != nullptr ? *current : kNone;
+        }
+
+        //在作用域内把token设为当前线程的当前token，离开作用域时恢复原来的值，任务中嵌套执行其他任务时也不会错乱
+        class Scope {
+        public:
+            explicit Scope(const CancellationToken& token) : previous_(CurrentSlot()) { CurrentSlot() = &token; }
+
+            ~Scope() { CurrentSlot() = previous_; }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            const CancellationToken* previous_;
+        };
+
+    private:
+        friend class CancellationSource;
+
+        explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> state) : state_(std::move(state)) {}
+
+        static const CancellationToken*& CurrentSlot() {
+            static thread_local const CancellationToken* current = nullptr;
+            return current;
+        }
+
+        std::shared_ptr<const std::atomic<bool>> state_;
+    };
+
+    inline CancellationToken CancellationSource::GetToken() const { return CancellationToken(state_); }
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,364 @@
+#ifndef __COROUTINE__
+#define __COROUTINE__
+
+//编译器支持C++20协程时WZQ_COROUTINE为1，打开协程相关的接口；也可以在编译选项中定义WZQ_COROUTINE=0关掉
+#ifndef WZQ_COROUTINE
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define WZQ_COROUTINE 1
+#else
+#define WZQ_COROUTINE 0
+#endif
+#endif
+
+#if WZQ_COROUTINE
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/*
+C++20协程支持：Task<T>是协程的返回类型，配合ThreadPool::Schedule和TimerQueue::SleepFor使用：
+    co_await pool.Schedule();                         切换到线程池的线程中继续执行
+    co_await timer.SleepFor(std::chrono::seconds(1)); 挂起1秒，期间不占用任何线程
+    auto values = co_await coro::WhenAll(std::move(tasks));
+普通函数中用coro::Spawn启动一个协程，或者用coro::SyncWait阻塞等待协程的结果。
+协程之间的切换都是直接恢复协程句柄，不经过std::function，也不申请内存（协程帧本身除外）。
+*/
+
+namespace wzq {
+namespace coro {
+
+    template <typename T = void>
+    class Task;
+
+namespace detail {
+
+    //协程结束时直接切换到等待它的协程继续执行（对称转移），不经过线程池，栈也不会越来越深
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct PromiseBase {
+        //惰性启动：co_await这个Task时才开始执行
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase {
+        Task<T> get_return_object() noexcept;
+
+        template <typename U>
+        void return_value(U&& value) {
+            result.emplace(std::forward<U>(value));
+        }
+
+        T TakeResult() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*result);
+        }
+
+        std::optional<T> result;
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object() noexcept;
+
+        void return_void() noexcept {}
+
+        void TakeResult() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+}  // namespace detail
+
+    /**
+     * 协程的返回类型，只能移动不能拷贝
+     * co_await一个Task时它才开始在当前线程执行，执行完之后直接回到co_await它的协程，结果或者异常通过co_await返回
+     * Task析构时销毁协程帧，所以Task要活到协程执行完
+     */
+    template <typename T>
+    class Task {
+    public:
+        using promise_type = detail::Promise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        Task() noexcept : handle_(nullptr) {}
+
+        explicit Task(Handle handle) noexcept : handle_(handle) {}
+
+        Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                Destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() { Destroy(); }
+
+        bool IsValid() const noexcept { return static_cast<bool>(handle_); }
+
+        bool IsDone() const noexcept { return handle_ && handle_.done(); }
+
+        //co_await task：启动协程并等待结果
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().TakeResult(); }
+        };
+
+        Awaiter operator co_await() const noexcept { return Awaiter{handle_}; }
+
+        //co_await task.WhenReady()：启动协程并等待它执行完，但不取结果，也不抛出协程中的异常
+        struct ReadyAwaiter : Awaiter {
+            void await_resume() const noexcept {}
+        };
+
+        ReadyAwaiter WhenReady() const noexcept { return ReadyAwaiter{{handle_}}; }
+
+        //协程执行完之后取出结果，协程中抛出了异常时重新抛出，只能调用一次
+        T GetResult() { return handle_.promise().TakeResult(); }
+
+    private:
+        void Destroy() {
+            if (handle_) {
+                handle_.destroy();
+                handle_ = nullptr;
+            }
+        }
+
+        Handle handle_;
+    };
+
+namespace detail {
+
+    template <typename T>
+    Task<T> Promise<T>::get_return_object() noexcept {
+        return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> Promise<void>::get_return_object() noexcept {
+        return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+    }
+
+    //立即开始执行、结束时自己销毁协程帧的协程，用来在普通函数中启动Task
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+
+    template <typename T>
+    Detached RunDetached(Task<T> task) {
+        //和Post的任务一样，Spawn的协程抛出的异常没有地方接收，直接忽略
+        co_await task.WhenReady();
+    }
+
+    //在锁内设置完成标志并通知，等待方拿到锁之后才会返回，所以通知时状态一定还没有被销毁
+    class SyncState {
+    public:
+        void Set() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_done_ = true;
+            cv_.notify_all();
+        }
+
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return is_done_; });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool is_done_ = false;
+    };
+
+    template <typename T>
+    Detached RunAndSet(Task<T>& task, SyncState& state) {
+        co_await task.WhenReady();
+        state.Set();
+    }
+
+    //计数从子协程个数+1开始，每个子协程结束时减1，父协程启动完所有子协程后也减1，减到0的一方负责恢复父协程
+    class JoinCounter {
+    public:
+        explicit JoinCounter(size_t n) : count_(n + 1) {}
+
+        bool Arrive() noexcept { return count_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+
+        std::coroutine_handle<> parent;
+
+    private:
+        std::atomic<size_t> count_;
+    };
+
+    template <typename T>
+    Detached RunWhenAllChild(Task<T>& task, JoinCounter& counter) {
+        co_await task.WhenReady();
+        if (counter.Arrive()) {
+            counter.parent.resume();
+        }
+    }
+
+    template <typename T>
+    struct WhenAllAwaiter {
+        std::vector<Task<T>>& tasks;
+        JoinCounter& counter;
+
+        bool await_ready() const noexcept { return tasks.empty(); }
+
+        bool await_suspend(std::coroutine_handle<> parent) {
+            counter.parent = parent;
+            for (Task<T>& task : tasks) {
+                RunWhenAllChild(task, counter);
+            }
+            //所有子协程都已经同步执行完时不挂起，直接继续执行
+            return !counter.Arrive();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    //WhenAny返回后其他子协程还在执行，它们和这份状态一起由shared_ptr管理，最后一个子协程结束时销毁
+    template <typename T>
+    struct WhenAnyState {
+        explicit WhenAnyState(std::vector<Task<T>>&& t) : tasks(std::move(t)), counter(1), is_won(false), winner(0) {}
+
+        std::vector<Task<T>> tasks;
+        JoinCounter counter;
+        std::atomic<bool> is_won;
+        size_t winner;
+    };
+
+    template <typename T>
+    Detached RunWhenAnyChild(std::shared_ptr<WhenAnyState<T>> state, size_t index) {
+        co_await state->tasks[index].WhenReady();
+        if (!state->is_won.exchange(true, std::memory_order_acq_rel)) {
+            state->winner = index;
+            if (state->counter.Arrive()) {
+                state->counter.parent.resume();
+            }
+        }
+    }
+
+    template <typename T>
+    struct WhenAnyAwaiter {
+        std::shared_ptr<WhenAnyState<T>>& state;
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> parent) {
+            state->counter.parent = parent;
+            for (size_t i = 0; i < state->tasks.size(); ++i) {
+                RunWhenAnyChild(state, i);
+            }
+            return !state->counter.Arrive();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+}  // namespace detail
+
+    //在普通函数中启动一个协程，不等待它结束，协程帧在协程结束时自己销毁
+    template <typename T>
+    void Spawn(Task<T> task) {
+        detail::RunDetached(std::move(task));
+    }
+
+    //阻塞等待协程执行完并返回它的结果，协程中抛出的异常会重新抛出
+    //不要在线程池的任务中调用，协程如果需要切换到同一个线程池继续执行，可能会等不到空闲的线程
+    template <typename T>
+    T SyncWait(Task<T> task) {
+        detail::SyncState state;
+        detail::RunAndSet(task, state);
+        state.Wait();
+        return task.GetResult();
+    }
+
+    //同时启动所有协程，全部执行完后按照原来的顺序返回结果；有协程抛出异常时，等全部结束后重新抛出第一个异常
+    //子协程在co_await它的线程中依次启动，需要并行执行时在子协程中先co_await pool.Schedule()
+    template <typename T>
+    Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks) {
+        detail::JoinCounter counter(tasks.size());
+        co_await detail::WhenAllAwaiter<T>{tasks, counter};
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (Task<T>& task : tasks) {
+            results.push_back(task.GetResult());
+        }
+        co_return results;
+    }
+
+    inline Task<void> WhenAll(std::vector<Task<void>> tasks) {
+        detail::JoinCounter counter(tasks.size());
+        co_await detail::WhenAllAwaiter<void>{tasks, counter};
+        for (Task<void>& task : tasks) {
+            task.GetResult();
+        }
+    }
+
+    //同时启动所有协程，第一个执行完时就返回它的下标和结果，其他协程继续执行但结果被丢弃，tasks不能为空
+    template <typename T>
+    Task<std::pair<size_t, T>> WhenAny(std::vector<Task<T>> tasks) {
+        auto state = std::make_shared<detail::WhenAnyState<T>>(std::move(tasks));
+        co_await detail::WhenAnyAwaiter<T>{state};
+        co_return std::pair<size_t, T>(state->winner, state->tasks[state->winner].GetResult());
+    }
+
+    inline Task<size_t> WhenAny(std::vector<Task<void>> tasks) {
+        auto state = std::make_shared<detail::WhenAnyState<void>>(std::move(tasks));
+        co_await detail::WhenAnyAwaiter<void>{state};
+        state->tasks[state->winner].GetResult();
+        co_return state->winner;
+    }
+
+}  // namespace coro
+}  // namespace wzq
+
+#endif
+
+#endif
@@ -1,28 +1,59 @@
 #ifndef __COUNT_DOWN_LATCH__
 #define __COUNT_DOWN_LATCH__
 
+#include "event_count.h"
 #include "noncopyable.h"
 
-#include <condition_variable>
-#include <iostream>
-#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 namespace wzq {
+
+    /**
+     * 倒计数门闩：计数减到0之前Await一直等待，减到0之后所有等待者一起返回，计数不能重置
+     * 计数保存在原子变量里，CountDown只是一次原子减，只有减到0并且有线程在等待时才会进入内核唤醒它们
+     */
     class CountDownLatch : NonCopyAble {
     public:
-        explicit CountDownLatch(uint32_t count);
-
-        void CountDown();
-
-        void Await(uint32_t time_ms = 0);
-
-        uint32_t GetCount() const;
+        explicit CountDownLatch(uint32_t count) : count_(count) {}
+
+        //计数已经为0时不做任何事，用CAS保证计数不会减到0以下
+        void CountDown() {
+            uint32_t count = count_.load(std::memory_order_relaxed);
+            while (count != 0) {
+                if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed)) {
+                    if (count == 1) {
+                        event_.NotifyAll();
+                    }
+                    return;
+                }
+            }
+        }
+
+        //time_ms为0表示一直等待，返回时计数是否已经减到0
+        bool Await(uint32_t time_ms = 0) {
+            auto is_ready = [this] { return count_.load(std::memory_order_acquire) == 0; };
+            if (time_ms == 0) {
+                event_.Await(is_ready);
+                return true;
+            }
+            return event_.AwaitFor(is_ready, std::chrono::milliseconds(time_ms));
+        }
+
+        //在线程池的任务中等待，等待期间帮线程池执行排队的任务
+        template <typename Pool>
+        void AwaitInPool(Pool& pool) {
+            event_.AwaitInPool(pool, [this] { return count_.load(std::memory_order_acquire) == 0; });
+        }
+
+        uint32_t GetCount() const { return count_.load(std::memory_order_acquire); }
 
     private:
-        std::condition_variable cv_;
-        mutable std::mutex mutex_;
-        uint32_t count_ = 0;
+        std::atomic<uint32_t> count_;
+        EventCount event_;
     };
 }  // namespace wzq
 
-#endif
\ No newline at end of file
+#endif
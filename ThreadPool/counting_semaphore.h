@@ -0,0 +1,72 @@
+#ifndef __COUNTING_SEMAPHORE__
+#define __COUNTING_SEMAPHORE__
+
+#include "event_count.h"
+#include "noncopyable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace wzq {
+
+    /**
+     * 计数信号量：Acquire取走一个许可，没有许可时等待，Release归还许可
+     * 有许可时Acquire只是一次CAS；Release没有等待者时只有一次原子加，不会进入内核
+     */
+    class Semaphore : NonCopyAble {
+    public:
+        explicit Semaphore(uint32_t count = 0) : count_(count) {}
+
+        void Release(uint32_t n = 1) {
+            count_.fetch_add(n, std::memory_order_release);
+            event_.Notify(n);
+        }
+
+        bool TryAcquire() {
+            uint32_t count = count_.load(std::memory_order_relaxed);
+            while (count > 0) {
+                if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Acquire() {
+            while (!TryAcquire()) {
+                event_.Await([this] { return count_.load(std::memory_order_relaxed) > 0; });
+            }
+        }
+
+        //超时还没有取到许可返回false
+        template <typename Rep, typename Period>
+        bool TryAcquireFor(std::chrono::duration<Rep, Period> timeout) {
+            auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!TryAcquire()) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline ||
+                    !event_.AwaitFor([this] { return count_.load(std::memory_order_relaxed) > 0; }, deadline - now)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //在线程池的任务中等待许可，等待期间帮线程池执行排队的任务
+        template <typename Pool>
+        void AcquireInPool(Pool& pool) {
+            while (!TryAcquire()) {
+                event_.AwaitInPool(pool, [this] { return count_.load(std::memory_order_relaxed) > 0; });
+            }
+        }
+
+        uint32_t GetCount() const { return count_.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint32_t> count_;
+        EventCount event_;
+    };
+}  // namespace wzq
+
+#endif
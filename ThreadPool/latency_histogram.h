@@ -0,0 +1,178 @@
+#ifndef __LATENCY_HISTOGRAM__
+#define __LATENCY_HISTOGRAM__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wzq {
+
+    /**
+     * 对数线性分桶（HDR风格）：小于kSubBucketNum的值每个值一个桶，更大的值按2的幂分段，每段再平均分成kSubBucketNum个桶，
+     * 相对误差不超过1/kSubBucketNum，最大可以记录2^kMaxExponent-1，更大的值记在最后一个桶里
+     */
+    struct HistogramBuckets {
+        static const int kSubBucketBits = 4;
+        static const int kSubBucketNum = 1 << kSubBucketBits;
+        static const int kMaxExponent = 48;
+        static const int kBucketNum = (kMaxExponent - kSubBucketBits + 1) * kSubBucketNum;
+
+        static int IndexOf(uint64_t value) {
+            if (value < static_cast<uint64_t>(kSubBucketNum)) {
+                return static_cast<int>(value);
+            }
+            int exponent = 63 - CountLeadingZeros(value);
+            if (exponent >= kMaxExponent) {
+                return kBucketNum - 1;
+            }
+            int sub_bucket = static_cast<int>((value >> (exponent - kSubBucketBits)) & (kSubBucketNum - 1));
+            return (exponent - kSubBucketBits + 1) * kSubBucketNum + sub_bucket;
+        }
+
+        //桶中最大的值
+        static uint64_t UpperBoundOf(int index) {
+            if (index < kSubBucketNum) {
+                return static_cast<uint64_t>(index);
+            }
+            int exponent = index / kSubBucketNum + kSubBucketBits - 1;
+            uint64_t sub_bucket = static_cast<uint64_t>(index % kSubBucketNum);
+            uint64_t width = uint64_t(1) << (exponent - kSubBucketBits);
+            return (uint64_t(1) << exponent) + (sub_bucket + 1) * width - 1;
+        }
+
+        static int CountLeadingZeros(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_clzll(value);
+#else
+            int n = 0;
+            for (uint64_t bit = uint64_t(1) << 63; (value & bit) == 0; bit >>= 1) {
+                ++n;
+            }
+            return n;
+#endif
+        }
+    };
+
+    /**
+     * 某一时刻的直方图数据，可以把多个线程的直方图合并后再计算分位数
+     */
+    class HistogramSnapshot {
+    public:
+        HistogramSnapshot() : counts_(HistogramBuckets::kBucketNum, 0), count_(0), sum_(0), max_(0) {}
+
+        void Add(int index, uint64_t count) {
+            counts_[index] += count;
+            count_ += count;
+        }
+
+        void AddSum(uint64_t sum, uint64_t max_value) {
+            sum_ += sum;
+            max_ = std::max(max_, max_value);
+        }
+
+        void Merge(const HistogramSnapshot& other) {
+            for (int i = 0; i < HistogramBuckets::kBucketNum; ++i) {
+                counts_[i] += other.counts_[i];
+            }
+            count_ += other.count_;
+            AddSum(other.sum_, other.max_);
+        }
+
+        //减去同一个直方图更早的快照，得到两次快照之间记录的数据，最大值无法相减，保留较新的值
+        void Subtract(const HistogramSnapshot& earlier) {
+            for (int i = 0; i < HistogramBuckets::kBucketNum; ++i) {
+                counts_[i] -= std::min(counts_[i], earlier.counts_[i]);
+            }
+            count_ -= std::min(count_, earlier.count_);
+            sum_ -= std::min(sum_, earlier.sum_);
+        }
+
+        uint64_t Count() const { return count_; }
+
+        uint64_t Max() const { return max_; }
+
+        uint64_t Mean() const { return count_ > 0 ? sum_ / count_ : 0; }
+
+        //q取值[0, 1]，返回分位数所在桶的上界，不会超过记录到的最大值
+        uint64_t Percentile(double q) const {
+            if (count_ == 0) {
+                return 0;
+            }
+            uint64_t target = static_cast<uint64_t>(q * static_cast<double>(count_));
+            uint64_t seen = 0;
+            for (int i = 0; i < HistogramBuckets::kBucketNum; ++i) {
+                seen += counts_[i];
+                if (seen > target) {
+                    return std::min(HistogramBuckets::UpperBoundOf(i), max_);
+                }
+            }
+            return max_;
+        }
+
+    private:
+        std::vector<uint64_t> counts_;
+        uint64_t count_;
+        uint64_t sum_;
+        uint64_t max_;
+    };
+
+    /**
+     * 可以并发记录的延迟直方图，所有操作都是relaxed原子操作，不加锁
+     * 每个线程使用自己的直方图时计数器所在的缓存行不会被其他线程写，读取时再合并
+     */
+    class LatencyHistogram {
+    public:
+        LatencyHistogram() : sum_(0), max_(0) {
+            for (auto& count : counts_) {
+                count.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        void Record(uint64_t value) {
+            counts_[HistogramBuckets::IndexOf(value)].fetch_add(1, std::memory_order_relaxed);
+            sum_.fetch_add(value, std::memory_order_relaxed);
+            uint64_t max_value = max_.load(std::memory_order_relaxed);
+            while (value > max_value && !max_.compare_exchange_weak(max_value, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        //只有一个线程写入时使用，用load+store代替原子的读改写，不能和Record混用
+        void RecordLocal(uint64_t value) {
+            std::atomic<uint64_t>& count = counts_[HistogramBuckets::IndexOf(value)];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            if (value > max_.load(std::memory_order_relaxed)) {
+                max_.store(value, std::memory_order_relaxed);
+            }
+        }
+
+        void AddTo(HistogramSnapshot& snapshot) const {
+            for (int i = 0; i < HistogramBuckets::kBucketNum; ++i) {
+                uint64_t count = counts_[i].load(std::memory_order_relaxed);
+                if (count > 0) {
+                    snapshot.Add(i, count);
+                }
+            }
+            snapshot.AddSum(sum_.load(std::memory_order_relaxed), max_.load(std::memory_order_relaxed));
+        }
+
+        HistogramSnapshot Snapshot() const {
+            HistogramSnapshot snapshot;
+            AddTo(snapshot);
+            return snapshot;
+        }
+
+    private:
+        std::atomic<uint64_t> counts_[HistogramBuckets::kBucketNum];
+        std::atomic<uint64_t> sum_;
+        std::atomic<uint64_t> max_;
+    };
+
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef __PARALLEL__
+#define __PARALLEL__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+
+/*
+基于ThreadPool的并行算法：ParallelFor、ParallelReduce、ParallelTransform、ParallelScan、ParallelSort
+区间会被切成若干块交给线程池执行，调用线程自己也会处理一部分，等待期间还会帮线程池执行排队的任务，
+所以在线程池的任务中调用也不会把线程池卡住。
+*/
+
+namespace wzq {
+namespace parallel {
+
+    /**
+     * 区间的划分方式
+     * kStatic: 平均切成(线程数+1)块，每个线程一块，适合每个元素耗时差不多的情况
+     * kGuided: 所有线程共享一个游标，每次领取剩余元素的1/(2*线程数)，块越来越小，线程忙闲不均时也能自动平衡
+     *
+     * grain: 每块的最小元素个数，传0时根据区间大小自动选择
+     */
+    enum class Partition { kStatic = 0, kGuided = 1 };
+
+namespace detail {
+
+    //参与计算的线程数：线程池中的线程加上调用线程自己
+    inline size_t Participants(ThreadPool& pool) { return static_cast<size_t>(std::max(pool.GetTotalThreadSize(), 0)) + 1; }
+
+    inline size_t DefaultGrain(size_t n, size_t participants) { return std::max<size_t>(1, n / (participants * 16)); }
+
+    //串行归约，结果为value op x0 op x1 ...
+    template <typename T, typename Iter, typename BinaryOp>
+    T FoldRange(Iter first, Iter last, T value, BinaryOp& op) {
+        for (; first != last; ++first) {
+            value = op(std::move(value), *first);
+        }
+        return value;
+    }
+
+    //等待批量任务完成，等待期间帮线程池执行任务，没有任务可执行时才短暂阻塞
+    inline void HelpWait(ThreadPool& pool, std::future<void>& done) {
+        while (done.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (!pool.RunPendingTask()) {
+                done.wait_for(std::chrono::milliseconds(1));
+            }
+        }
+        done.get();
+    }
+
+    //把[0, n)切块后并行调用body(begin, end)，所有块执行完才返回，有异常时重新抛出第一个异常
+    template <typename Body>
+    void ForEachChunk(ThreadPool& pool, size_t n, Partition partition, size_t grain, const Body& body) {
+        if (n == 0) {
+            return;
+        }
+        size_t participants = Participants(pool);
+        if (grain == 0) {
+            grain = DefaultGrain(n, participants);
+        }
+        if (participants == 1 || n <= grain) {
+            body(0, n);
+            return;
+        }
+
+        std::future<void> done;
+        std::exception_ptr error;
+        //RunBulk的任务引用了下面这些局部变量，要等到HelpWait确认任务都结束以后才能析构，不能定义在分支里面
+        size_t chunk_num = std::min(participants, (n + grain - 1) / grain);
+        auto run_chunk = [&body, n, chunk_num](size_t i) { body(n * i / chunk_num, n * (i + 1) / chunk_num); };
+        std::atomic<size_t> next(0);
+        auto run_guided = [&body, &next, n, grain, participants]() {
+            for (;;) {
+                size_t begin = next.load(std::memory_order_relaxed);
+                size_t end = 0;
+                do {
+                    if (begin >= n) {
+                        return;
+                    }
+                    end = std::min(n, begin + std::max(grain, (n - begin) / (2 * participants)));
+                } while (!next.compare_exchange_weak(begin, end, std::memory_order_relaxed));
+                body(begin, end);
+            }
+        };
+        if (partition == Partition::kStatic) {
+            done = pool.RunBulk(chunk_num - 1, [&run_chunk](size_t i) { run_chunk(i + 1); });
+            try {
+                run_chunk(0);
+                //线程池不可用时剩下的块也由调用线程执行
+                for (size_t i = 1; !done.valid() && i < chunk_num; ++i) {
+                    run_chunk(i);
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+        else {
+            done = pool.RunBulk(participants - 1, [&run_guided](size_t) { run_guided(); });
+            try {
+                run_guided();
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        //任务引用了调用线程栈上的数据，即使自己出错也要等所有任务结束才能返回
+        if (done.valid()) {
+            try {
+                HelpWait(pool, done);
+            }
+            catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+}  // namespace detail
+
+    //对[first, last)中的每个下标i并行执行f(i)
+    template <typename Index, typename F>
+    void ParallelFor(ThreadPool& pool, Index first, Index last, F&& f, Partition partition = Partition::kGuided,
+        size_t grain = 0) {
+        if (!(first < last)) {
+            return;
+        }
+        size_t n = static_cast<size_t>(last - first);
+        detail::ForEachChunk(pool, n, partition, grain, [&f, first](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                f(static_cast<Index>(first + static_cast<Index>(i)));
+            }
+        });
+    }
+
+    //并行归约，结果为init op x0 op x1 ...，op需要满足结合律，各块结果按照区间顺序合并，结果是确定的
+    template <typename Iter, typename T, typename BinaryOp = std::plus<>>
+    T ParallelReduce(ThreadPool& pool, Iter first, Iter last, T init, BinaryOp op = BinaryOp(),
+        Partition partition = Partition::kGuided, size_t grain = 0) {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        std::mutex mutex;
+        std::vector<std::pair<size_t, T>> partials;
+        detail::ForEachChunk(pool, n, partition, grain, [&](size_t begin, size_t end) {
+            //先把结果存进partial再加锁，累加值不会跨过加锁的函数调用，浮点数的累加值在循环中可以一直放在寄存器里
+            std::pair<size_t, T> partial(begin, detail::FoldRange(first + begin + 1, first + end, T(*(first + begin)), op));
+            std::lock_guard<std::mutex> lock(mutex);
+            partials.push_back(std::move(partial));
+        });
+        std::sort(partials.begin(), partials.end(),
+            [](const std::pair<size_t, T>& a, const std::pair<size_t, T>& b) { return a.first < b.first; });
+        for (auto& partial : partials) {
+            init = op(std::move(init), std::move(partial.second));
+        }
+        return init;
+    }
+
+    //并行执行d_first[i] = op(first[i])，返回输出区间的末尾
+    template <typename Iter, typename OutIter, typename UnaryOp>
+    OutIter ParallelTransform(ThreadPool& pool, Iter first, Iter last, OutIter d_first, UnaryOp op,
+        Partition partition = Partition::kGuided, size_t grain = 0) {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        detail::ForEachChunk(pool, n, partition, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                *(d_first + i) = op(*(first + i));
+            }
+        });
+        return d_first + n;
+    }
+
+    //并行前缀和（包含当前元素），d_first可以等于first
+    //分两遍：先并行算出每块的归约值，串行得到每块的起始值，再并行扫描每一块
+    template <typename Iter, typename OutIter, typename BinaryOp = std::plus<>>
+    OutIter ParallelScan(ThreadPool& pool, Iter first, Iter last, OutIter d_first, BinaryOp op = BinaryOp(),
+        size_t grain = 0) {
+        using T = typename std::iterator_traits<Iter>::value_type;
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        if (n == 0) {
+            return d_first;
+        }
+        size_t participants = detail::Participants(pool);
+        if (grain == 0) {
+            grain = detail::DefaultGrain(n, participants);
+        }
+        size_t block_num = std::max<size_t>(1, std::min(participants, n / grain));
+        auto block_begin = [n, block_num](size_t b) { return n * b / block_num; };
+
+        std::vector<T> carries(block_num);
+        ParallelFor(pool, size_t(0), block_num - 1, [&](size_t b) {
+            carries[b] = detail::FoldRange(first + block_begin(b) + 1, first + block_begin(b + 1), T(*(first + block_begin(b))), op);
+        }, Partition::kStatic, 1);
+        for (size_t b = 1; b + 1 < block_num; ++b) {
+            carries[b] = op(carries[b - 1], carries[b]);
+        }
+        ParallelFor(pool, size_t(0), block_num, [&](size_t b) {
+            size_t i = block_begin(b);
+            T value = b == 0 ? T(*(first + i)) : op(carries[b - 1], *(first + i));
+            *(d_first + i) = value;
+            for (++i; i < block_begin(b + 1); ++i) {
+                value = op(std::move(value), *(first + i));
+                *(d_first + i) = value;
+            }
+        }, Partition::kStatic, 1);
+        return d_first + n;
+    }
+
+    //并行排序：先把区间切块并行std::sort，再一轮轮两两归并，不保证稳定
+    template <typename Iter, typename Compare = std::less<>>
+    void ParallelSort(ThreadPool& pool, Iter first, Iter last, Compare comp = Compare(), size_t grain = 0) {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        size_t participants = detail::Participants(pool);
+        if (grain == 0) {
+            grain = std::max<size_t>(4096, detail::DefaultGrain(n, participants));
+        }
+        size_t block_num = std::min(participants, n / grain);
+        if (block_num < 2) {
+            std::sort(first, last, comp);
+            return;
+        }
+        std::vector<size_t> bounds(block_num + 1);
+        for (size_t b = 0; b <= block_num; ++b) {
+            bounds[b] = n * b / block_num;
+        }
+        ParallelFor(pool, size_t(0), block_num, [&](size_t b) {
+            std::sort(first + bounds[b], first + bounds[b + 1], comp);
+        }, Partition::kStatic, 1);
+        for (size_t width = 1; width < block_num; width *= 2) {
+            size_t pair_num = (block_num + 2 * width - 1) / (2 * width);
+            ParallelFor(pool, size_t(0), pair_num, [&](size_t p) {
+                size_t lo = p * 2 * width;
+                size_t mid = std::min(lo + width, block_num);
+                size_t hi = std::min(lo + 2 * width, block_num);
+                if (mid < hi) {
+                    std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], comp);
+                }
+            }, Partition::kStatic, 1);
+        }
+    }
+
+}  // namespace parallel
+}  // namespace wzq
+
+#endif
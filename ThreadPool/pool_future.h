@@ -0,0 +1,589 @@
+#ifndef __POOL_FUTURE__
+#define __POOL_FUTURE__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "event_count.h"
+#include "task.h"
+
+/*
+和线程池配合使用的Future/Promise：
+1. Then(f)在结果就绪后把f放到线程池中执行，返回f结果的Future，不需要任何线程阻塞等待；
+   ThenInline(f)直接在设置结果的线程中执行f，适合只做简单计算的后续操作；f返回Future时会自动展开。
+2. WhenAll/WhenAny把一组Future合并成一个。
+3. Get/Wait在等待期间帮线程池执行排队的任务，在线程池的任务中等待其他任务的结果也不会把线程池卡死。
+共享状态和控制块由make_shared一次分配；后续操作保存在Task的内部缓冲区中，捕获的数据较少时不再申请内存。
+*/
+
+namespace wzq {
+
+    template <typename T>
+    class Future;
+
+    template <typename T>
+    class Promise;
+
+namespace detail {
+
+    //保存结果的值，void时什么都不保存
+    template <typename T>
+    class ValueHolder {
+    public:
+        ValueHolder() : has_value_(false) {}
+
+        ~ValueHolder() {
+            if (has_value_) {
+                reinterpret_cast<T*>(&storage_)->~T();
+            }
+        }
+
+        template <typename... Args>
+        void Set(Args&&... args) {
+            new (&storage_) T(std::forward<Args>(args)...);
+            has_value_ = true;
+        }
+
+        T Take() { return std::move(*reinterpret_cast<T*>(&storage_)); }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+        bool has_value_;
+    };
+
+    template <>
+    class ValueHolder<void> {
+    public:
+        void Set() {}
+        void Take() {}
+    };
+
+    /**
+     * Future和Promise之间的共享状态
+     * 结果和后续操作谁先到都可以：status_从kStart出发，先到的一方用CAS占住自己的状态，
+     * 后到的一方看到对方已经到了，就把状态改为kDone并执行后续操作，所以后续操作只会执行一次
+     */
+    template <typename T>
+    class FutureState {
+    public:
+        explicit FutureState(ThreadPool* pool) : status_(kStart), pool_(pool) {}
+
+        template <typename... Args>
+        void SetValue(Args&&... args) {
+            value_.Set(std::forward<Args>(args)...);
+            Publish();
+        }
+
+        void SetError(std::exception_ptr error) {
+            error_ = error;
+            Publish();
+        }
+
+        //设置结果就绪后的回调，结果已经就绪时在当前线程直接执行
+        void SetCallback(Task&& callback) {
+            callback_ = std::move(callback);
+            int expected = kStart;
+            if (status_.compare_exchange_strong(expected, kHasCallback, std::memory_order_acq_rel)) {
+                return;
+            }
+            status_.store(kDone, std::memory_order_relaxed);
+            RunCallback();
+        }
+
+        bool IsReady() const {
+            int status = status_.load(std::memory_order_acquire);
+            return status == kHasResult || status == kDone;
+        }
+
+        //有线程池时等待期间帮线程池执行排队的任务
+        void Wait() {
+            if (pool_ != nullptr) {
+                event_.AwaitInPool(*pool_, [this] { return IsReady(); });
+            }
+            else {
+                event_.Await([this] { return IsReady(); });
+            }
+        }
+
+        template <typename Rep, typename Period>
+        bool WaitFor(std::chrono::duration<Rep, Period> timeout) {
+            return event_.AwaitFor([this] { return IsReady(); }, timeout);
+        }
+
+        //结果就绪后取出结果，保存的是异常时重新抛出
+        T TakeValue() {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return value_.Take();
+        }
+
+        ThreadPool* GetPool() const { return pool_; }
+
+    private:
+        enum { kStart = 0, kHasResult = 1, kHasCallback = 2, kDone = 3 };
+
+        void Publish() {
+            int expected = kStart;
+            if (status_.compare_exchange_strong(expected, kHasResult, std::memory_order_acq_rel)) {
+                event_.NotifyAll();
+                return;
+            }
+            status_.store(kDone, std::memory_order_relaxed);
+            RunCallback();
+        }
+
+        //回调中通常保存着指向这个状态的shared_ptr，先移出来，执行完销毁时循环引用就解开了
+        void RunCallback() {
+            Task callback = std::move(callback_);
+            callback();
+        }
+
+        std::atomic<int> status_;
+        ValueHolder<T> value_;
+        std::exception_ptr error_;
+        Task callback_;
+        ThreadPool* pool_;
+        EventCount event_;
+    };
+
+    template <typename T>
+    using StatePtr = std::shared_ptr<FutureState<T>>;
+
+    //f返回Future<U>时，Then得到的是Future<U>而不是Future<Future<U>>
+    template <typename R>
+    struct Unwrap {
+        using type = R;
+    };
+
+    template <typename U>
+    struct Unwrap<Future<U>> {
+        using type = U;
+    };
+
+    //把一个状态的结果转交给另一个状态
+    template <typename T>
+    struct Transfer {
+        static void Run(FutureState<T>& from, FutureState<T>& to) {
+            try {
+                to.SetValue(from.TakeValue());
+            }
+            catch (...) {
+                to.SetError(std::current_exception());
+            }
+        }
+    };
+
+    template <>
+    struct Transfer<void> {
+        static void Run(FutureState<void>& from, FutureState<void>& to) {
+            try {
+                from.TakeValue();
+            }
+            catch (...) {
+                to.SetError(std::current_exception());
+                return;
+            }
+            to.SetValue();
+        }
+    };
+
+    //调用f，把返回值设置到next中，f抛出的异常也设置到next中
+    template <typename R>
+    struct Fulfill {
+        template <typename F, typename... Args>
+        static void Run(const StatePtr<R>& next, F& f, Args&&... args) {
+            next->SetValue(f(std::forward<Args>(args)...));
+        }
+    };
+
+    template <>
+    struct Fulfill<void> {
+        template <typename F, typename... Args>
+        static void Run(const StatePtr<void>& next, F& f, Args&&... args) {
+            f(std::forward<Args>(args)...);
+            next->SetValue();
+        }
+    };
+
+    template <typename U>
+    struct Fulfill<Future<U>> {
+        template <typename F, typename... Args>
+        static void Run(const StatePtr<U>& next, F& f, Args&&... args) {
+            Future<U> inner = f(std::forward<Args>(args)...);
+            if (!inner.IsValid()) {
+                next->SetError(std::make_exception_ptr(std::future_error(std::future_errc::no_state)));
+                return;
+            }
+            StatePtr<U> from = inner.Release();
+            FutureState<U>* raw = from.get();
+            raw->SetCallback([from, next]() { Transfer<U>::Run(*from, *next); });
+        }
+    };
+
+    //用前一个状态的结果调用f：T为void时f不带参数；前一个状态保存的是异常时不调用f，直接把异常传下去
+    template <typename T>
+    struct Invoke {
+        template <typename F, typename R>
+        static void Run(FutureState<T>& state, F& f, const StatePtr<R>& next) {
+            try {
+                Fulfill<std::result_of_t<F(T)>>::Run(next, f, state.TakeValue());
+            }
+            catch (...) {
+                next->SetError(std::current_exception());
+            }
+        }
+    };
+
+    template <>
+    struct Invoke<void> {
+        template <typename F, typename R>
+        static void Run(FutureState<void>& state, F& f, const StatePtr<R>& next) {
+            try {
+                state.TakeValue();
+                Fulfill<std::result_of_t<F()>>::Run(next, f);
+            }
+            catch (...) {
+                next->SetError(std::current_exception());
+            }
+        }
+    };
+
+    template <typename T, typename F>
+    struct ContinuationResult {
+        using type = typename Unwrap<std::result_of_t<F(T)>>::type;
+    };
+
+    template <typename F>
+    struct ContinuationResult<void, F> {
+        using type = typename Unwrap<std::result_of_t<F()>>::type;
+    };
+
+    //Then保存在共享状态中的回调：需要在线程池中执行时把自己Post过去，线程池不可用时在当前线程执行
+    //和BatchItem一样，被线程池拒绝或者丢弃的回调在析构时执行，保证返回的Future一定会就绪
+    template <typename T, typename F, typename R>
+    struct Continuation {
+        Continuation(StatePtr<T> s, StatePtr<R> n, F&& f, ThreadPool* p)
+            : state(std::move(s)), next(std::move(n)), func(std::move(f)), pool(p) {}
+
+        Continuation(Continuation&&) = default;
+
+        ~Continuation() {
+            if (state != nullptr) {
+                Run();
+            }
+        }
+
+        void operator()() {
+            if (pool != nullptr) {
+                ThreadPool* target = pool;
+                pool = nullptr;
+                if (target->Post(std::move(*this))) {
+                    return;
+                }
+            }
+            if (state != nullptr) {
+                Run();
+            }
+        }
+
+        void Run() {
+            StatePtr<T> current = std::move(state);
+            Invoke<T>::Run(*current, func, next);
+        }
+
+        StatePtr<T> state;
+        StatePtr<R> next;
+        F func;
+        ThreadPool* pool;
+    };
+
+}  // namespace detail
+
+    /**
+     * 只能移动的Future，Get、Then、ThenInline都会消耗掉它，之后IsValid()返回false
+     */
+    template <typename T>
+    class Future {
+    public:
+        Future() {}
+
+        explicit Future(detail::StatePtr<T> state) : state_(std::move(state)) {}
+
+        Future(Future&&) = default;
+        Future& operator=(Future&&) = default;
+
+        Future(const Future&) = delete;
+        Future& operator=(const Future&) = delete;
+
+        bool IsValid() const { return state_ != nullptr; }
+
+        bool IsReady() const { return state_->IsReady(); }
+
+        //等待结果就绪，Future来自线程池时等待期间帮线程池执行排队的任务
+        void Wait() const { state_->Wait(); }
+
+        //超时返回false，等待期间不帮线程池执行任务
+        template <typename Rep, typename Period>
+        bool WaitFor(std::chrono::duration<Rep, Period> timeout) const {
+            return state_->WaitFor(timeout);
+        }
+
+        //等待并取出结果，保存的是异常时重新抛出
+        T Get() {
+            detail::StatePtr<T> state = std::move(state_);
+            state->Wait();
+            return state->TakeValue();
+        }
+
+        //结果就绪后把f放到线程池中执行，f的参数是结果的值（T为void时没有参数）
+        //结果是异常时不执行f，异常直接传给返回的Future；没有关联线程池或者线程池不可用时在设置结果的线程中执行
+        template <typename F>
+        auto Then(F&& f) -> Future<typename detail::ContinuationResult<T, std::decay_t<F>>::type> {
+            return Continue(std::forward<F>(f), state_->GetPool());
+        }
+
+        //结果就绪后直接在设置结果的线程中执行f，已经就绪时在当前线程执行，适合很快就能执行完的后续操作
+        template <typename F>
+        auto ThenInline(F&& f) -> Future<typename detail::ContinuationResult<T, std::decay_t<F>>::type> {
+            return Continue(std::forward<F>(f), nullptr);
+        }
+
+        detail::StatePtr<T> Release() { return std::move(state_); }
+
+    private:
+        template <typename F>
+        auto Continue(F&& f, ThreadPool* pool) -> Future<typename detail::ContinuationResult<T, std::decay_t<F>>::type> {
+            using R = typename detail::ContinuationResult<T, std::decay_t<F>>::type;
+            auto next = std::make_shared<detail::FutureState<R>>(state_->GetPool());
+            detail::FutureState<T>* raw = state_.get();
+            std::decay_t<F> func(std::forward<F>(f));
+            raw->SetCallback(detail::Continuation<T, std::decay_t<F>, R>(std::move(state_), next, std::move(func), pool));
+            return Future<R>(std::move(next));
+        }
+
+        detail::StatePtr<T> state_;
+    };
+
+    /**
+     * 设置Future的结果，只能设置一次；没有设置结果就被销毁时，Future得到std::future_errc::broken_promise异常
+     * pool是Then默认使用的线程池，也是Get等待时帮忙执行任务的线程池，可以为空
+     */
+    template <typename T>
+    class Promise {
+    public:
+        explicit Promise(ThreadPool* pool = nullptr) : state_(std::make_shared<detail::FutureState<T>>(pool)), is_set_(false) {}
+
+        Promise(Promise&& other) : state_(std::move(other.state_)), is_set_(other.is_set_) {}
+
+        Promise& operator=(Promise&& other) {
+            if (this != &other) {
+                Abandon();
+                state_ = std::move(other.state_);
+                is_set_ = other.is_set_;
+            }
+            return *this;
+        }
+
+        Promise(const Promise&) = delete;
+        Promise& operator=(const Promise&) = delete;
+
+        ~Promise() { Abandon(); }
+
+        Future<T> GetFuture() { return Future<T>(state_); }
+
+        template <typename... Args>
+        void SetValue(Args&&... args) {
+            is_set_ = true;
+            state_->SetValue(std::forward<Args>(args)...);
+        }
+
+        void SetException(std::exception_ptr error) {
+            is_set_ = true;
+            state_->SetError(error);
+        }
+
+    private:
+        void Abandon() {
+            if (state_ != nullptr && !is_set_) {
+                state_->SetError(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+        }
+
+        detail::StatePtr<T> state_;
+        bool is_set_;
+    };
+
+    //已经就绪的Future
+    template <typename T>
+    Future<std::decay_t<T>> MakeReadyFuture(T&& value) {
+        auto state = std::make_shared<detail::FutureState<std::decay_t<T>>>(nullptr);
+        state->SetValue(std::forward<T>(value));
+        return Future<std::decay_t<T>>(std::move(state));
+    }
+
+    inline Future<void> MakeReadyFuture() {
+        auto state = std::make_shared<detail::FutureState<void>>(nullptr);
+        state->SetValue();
+        return Future<void>(std::move(state));
+    }
+
+    //把f放到线程池中执行，返回f结果的Future，f返回Future时自动展开；线程池不可用或任务被拒绝时返回的Future是无效的
+    template <typename F>
+    auto Async(ThreadPool& pool, F&& f) -> Future<typename detail::Unwrap<std::result_of_t<std::decay_t<F>()>>::type> {
+        using Raw = std::result_of_t<std::decay_t<F>()>;
+        using R = typename detail::Unwrap<Raw>::type;
+        auto state = std::make_shared<detail::FutureState<R>>(&pool);
+        bool is_posted = pool.Post([state, f = std::forward<F>(f)]() mutable {
+            try {
+                detail::Fulfill<Raw>::Run(state, f);
+            }
+            catch (...) {
+                state->SetError(std::current_exception());
+            }
+        });
+        return is_posted ? Future<R>(std::move(state)) : Future<R>();
+    }
+
+namespace detail {
+
+    //WhenAll/WhenAny共用的上下文：保存所有输入的状态，每个输入就绪时在设置结果的线程中执行一个很小的回调
+    //回调里保存着指向上下文的shared_ptr，所有回调执行完之后上下文才会被销毁
+    template <typename T, typename R>
+    struct WhenContext {
+        explicit WhenContext(std::vector<Future<T>>& futures) : remaining(futures.size()), is_won(false) {
+            states.reserve(futures.size());
+            for (Future<T>& future : futures) {
+                states.push_back(future.Release());
+            }
+            result = std::make_shared<FutureState<R>>(states.empty() ? nullptr : states.front()->GetPool());
+        }
+
+        std::vector<StatePtr<T>> states;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> is_won;
+        StatePtr<R> result;
+    };
+
+    template <typename T>
+    struct CollectAll {
+        using Result = std::vector<T>;
+
+        static void Finish(WhenContext<T, Result>& context) {
+            try {
+                Result values;
+                values.reserve(context.states.size());
+                for (StatePtr<T>& state : context.states) {
+                    values.push_back(state->TakeValue());
+                }
+                context.result->SetValue(std::move(values));
+            }
+            catch (...) {
+                context.result->SetError(std::current_exception());
+            }
+        }
+    };
+
+    template <>
+    struct CollectAll<void> {
+        using Result = void;
+
+        static void Finish(WhenContext<void, void>& context) {
+            try {
+                for (StatePtr<void>& state : context.states) {
+                    state->TakeValue();
+                }
+            }
+            catch (...) {
+                context.result->SetError(std::current_exception());
+                return;
+            }
+            context.result->SetValue();
+        }
+    };
+
+    template <typename T>
+    struct CollectAny {
+        using Result = std::pair<size_t, T>;
+
+        static void Finish(WhenContext<T, Result>& context, size_t index) {
+            try {
+                context.result->SetValue(index, context.states[index]->TakeValue());
+            }
+            catch (...) {
+                context.result->SetError(std::current_exception());
+            }
+        }
+    };
+
+    template <>
+    struct CollectAny<void> {
+        using Result = size_t;
+
+        static void Finish(WhenContext<void, size_t>& context, size_t index) {
+            try {
+                context.states[index]->TakeValue();
+            }
+            catch (...) {
+                context.result->SetError(std::current_exception());
+                return;
+            }
+            context.result->SetValue(index);
+        }
+    };
+
+}  // namespace detail
+
+    //所有Future都就绪后按照原来的顺序得到所有结果，有异常时等全部就绪后得到第一个异常，futures为空时返回已经就绪的Future
+    //合并结果的工作很小，直接在最后一个就绪的线程中执行
+    template <typename T>
+    Future<typename detail::CollectAll<T>::Result> WhenAll(std::vector<Future<T>> futures) {
+        using Result = typename detail::CollectAll<T>::Result;
+        auto context = std::make_shared<detail::WhenContext<T, Result>>(futures);
+        Future<Result> future(context->result);
+        if (context->states.empty()) {
+            detail::CollectAll<T>::Finish(*context);
+            return future;
+        }
+        for (size_t i = 0; i < context->states.size(); ++i) {
+            context->states[i]->SetCallback([context]() {
+                if (context->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    detail::CollectAll<T>::Finish(*context);
+                }
+            });
+        }
+        return future;
+    }
+
+    //第一个就绪的Future决定结果：得到它的下标和值（T为void时只有下标），它保存的是异常时得到这个异常
+    //其他Future的结果被丢弃；futures为空时返回的Future是无效的
+    template <typename T>
+    Future<typename detail::CollectAny<T>::Result> WhenAny(std::vector<Future<T>> futures) {
+        using Result = typename detail::CollectAny<T>::Result;
+        if (futures.empty()) {
+            return Future<Result>();
+        }
+        auto context = std::make_shared<detail::WhenContext<T, Result>>(futures);
+        Future<Result> future(context->result);
+        for (size_t i = 0; i < context->states.size(); ++i) {
+            context->states[i]->SetCallback([context, i]() {
+                if (!context->is_won.exchange(true, std::memory_order_acq_rel)) {
+                    detail::CollectAny<T>::Finish(*context, i);
+                }
+            });
+        }
+        return future;
+    }
+
+}  // namespace wzq
+
+#endif
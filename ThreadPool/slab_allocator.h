@@ -0,0 +1,326 @@
+#ifndef __SLAB_ALLOCATOR__
+#define __SLAB_ALLOCATOR__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//任务路径上的小对象(队列节点、放不进Task缓冲区的可调用对象)是否使用slab分配，定义为0时直接使用new/delete
+#ifndef WZQ_TASK_SLAB
+#define WZQ_TASK_SLAB 1
+#endif
+
+/*
+固定大小内存块的分配器，按照块大小分成32/64/128/256字节四个规格，每个规格互相独立：
+每个线程有自己的缓存，分配和释放本线程的块只操作缓存里的空闲链表，不加锁也没有原子操作；
+其他线程释放的块先在释放线程那里按所属的缓存攒成一批，攒够kBatchNum个再用一次CAS挂到所属缓存的远程链表上，
+所属线程本地链表用完时一次取走整条远程链表。都没有空闲块时才向系统申请一整块slab(kSlabBlockNum个块)。
+slab不会还给系统：线程退出时它的缓存连同空闲块一起留给之后创建的线程继续使用。
+*/
+
+namespace wzq {
+
+    /**
+     * slab分配器的统计
+     * alloc_num: 分配次数
+     * local_hit_num: 直接从本线程空闲链表分配的次数
+     * remote_hit_num: 本地链表为空时从其他线程归还的块中分配的次数
+     * miss_num: 需要向系统申请新slab的次数，slab_num: 申请过的slab个数，两者相等
+     * remote_free_num: 释放其他线程分配的块的次数
+     */
+    struct SlabStats {
+        uint64_t alloc_num = 0;
+        uint64_t local_hit_num = 0;
+        uint64_t remote_hit_num = 0;
+        uint64_t miss_num = 0;
+        uint64_t remote_free_num = 0;
+        uint64_t slab_num = 0;
+
+        //不需要向系统申请内存的比例
+        double HitRate() const {
+            return alloc_num > 0 ? static_cast<double>(local_hit_num + remote_hit_num) / alloc_num : 0.0;
+        }
+
+        void Merge(const SlabStats& other) {
+            alloc_num += other.alloc_num;
+            local_hit_num += other.local_hit_num;
+            remote_hit_num += other.remote_hit_num;
+            miss_num += other.miss_num;
+            remote_free_num += other.remote_free_num;
+            slab_num += other.slab_num;
+        }
+    };
+
+    template <size_t kBlockSize>
+    class SlabAllocator {
+    public:
+        static const size_t kSlabBlockNum = 64;
+        static const int kBatchNum = 32;
+
+        static void* Allocate() {
+            Cache* cache = LocalCache();
+            if (cache == nullptr) {
+                //线程正在退出，缓存已经交出去了，退化为直接申请
+                Block* block = static_cast<Block*>(::operator new(sizeof(Block)));
+                block->owner = nullptr;
+                return block->payload;
+            }
+            Block* block = cache->free_list;
+            if (block != nullptr) {
+                Add(cache->local_hit_num, 1);
+            }
+            else if ((block = cache->remote_list.exchange(nullptr, std::memory_order_acquire)) != nullptr) {
+                Add(cache->remote_hit_num, 1);
+            }
+            else {
+                block = NewSlab(cache);
+                Add(cache->miss_num, 1);
+            }
+            cache->free_list = block->next;
+            Add(cache->alloc_num, 1);
+            return block->payload;
+        }
+
+        static void Deallocate(void* ptr) {
+            Block* block = reinterpret_cast<Block*>(static_cast<char*>(ptr) - offsetof(Block, payload));
+            Cache* owner = block->owner;
+            if (owner == nullptr) {
+                ::operator delete(block);
+                return;
+            }
+            Cache* cache = LocalCache();
+            if (cache == owner) {
+                block->next = cache->free_list;
+                cache->free_list = block;
+                return;
+            }
+            if (cache == nullptr) {
+                PushRemote(owner, block, block);
+                return;
+            }
+            Add(cache->remote_free_num, 1);
+            Pending& pending = GetPending(cache, owner);
+            block->next = pending.head;
+            pending.head = block;
+            if (pending.tail == nullptr) {
+                pending.tail = block;
+            }
+            if (++pending.num >= kBatchNum) {
+                Flush(pending);
+            }
+        }
+
+        //所有线程的缓存的统计之和，包括已经退出的线程
+        static SlabStats GetStats() {
+            SlabStats stats;
+            std::lock_guard<std::mutex> lock(RegistryMutex());
+            for (Cache* cache = RegistryHead(); cache != nullptr; cache = cache->registry_next) {
+                stats.alloc_num += cache->alloc_num.load(std::memory_order_relaxed);
+                stats.local_hit_num += cache->local_hit_num.load(std::memory_order_relaxed);
+                stats.remote_hit_num += cache->remote_hit_num.load(std::memory_order_relaxed);
+                stats.miss_num += cache->miss_num.load(std::memory_order_relaxed);
+                stats.remote_free_num += cache->remote_free_num.load(std::memory_order_relaxed);
+            }
+            stats.slab_num = stats.miss_num;
+            return stats;
+        }
+
+    private:
+        struct Cache;
+
+        //块头记录所属的缓存，空闲时payload的开头用作链表指针
+        struct Block {
+            Cache* owner;
+            union {
+                Block* next;
+                typename std::aligned_storage<kBlockSize, alignof(std::max_align_t)>::type payload[1];
+            };
+        };
+
+        //释放线程为某个缓存攒的一批块
+        struct Pending {
+            Cache* owner = nullptr;
+            Block* head = nullptr;
+            Block* tail = nullptr;
+            int num = 0;
+        };
+
+        static const int kPendingNum = 4;
+
+        //计数器只有所属线程会写，GetStats时其他线程只读
+        struct Cache {
+            Block* free_list = nullptr;
+            std::atomic<Block*> remote_list{nullptr};
+            Pending pendings[kPendingNum];
+            std::atomic<uint64_t> alloc_num{0};
+            std::atomic<uint64_t> local_hit_num{0};
+            std::atomic<uint64_t> remote_hit_num{0};
+            std::atomic<uint64_t> miss_num{0};
+            std::atomic<uint64_t> remote_free_num{0};
+            bool is_used = false;  //由RegistryMutex保护
+            Cache* registry_next = nullptr;
+        };
+
+        //线程退出时把攒着的块都还回去，再把缓存交还给注册表
+        struct CacheHolder {
+            ~CacheHolder() {
+                Cache* cache = LocalSlot();
+                for (Pending& pending : cache->pendings) {
+                    Flush(pending);
+                }
+                LocalSlot() = nullptr;
+                IsExited() = true;
+                std::lock_guard<std::mutex> lock(RegistryMutex());
+                cache->is_used = false;
+            }
+        };
+
+        static Cache*& LocalSlot() {
+            static thread_local Cache* cache = nullptr;
+            return cache;
+        }
+
+        static bool& IsExited() {
+            static thread_local bool is_exited = false;
+            return is_exited;
+        }
+
+        static Cache* LocalCache() {
+            Cache* cache = LocalSlot();
+            if (cache != nullptr || IsExited()) {
+                return cache;
+            }
+            {
+                //优先接手已经退出的线程留下的缓存
+                std::lock_guard<std::mutex> lock(RegistryMutex());
+                for (cache = RegistryHead(); cache != nullptr && cache->is_used; cache = cache->registry_next) {
+                }
+                if (cache == nullptr) {
+                    cache = new Cache();
+                    cache->registry_next = RegistryHead();
+                    RegistryHead() = cache;
+                }
+                cache->is_used = true;
+            }
+            LocalSlot() = cache;
+            static thread_local CacheHolder holder;
+            (void)holder;
+            return cache;
+        }
+
+        //注册表和其中的缓存在程序退出时也不释放，其他静态对象析构时仍然可以释放块
+        static std::mutex& RegistryMutex() {
+            static std::mutex* mutex = new std::mutex();
+            return *mutex;
+        }
+
+        static Cache*& RegistryHead() {
+            static Cache* head = nullptr;
+            return head;
+        }
+
+        //申请一整块slab，第一个块返回给调用者(next指向其余块组成的链表)
+        static Block* NewSlab(Cache* cache) {
+            Block* blocks = static_cast<Block*>(::operator new(sizeof(Block) * kSlabBlockNum));
+            for (size_t i = 0; i < kSlabBlockNum; ++i) {
+                blocks[i].owner = cache;
+                blocks[i].next = i + 1 < kSlabBlockNum ? &blocks[i + 1] : nullptr;
+            }
+            return blocks;
+        }
+
+        //找到为owner攒块的位置，都被占用时先把攒得最多的一批还回去
+        static Pending& GetPending(Cache* cache, Cache* owner) {
+            Pending* victim = &cache->pendings[0];
+            for (Pending& pending : cache->pendings) {
+                if (pending.owner == owner) {
+                    return pending;
+                }
+                if (pending.owner == nullptr) {
+                    victim = &pending;
+                }
+                else if (victim->owner != nullptr && pending.num > victim->num) {
+                    victim = &pending;
+                }
+            }
+            Flush(*victim);
+            victim->owner = owner;
+            return *victim;
+        }
+
+        static void Flush(Pending& pending) {
+            if (pending.head != nullptr) {
+                PushRemote(pending.owner, pending.head, pending.tail);
+            }
+            pending = Pending();
+        }
+
+        static void PushRemote(Cache* owner, Block* head, Block* tail) {
+            Block* old_head = owner->remote_list.load(std::memory_order_relaxed);
+            do {
+                tail->next = old_head;
+            } while (!owner->remote_list.compare_exchange_weak(old_head, head, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+    };
+
+    //对象所在的块规格，超过256字节或者对齐要求超过max_align_t的对象不使用slab
+    constexpr size_t SlabSizeClass(size_t size) {
+        return size <= 32 ? 32 : size <= 64 ? 64 : size <= 128 ? 128 : 256;
+    }
+
+    template <typename T>
+    constexpr bool IsSlabAllocatable() {
+        return WZQ_TASK_SLAB && sizeof(T) <= 256 && alignof(T) <= alignof(std::max_align_t);
+    }
+
+    template <typename T, typename... Args>
+    typename std::enable_if<IsSlabAllocatable<T>(), T*>::type SlabNew(Args&&... args) {
+        using Allocator = SlabAllocator<SlabSizeClass(sizeof(T))>;
+        void* ptr = Allocator::Allocate();
+        try {
+            return new (ptr) T(std::forward<Args>(args)...);
+        }
+        catch (...) {
+            Allocator::Deallocate(ptr);
+            throw;
+        }
+    }
+
+    template <typename T, typename... Args>
+    typename std::enable_if<!IsSlabAllocatable<T>(), T*>::type SlabNew(Args&&... args) {
+        return new T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    typename std::enable_if<IsSlabAllocatable<T>()>::type SlabDelete(T* ptr) {
+        if (ptr != nullptr) {
+            ptr->~T();
+            SlabAllocator<SlabSizeClass(sizeof(T))>::Deallocate(ptr);
+        }
+    }
+
+    template <typename T>
+    typename std::enable_if<!IsSlabAllocatable<T>()>::type SlabDelete(T* ptr) {
+        delete ptr;
+    }
+
+    //所有规格的统计之和
+    inline SlabStats GetSlabStats() {
+        SlabStats stats;
+        stats.Merge(SlabAllocator<32>::GetStats());
+        stats.Merge(SlabAllocator<64>::GetStats());
+        stats.Merge(SlabAllocator<128>::GetStats());
+        stats.Merge(SlabAllocator<256>::GetStats());
+        return stats;
+    }
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef __TASK_ARENA__
+#define __TASK_ARENA__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "noncopyable.h"
+
+namespace wzq {
+
+    /**
+     * 请求级别的内存池：一个请求拆成多个任务时，任务之间共享的状态(请求参数、中间结果等)从arena分配，
+     * 任务只捕获指针，可调用对象能放进Task的内部缓冲区；请求结束后Reset或者析构，所有对象一次性释放，
+     * 不需要逐个delete，也不需要shared_ptr的引用计数
+     * 从arena分配的对象必须在Reset/析构之前不再被任何任务访问，通常在WaitGroup等待所有任务结束之后再释放
+     * 可以在多个线程中同时分配，内部用一把锁保护，分配只是移动指针
+     */
+    class TaskArena : NonCopyAble {
+    public:
+        static const size_t kDefaultChunkSize = 4096;
+
+        explicit TaskArena(size_t chunk_size = kDefaultChunkSize)
+            : chunk_size_(std::max<size_t>(chunk_size, 256)), chunks_(nullptr), current_(nullptr), end_(nullptr),
+              destructors_(nullptr), allocated_bytes_(0) {}
+
+        ~TaskArena() {
+            Reset();
+            FreeChunks(chunks_);
+        }
+
+        //分配size字节，align必须是2的幂
+        void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return AllocateLocked(size, align);
+        }
+
+        //在arena中构造一个对象，有非平凡析构函数的对象在Reset时按构造的逆序析构
+        template <typename T, typename... Args>
+        T* Create(Args&&... args) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            void* ptr = AllocateLocked(sizeof(T), alignof(T));
+            if (std::is_trivially_destructible<T>::value) {
+                return new (ptr) T(std::forward<Args>(args)...);
+            }
+            //先分配好析构记录，对象构造成功之后再挂上，构造抛出异常时不会析构没有构造完的对象
+            Destructor* destructor = static_cast<Destructor*>(AllocateLocked(sizeof(Destructor), alignof(Destructor)));
+            T* object = new (ptr) T(std::forward<Args>(args)...);
+            destructor->destroy = &Destroy<T>;
+            destructor->object = object;
+            destructor->next = destructors_;
+            destructors_ = destructor;
+            return object;
+        }
+
+        //析构所有对象并释放内存，保留第一块内存给下一个请求使用
+        void Reset() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (Destructor* destructor = destructors_; destructor != nullptr; destructor = destructor->next) {
+                destructor->destroy(destructor->object);
+            }
+            destructors_ = nullptr;
+            allocated_bytes_ = 0;
+            if (chunks_ == nullptr) {
+                return;
+            }
+            FreeChunks(chunks_->next);
+            chunks_->next = nullptr;
+            current_ = chunks_->Data();
+            end_ = reinterpret_cast<char*>(chunks_) + chunks_->size;
+        }
+
+        //从上次Reset到现在分配出去的字节数，包括对齐浪费的部分
+        size_t GetAllocatedBytes() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return allocated_bytes_;
+        }
+
+    private:
+        struct Chunk {
+            Chunk* next;
+            size_t size;
+
+            char* Data() { return reinterpret_cast<char*>(this) + sizeof(Chunk); }
+        };
+
+        struct Destructor {
+            void (*destroy)(void* object);
+            void* object;
+            Destructor* next;
+        };
+
+        template <typename T>
+        static void Destroy(void* object) {
+            static_cast<T*>(object)->~T();
+        }
+
+        void* AllocateLocked(size_t size, size_t align) {
+            char* ptr = AlignUp(current_, align);
+            if (current_ == nullptr || ptr + size > end_) {
+                //放不下的大对象单独占一块，块本身按max_align_t对齐
+                size_t chunk_size = std::max(chunk_size_, sizeof(Chunk) + size + align);
+                Chunk* chunk = static_cast<Chunk*>(::operator new(chunk_size));
+                chunk->size = chunk_size;
+                chunk->next = chunks_;
+                chunks_ = chunk;
+                current_ = chunk->Data();
+                end_ = reinterpret_cast<char*>(chunk) + chunk_size;
+                ptr = AlignUp(current_, align);
+            }
+            allocated_bytes_ += static_cast<size_t>(ptr + size - current_);
+            current_ = ptr + size;
+            return ptr;
+        }
+
+        static char* AlignUp(char* ptr, size_t align) {
+            uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+            return reinterpret_cast<char*>((value + align - 1) & ~(static_cast<uintptr_t>(align) - 1));
+        }
+
+        static void FreeChunks(Chunk* chunk) {
+            while (chunk != nullptr) {
+                Chunk* next = chunk->next;
+                ::operator delete(chunk);
+                chunk = next;
+            }
+        }
+
+        size_t chunk_size_;
+        Chunk* chunks_;  //最近申请的块在链表头，Reset时保留的是链表头这一块
+        char* current_;
+        char* end_;
+        Destructor* destructors_;
+        size_t allocated_bytes_;
+        std::mutex mutex_;
+    };
+
+    /**
+     * 从TaskArena分配内存的STL分配器，deallocate什么都不做，内存在arena Reset时统一释放
+     * 例如请求中临时使用的std::vector<int, ArenaAllocator<int>> values(ArenaAllocator<int>(arena));
+     */
+    template <typename T>
+    class ArenaAllocator {
+    public:
+        using value_type = T;
+
+        explicit ArenaAllocator(TaskArena& arena) noexcept : arena_(&arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena_) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T))); }
+
+        void deallocate(T*, size_t) noexcept {}
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena_; }
+
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena_ != other.arena_; }
+
+    private:
+        template <typename U>
+        friend class ArenaAllocator;
+
+        TaskArena* arena_;
+    };
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef __TASK_GRAPH__
+#define __TASK_GRAPH__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "noncopyable.h"
+#include "task.h"
+
+/*
+基于ThreadPool的任务图（有向无环图）：先用AddNode添加节点、AddEdge添加依赖，再交给线程池执行。
+某个节点的所有前驱都执行完时它才会被调度，调度不需要任何线程阻塞等待：
+执行完一个节点的线程直接接着执行一个就绪的后继，其余就绪的后继用Post放回线程池，
+线程池的线程提交的任务进入自己的本地队列，其他空闲线程可以窃取过去。
+图执行完之后可以再次执行，节点和边都不需要重新创建，执行过程中不申请内存。
+*/
+
+namespace wzq {
+
+    class TaskGraph : NonCopyAble {
+    public:
+        using NodeId = size_t;
+
+        static const NodeId kInvalidNode = static_cast<NodeId>(-1);
+
+        TaskGraph() : remaining_num_(0), is_failed_(false), pool_(nullptr), is_running_(false), is_checked_(true), is_acyclic_(true) {}
+
+        //添加一个节点，返回节点id，图正在执行时返回kInvalidNode
+        //func每次执行图时调用一次，不超过Task::kInlineSize字节时不申请堆内存
+        template <typename F>
+        NodeId AddNode(F&& func) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (is_running_) {
+                return kInvalidNode;
+            }
+            nodes_.emplace_back(std::forward<F>(func));
+            is_checked_ = false;
+            return nodes_.size() - 1;
+        }
+
+        //添加一条依赖：from执行完之后才能执行to，节点不存在、from和to相同或者图正在执行时返回false
+        //重复的边会被忽略，形成环的边在Run时才会被发现
+        bool AddEdge(NodeId from, NodeId to) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (is_running_ || from >= nodes_.size() || to >= nodes_.size() || from == to) {
+                return false;
+            }
+            std::vector<NodeId>& successors = nodes_[from].successors;
+            if (std::find(successors.begin(), successors.end(), to) != successors.end()) {
+                return true;
+            }
+            successors.push_back(to);
+            ++nodes_[to].predecessor_num;
+            is_checked_ = false;
+            return true;
+        }
+
+        //开始执行整个图，不等待执行完成，需要调用Wait等待
+        //图中有环或者图正在执行时返回false；线程池不可用时节点在调用线程中执行
+        bool RunAsync(ThreadPool& pool) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (is_running_ || !IsAcyclic()) {
+                    return false;
+                }
+                if (nodes_.empty()) {
+                    return true;
+                }
+                is_running_ = true;
+                pool_ = &pool;
+                error_ = nullptr;
+                is_failed_.store(false, std::memory_order_relaxed);
+                remaining_num_.store(nodes_.size(), std::memory_order_relaxed);
+                for (Node& node : nodes_) {
+                    node.pending_num.store(node.predecessor_num, std::memory_order_relaxed);
+                }
+            }
+            //最后一个入口节点交出去之后整个图可能马上执行完并被销毁，之后不能再访问任何成员
+            size_t root_num = roots_.size();
+            for (size_t i = 0; i + 1 < root_num; ++i) {
+                Schedule(roots_[i]);
+            }
+            Schedule(roots_[root_num - 1]);
+            return true;
+        }
+
+        //等待本次执行完成，等待期间帮线程池执行排队的任务，有节点抛出异常时重新抛出第一个异常
+        //节点抛出异常后，还没开始执行的节点都会被跳过；交给线程池的节点被关闭或者溢出策略丢弃时得到broken_promise异常
+        void Wait() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (is_running_) {
+                ThreadPool* pool = pool_;
+                lock.unlock();
+                bool is_helped = pool != nullptr && pool->RunPendingTask();
+                lock.lock();
+                if (!is_helped && is_running_) {
+                    done_cv_.wait_for(lock, std::chrono::milliseconds(1));
+                }
+            }
+            if (error_) {
+                std::exception_ptr error = error_;
+                error_ = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        //执行整个图并等待完成，图中有环或者图正在执行时返回false
+        bool Run(ThreadPool& pool) {
+            if (!RunAsync(pool)) {
+                return false;
+            }
+            Wait();
+            return true;
+        }
+
+        size_t GetNodeNum() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return nodes_.size();
+        }
+
+        bool IsRunning() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return is_running_;
+        }
+
+    private:
+        struct Node {
+            template <typename F>
+            explicit Node(F&& f) : func(std::forward<F>(f)), predecessor_num(0), pending_num(0) {}
+
+            Task func;
+            std::vector<NodeId> successors;
+            size_t predecessor_num;
+            //本次执行中还没执行完的前驱个数，减到0时节点就绪
+            std::atomic<size_t> pending_num;
+        };
+
+        //拓扑排序检查是否有环，同时收集没有前驱的入口节点，图没有变化时直接使用上次的结果
+        bool IsAcyclic() {
+            if (is_checked_) {
+                return is_acyclic_;
+            }
+            roots_.clear();
+            std::vector<size_t> degrees(nodes_.size());
+            std::vector<NodeId> ready;
+            for (NodeId id = 0; id < nodes_.size(); ++id) {
+                degrees[id] = nodes_[id].predecessor_num;
+                if (degrees[id] == 0) {
+                    roots_.push_back(id);
+                    ready.push_back(id);
+                }
+            }
+            size_t visited_num = 0;
+            while (!ready.empty()) {
+                NodeId id = ready.back();
+                ready.pop_back();
+                ++visited_num;
+                for (NodeId next : nodes_[id].successors) {
+                    if (--degrees[next] == 0) {
+                        ready.push_back(next);
+                    }
+                }
+            }
+            is_acyclic_ = visited_num == nodes_.size();
+            is_checked_ = true;
+            return is_acyclic_;
+        }
+
+        //交给线程池的任务，只能移动。线程池关闭、超时或者按照溢出策略丢弃它时，任务没有执行就被析构，
+        //析构函数把节点当作失败完成，和BatchItem一样保证remaining_num_最终减到0，Wait不会一直等下去
+        struct ScheduledNode {
+            ScheduledNode(TaskGraph* owner, NodeId node_id) noexcept : graph(owner), id(node_id) {}
+
+            ScheduledNode(ScheduledNode&& other) noexcept : graph(other.graph), id(other.id) { other.graph = nullptr; }
+
+            ScheduledNode(const ScheduledNode&) = delete;
+            ScheduledNode& operator=(const ScheduledNode&) = delete;
+            ScheduledNode& operator=(ScheduledNode&&) = delete;
+
+            ~ScheduledNode() {
+                if (graph == nullptr) {
+                    return;
+                }
+                //Post还没有返回就在当前线程被析构，说明任务被同步拒绝，由Schedule在当前线程执行
+                Posting& posting = CurrentPosting();
+                if (posting.graph == graph && posting.id == id) {
+                    return;
+                }
+                graph->Abandon(id);
+            }
+
+            void operator()() {
+                TaskGraph* owner = graph;
+                graph = nullptr;
+                owner->Execute(id);
+            }
+
+            TaskGraph* graph;
+            NodeId id;
+        };
+
+        //当前线程正在Post的节点，节点执行时可能再调度后继，所以Schedule返回前恢复原来的值
+        struct Posting {
+            TaskGraph* graph;
+            NodeId id;
+        };
+
+        static Posting& CurrentPosting() {
+            static thread_local Posting posting{ nullptr, kInvalidNode };
+            return posting;
+        }
+
+        //把就绪的节点交给线程池，线程池不可用或者按照溢出策略拒绝时直接在当前线程执行
+        //Post返回true之后节点可能已经执行完，图随时可能被销毁，不能再访问任何成员
+        void Schedule(NodeId id) {
+            Posting& posting = CurrentPosting();
+            Posting saved = posting;
+            posting = Posting{ this, id };
+            bool is_posted = pool_->Post(ScheduledNode(this, id));
+            posting = saved;
+            if (!is_posted) {
+                Execute(id);
+            }
+        }
+
+        //节点没有执行就被线程池销毁：记录broken_promise异常并标记失败，再按照正常流程跳过它和之后的节点
+        void Abandon(NodeId id) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+                }
+                is_failed_.store(true, std::memory_order_relaxed);
+            }
+            Execute(id);
+        }
+
+        //执行一个节点，然后沿着就绪的后继一直执行下去，其余就绪的后继交给线程池
+        void Execute(NodeId id) {
+            while (id != kInvalidNode) {
+                Node& node = nodes_[id];
+                if (!is_failed_.load(std::memory_order_relaxed)) {
+                    try {
+                        node.func();
+                    }
+                    catch (...) {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        if (!error_) {
+                            error_ = std::current_exception();
+                        }
+                        is_failed_.store(true, std::memory_order_relaxed);
+                    }
+                }
+
+                NodeId next = kInvalidNode;
+                for (NodeId successor : node.successors) {
+                    if (nodes_[successor].pending_num.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                        continue;
+                    }
+                    if (next == kInvalidNode) {
+                        next = successor;
+                    }
+                    else {
+                        Schedule(successor);
+                    }
+                }
+
+                //最后一个节点执行完之后Wait可能马上返回，图随时可能被销毁，不能再访问任何成员
+                if (remaining_num_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    Finish();
+                    return;
+                }
+                id = next;
+            }
+        }
+
+        //在锁内修改状态并通知，Wait拿到锁之后才会返回，所以通知时图一定还没有被销毁
+        void Finish() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_running_ = false;
+            pool_ = nullptr;
+            done_cv_.notify_all();
+        }
+
+        //节点需要地址稳定，deque在尾部添加元素时不会移动已有的元素
+        std::deque<Node> nodes_;
+        std::vector<NodeId> roots_;
+
+        std::atomic<size_t> remaining_num_;
+        std::atomic<bool> is_failed_;
+        std::exception_ptr error_;
+
+        ThreadPool* pool_;
+        bool is_running_;
+        bool is_checked_;
+        bool is_acyclic_;
+
+        std::mutex mutex_;
+        std::condition_variable done_cv_;
+    };
+}  // namespace wzq
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __WAIT_GROUP__
+#define __WAIT_GROUP__
+
+#include "event_count.h"
+#include "noncopyable.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace wzq {
+
+    /**
+     * 等待一组任务完成：提交任务前Add(n)，每个任务结束时Done()，Wait等待计数回到0
+     * 和CountDownLatch不同，计数回到0之后可以继续Add开始新的一组
+     * Done只是一次原子减，只有减到0并且有线程在等待时才会进入内核唤醒它们
+     */
+    class WaitGroup : NonCopyAble {
+    public:
+        WaitGroup() : count_(0) {}
+
+        void Add(int64_t n = 1) {
+            if (count_.fetch_add(n, std::memory_order_acq_rel) + n <= 0) {
+                event_.NotifyAll();
+            }
+        }
+
+        void Done() { Add(-1); }
+
+        void Wait() {
+            event_.Await([this] { return count_.load(std::memory_order_acquire) <= 0; });
+        }
+
+        //超时时还有任务没有完成返回false
+        template <typename Rep, typename Period>
+        bool WaitFor(std::chrono::duration<Rep, Period> timeout) {
+            return event_.AwaitFor([this] { return count_.load(std::memory_order_acquire) <= 0; }, timeout);
+        }
+
+        //在线程池的任务中等待，等待期间帮线程池执行排队的任务
+        template <typename Pool>
+        void WaitInPool(Pool& pool) {
+            event_.AwaitInPool(pool, [this] { return count_.load(std::memory_order_acquire) <= 0; });
+        }
+
+        int64_t GetCount() const { return count_.load(std::memory_order_acquire); }
+
+    private:
+        std::atomic<int64_t> count_;
+        EventCount event_;
+    };
+}  // namespace wzq
+
+#endif
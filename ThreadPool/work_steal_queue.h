@@ -0,0 +1,132 @@
+#ifndef __WORK_STEAL_QUEUE__
+#define __WORK_STEAL_QUEUE__
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace wzq {
+
+    /**
+     * 工作窃取双端队列（Chase-Lev deque）
+     * 只有拥有者线程可以调用Push/Pop，在队尾（bottom）进出，后进先出，缓存更友好；
+     * 其他线程调用Steal从队头（top）窃取，先进先出，只在和拥有者争抢最后一个元素时才需要CAS。
+     * 元素需要能放进std::atomic，线程池里存放的是任务指针。
+     */
+    template <typename T>
+    class WorkStealQueue {
+        static_assert(std::is_trivially_copyable<T>::value, "WorkStealQueue element must be trivially copyable");
+
+        //环形数组，容量为2的幂，扩容时拷贝出一个两倍大小的新数组
+        struct Array {
+            int64_t capacity;
+            int64_t mask;
+            std::atomic<T>* data;
+
+            explicit Array(int64_t cap) : capacity(cap), mask(cap - 1), data(new std::atomic<T>[cap]) {}
+            ~Array() { delete[] data; }
+
+            void Put(int64_t i, T item) { data[i & mask].store(item, std::memory_order_relaxed); }
+            T Get(int64_t i) { return data[i & mask].load(std::memory_order_relaxed); }
+
+            Array* Resize(int64_t bottom, int64_t top) {
+                Array* new_array = new Array(capacity * 2);
+                for (int64_t i = top; i != bottom; ++i) {
+                    new_array->Put(i, Get(i));
+                }
+                return new_array;
+            }
+        };
+
+    public:
+        explicit WorkStealQueue(int64_t capacity = 256) {
+            int64_t cap = 1;
+            while (cap < capacity) {
+                cap <<= 1;
+            }
+            top_.store(0);
+            bottom_.store(0);
+            array_.store(new Array(cap));
+        }
+
+        WorkStealQueue(const WorkStealQueue&) = delete;
+        WorkStealQueue& operator=(const WorkStealQueue&) = delete;
+
+        //旧数组可能还在被窃取者读取，所以扩容后不立即释放，统一在析构时回收
+        ~WorkStealQueue() {
+            for (Array* a : garbage_) {
+                delete a;
+            }
+            delete array_.load();
+        }
+
+        //拥有者线程在队尾放入元素
+        void Push(T item) {
+            int64_t b = bottom_.load(std::memory_order_relaxed);
+            int64_t t = top_.load(std::memory_order_acquire);
+            Array* a = array_.load(std::memory_order_relaxed);
+            if (b - t > a->capacity - 1) {
+                Array* new_array = a->Resize(b, t);
+                garbage_.push_back(a);
+                a = new_array;
+                array_.store(a, std::memory_order_release);
+            }
+            a->Put(b, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+
+        //拥有者线程从队尾取出元素
+        bool Pop(T& item) {
+            int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            Array* a = array_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            item = a->Get(b);
+            if (t == b) {
+                //只剩最后一个元素，和窃取者竞争
+                bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        //任意线程从队头窃取元素，竞争失败返回false，调用方可以换一个队列再试
+        bool Steal(T& item) {
+            int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom_.load(std::memory_order_acquire);
+            if (t >= b) {
+                return false;
+            }
+            Array* a = array_.load(std::memory_order_acquire);
+            item = a->Get(t);
+            return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        //近似大小，只用于判断是否有任务可偷，不保证精确
+        int64_t Size() const {
+            int64_t b = bottom_.load(std::memory_order_seq_cst);
+            int64_t t = top_.load(std::memory_order_seq_cst);
+            return b > t ? b - t : 0;
+        }
+
+        bool Empty() const { return Size() == 0; }
+
+    private:
+        std::atomic<int64_t> top_;
+        std::atomic<int64_t> bottom_;
+        std::atomic<Array*> array_;
+        std::vector<Array*> garbage_;
+    };
+
+}  // namespace wzq
+
+#endif
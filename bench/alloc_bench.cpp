@@ -0,0 +1,121 @@
+/*
+提交一个任务要申请几次堆内存：用计数的operator new统计Run、Submit、Post每个任务的申请次数和耗时，
+"legacy Run"按原来Run的写法(make_shared<packaged_task> + std::function + make_shared<future>)放进std::queue，作为对照
+g++ -std=c++14 -O2 -I../ThreadPool alloc_bench.cpp -o alloc_bench -lpthread
+./alloc_bench [每种方式的任务数]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    std::atomic<long> g_alloc_num{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    g_alloc_num.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+namespace {
+
+    // 只统计提交线程中的申请：提交count个任务，再等它们全部执行完
+    template <typename F>
+    void Measure(const char* name, long count, std::atomic<long>& done, F&& submit) {
+        done = 0;
+        long alloc_start = g_alloc_num.load();
+        auto start = Clock::now();
+        for (long i = 0; i < count; ++i) submit();
+        long alloc_num = g_alloc_num.load() - alloc_start;
+        while (done.load(std::memory_order_relaxed) != count) std::this_thread::yield();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("    %-12s %5.2f allocs/task  %6.0f ns/task\n", name, 1.0 * alloc_num / count, seconds * 1e9 / count);
+    }
+
+    // 原来的Run：三层包装，任务放在std::queue<std::function<void()>>中，由另一个线程取出执行
+    void MeasureLegacy(long count, std::atomic<long>& done) {
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool is_stop = false;
+        std::thread worker([&]() {
+            for (;;) {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&]() { return is_stop || !tasks.empty(); });
+                    if (tasks.empty()) {
+                        return;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+                task();
+            }
+        });
+        std::vector<std::shared_ptr<std::future<void>>> results;
+        results.reserve(count);
+        Measure("legacy Run", count, done, [&]() {
+            auto task = std::make_shared<std::packaged_task<void()>>([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+            std::future<void> res = task->get_future();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                tasks.emplace([task]() { (*task)(); });
+            }
+            cv.notify_one();
+            results.push_back(std::make_shared<std::future<void>>(std::move(res)));
+        });
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            is_stop = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    void RunPool(const char* name, int max_task_size, long count) {
+        ThreadPool::ThreadPoolConfig config{1, 1, max_task_size, std::chrono::seconds(4)};
+        ThreadPool pool(config);
+        pool.Start();
+        printf("%s\n", name);
+        std::atomic<long> done{0};
+        auto task = [&done]() { done.fetch_add(1, std::memory_order_relaxed); };
+        // 结果先攒起来，future的析构不算在提交里
+        std::vector<std::shared_ptr<std::future<void>>> run_results;
+        run_results.reserve(count);
+        Measure("Run", count, done, [&]() { run_results.push_back(pool.Run(task)); });
+        run_results.clear();
+        std::vector<std::future<void>> submit_results;
+        submit_results.reserve(count);
+        Measure("Submit", count, done, [&]() { submit_results.push_back(pool.Submit(task)); });
+        submit_results.clear();
+        Measure("Post", count, done, [&]() { pool.Post(task); });
+        pool.ShutDown();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? atol(argv[1]) : 200000;
+    printf("%ld tiny tasks per row, 1 worker thread\n", count);
+    std::atomic<long> done{0};
+    printf("std::queue<std::function>\n");
+    MeasureLegacy(count, done);
+    RunPool("unbounded (std::queue<Task>)", 0, count);
+    RunPool("bounded (max_task_size 1<<20)", 1 << 20, count);
+    return 0;
+}
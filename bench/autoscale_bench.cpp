@@ -0,0 +1,82 @@
+/*
+突发负载下三种线程数配置的对比：固定线程数、kOnDemand(没有空闲线程时提交任务就加Cache线程)、kAutoScale，
+每轮突发提交一批会阻塞2ms的任务，统计任务排队时间的分位数、线程数的峰值，以及突发结束后线程数能否回落
+g++ -std=c++14 -O2 -I../ThreadPool autoscale_bench.cpp -o autoscale_bench -lpthread
+./autoscale_bench [突发轮数] [每轮任务数]
+*/
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    void RunProfile(const char* name, ThreadPool::ThreadPoolConfig config, int bursts, int burst_size) {
+        ThreadPool pool(config);
+        pool.Start();
+
+        // 每毫秒采样一次线程数
+        std::atomic<bool> stop{false};
+        std::atomic<int> peak_threads{0};
+        std::thread sampler([&pool, &stop, &peak_threads]() {
+            while (!stop) {
+                int threads = pool.GetTotalThreadSize();
+                if (threads > peak_threads) peak_threads = threads;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        int count = bursts * burst_size;
+        std::vector<int64_t> wait_us(count);
+        std::atomic<int> done{0};
+        auto start = Clock::now();
+        for (int burst = 0; burst < bursts; ++burst) {
+            for (int i = 0; i < burst_size; ++i) {
+                int index = burst * burst_size + i;
+                auto post_time = Clock::now();
+                pool.Post([&wait_us, &done, index, post_time]() {
+                    wait_us[index] = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - post_time).count();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    ++done;
+                });
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+        while (done < count) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        // 突发结束后空闲一段时间，看多出来的线程有没有退出
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        int threads_after = pool.GetTotalThreadSize();
+        stop = true;
+        sampler.join();
+
+        std::sort(wait_us.begin(), wait_us.end());
+        printf("%-10s wait p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms  threads peak %2d  after idle 500ms %2d  total %.2f s\n", name,
+               wait_us[count / 2] / 1e3, wait_us[count * 99 / 100] / 1e3, wait_us.back() / 1e3, peak_threads.load(), threads_after,
+               seconds);
+        pool.ShutDown();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int bursts = argc > 1 ? atoi(argv[1]) : 5;
+    int burst_size = argc > 2 ? atoi(argv[2]) : 200;
+    printf("%d bursts of %d tasks blocking 2 ms, 200 ms apart, core_threads 4, max_threads 32, time_out 1 s\n", bursts, burst_size);
+
+    ThreadPool::ThreadPoolConfig fixed{4, 4, 0, std::chrono::seconds(1)};
+    RunProfile("fixed", fixed, bursts, burst_size);
+
+    ThreadPool::ThreadPoolConfig on_demand{4, 32, 0, std::chrono::seconds(1)};
+    on_demand.scale_policy = ThreadPool::ScalePolicy::kOnDemand;
+    RunProfile("on-demand", on_demand, bursts, burst_size);
+
+    ThreadPool::ThreadPoolConfig autoscale{4, 32, 0, std::chrono::seconds(1)};
+    autoscale.scale_policy = ThreadPool::ScalePolicy::kAutoScale;
+    RunProfile("autoscale", autoscale, bursts, burst_size);
+    return 0;
+}
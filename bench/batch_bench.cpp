@@ -0,0 +1,97 @@
+/*
+批量提交的效果：不同批大小下，逐个Post、逐个Submit、RunBatch、RunBulk提交每个任务的耗时(只算提交调用本身)，
+以及从开始提交到整批任务执行完的平均耗时
+g++ -std=c++14 -O2 -I../ThreadPool batch_bench.cpp -o batch_bench -lpthread
+./batch_bench [线程数] [每种方式的任务总数]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    // 可以放进vector的任务，RunBatch的参数
+    struct CountTask {
+        std::atomic<long>* done;
+
+        void operator()() const { done->fetch_add(1, std::memory_order_relaxed); }
+    };
+
+    struct Cost {
+        double submit_ns = 0;
+        double total_ns = 0;
+    };
+
+    // 把total个任务按batch_size分批提交，每批提交完等它执行完再提交下一批
+    template <typename F>
+    Cost Measure(long total, size_t batch_size, F&& submit_batch) {
+        Cost cost;
+        long rounds = std::max<long>(total / static_cast<long>(batch_size), 1);
+        for (long round = 0; round < rounds; ++round) {
+            auto start = Clock::now();
+            auto wait = submit_batch(batch_size);
+            auto submitted = Clock::now();
+            wait();
+            cost.submit_ns += std::chrono::duration<double, std::nano>(submitted - start).count();
+            cost.total_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        }
+        cost.submit_ns /= rounds * batch_size;
+        cost.total_ns /= rounds * batch_size;
+        return cost;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 4;
+    long total = argc > 2 ? atol(argv[2]) : 200000;
+    ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+    ThreadPool pool(config);
+    pool.Start();
+    printf("threads %d, %ld tasks per cell, ns per task: submit call / until batch done\n", threads, total);
+    printf("%6s  %17s  %17s  %17s  %17s\n", "batch", "Post loop", "Submit loop", "RunBatch", "RunBulk");
+
+    std::atomic<long> done{0};
+    CountTask task{&done};
+    auto wait_for = [&done](long target) {
+        return [&done, target]() {
+            while (done.load(std::memory_order_relaxed) < target) std::this_thread::yield();
+        };
+    };
+    std::vector<CountTask> batch;
+    std::vector<std::future<void>> futures;
+
+    for (size_t batch_size : {1, 4, 16, 64, 256, 1024, 4096}) {
+        batch.assign(batch_size, task);
+        Cost post = Measure(total, batch_size, [&](size_t n) {
+            done = 0;
+            for (size_t i = 0; i < n; ++i) pool.Post(task);
+            return wait_for(static_cast<long>(n));
+        });
+        Cost submit = Measure(total, batch_size, [&](size_t n) {
+            futures.clear();
+            for (size_t i = 0; i < n; ++i) futures.push_back(pool.Submit(task));
+            return [&futures]() {
+                for (auto& future : futures) future.wait();
+            };
+        });
+        std::future<void> batch_future;
+        Cost run_batch = Measure(total, batch_size, [&](size_t) {
+            batch_future = pool.RunBatch(batch.begin(), batch.end());
+            return [&batch_future]() { batch_future.wait(); };
+        });
+        Cost run_bulk = Measure(total, batch_size, [&](size_t n) {
+            batch_future = pool.RunBulk(n, [&done](size_t) { done.fetch_add(1, std::memory_order_relaxed); });
+            return [&batch_future]() { batch_future.wait(); };
+        });
+        printf("%6zu  %7.0f / %7.0f  %7.0f / %7.0f  %7.0f / %7.0f  %7.0f / %7.0f\n", batch_size, post.submit_ns, post.total_ns,
+               submit.submit_ns, submit.total_ns, run_batch.submit_ns, run_batch.total_ns, run_bulk.submit_ns, run_bulk.total_ns);
+    }
+    pool.ShutDown();
+    return 0;
+}
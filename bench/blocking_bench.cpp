@@ -0,0 +1,88 @@
+/*
+CPU任务和阻塞任务混合时ScopedBlocking的效果：一次提交一批任务，其中一部分是忙等200us的CPU任务，
+其余是sleep 5ms的阻塞任务(相当于阻塞的系统调用)，对比阻塞任务不加guard和用ScopedBlocking包住阻塞调用时
+整批任务的完成时间、线程数的峰值和任务结束后的线程数
+g++ -std=c++14 -O2 -I../ThreadPool blocking_bench.cpp -o blocking_bench -lpthread
+./blocking_bench [任务数]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    void BusyFor(std::chrono::microseconds duration) {
+        auto until = Clock::now() + duration;
+        while (Clock::now() < until) {
+        }
+    }
+
+    struct MixResult {
+        double millis;
+        int peak_threads;
+        int threads_after;
+    };
+
+    MixResult RunMix(int count, int blocking_percent, bool is_guarded) {
+        ThreadPool::ThreadPoolConfig config{4, 32, 0, std::chrono::seconds(1)};
+        ThreadPool pool(config);
+        pool.Start();
+        std::atomic<bool> stop{false};
+        std::atomic<int> peak_threads{0};
+        std::thread sampler([&pool, &stop, &peak_threads]() {
+            while (!stop) {
+                int threads = pool.GetTotalThreadSize();
+                if (threads > peak_threads) peak_threads = threads;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+
+        std::atomic<int> done{0};
+        auto start = Clock::now();
+        for (int i = 0; i < count; ++i) {
+            bool is_blocking = i * 100 / count < blocking_percent;
+            pool.Post([&done, is_blocking, is_guarded]() {
+                if (!is_blocking) {
+                    BusyFor(std::chrono::microseconds(200));
+                }
+                else if (is_guarded) {
+                    ThreadPool::ScopedBlocking guard;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                }
+                else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                }
+                ++done;
+            });
+        }
+        while (done < count) std::this_thread::sleep_for(std::chrono::microseconds(200));
+        MixResult result;
+        result.millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        // 多出来的线程在空闲超过time_out后退出
+        std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+        result.threads_after = pool.GetTotalThreadSize();
+        stop = true;
+        sampler.join();
+        result.peak_threads = peak_threads;
+        pool.ShutDown();
+        return result;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 400;
+    printf("%d tasks, core_threads 4, max_threads 32, time_out 1 s; CPU tasks spin 200us, blocking tasks sleep 5ms\n", count);
+    printf("blocking    no guard (ms, peak/after threads)    ScopedBlocking (ms, peak/after threads)\n");
+    for (int percent : {0, 10, 25, 50, 90}) {
+        MixResult plain = RunMix(count, percent, false);
+        MixResult guarded = RunMix(count, percent, true);
+        printf("%6d%%    %7.1f ms  %2d / %2d                  %7.1f ms  %2d / %2d\n", percent, plain.millis, plain.peak_threads,
+               plain.threads_after, guarded.millis, guarded.peak_threads, guarded.threads_after);
+    }
+    return 0;
+}
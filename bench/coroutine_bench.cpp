@@ -0,0 +1,78 @@
+/*
+大量并发等待的两种写法：n个协程各自co_await timer.SleepFor(1s)，和线程池任务在sleep_for中阻塞；
+协程等待时不占用线程，统计全部醒来的时间和内存峰值；阻塞任务只跑少量，再按线程数推算n个的耗时
+g++ -std=c++20 -O2 -I../My_Timer coroutine_bench.cpp -o coroutine_bench -lpthread
+./coroutine_bench [协程数]
+*/
+#include "timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    std::atomic<long> g_woken{0};
+
+    coro::Task<void> Sleeper(TimerQueue& timer, std::chrono::milliseconds time) {
+        co_await timer.SleepFor(time);
+        g_woken.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    long PeakRssMegabytes() {
+        long kilobytes = 0;
+        FILE* file = fopen("/proc/self/status", "r");
+        if (file == nullptr) {
+            return 0;
+        }
+        char line[256];
+        while (fgets(line, sizeof(line), file) != nullptr) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                kilobytes = atol(line + 6);
+            }
+        }
+        fclose(file);
+        return kilobytes / 1024;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? atol(argv[1]) : 1000000;
+    {
+        TimerQueue timer;
+        timer.Run();
+        auto start = Clock::now();
+        for (long i = 0; i < count; ++i) coro::Spawn(Sleeper(timer, std::chrono::milliseconds(1000)));
+        double spawn_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        while (g_woken.load() < count) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        double total_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("%ld coroutines co_await SleepFor(1s): spawned in %.2f s, all resumed after %.2f s, peak RSS %ld MB\n", count,
+               spawn_seconds, total_seconds, PeakRssMegabytes());
+    }
+    {
+        const int kThreads = 4;
+        const int kBlocked = 400;
+        ThreadPool::ThreadPoolConfig config{kThreads, kThreads, 0, std::chrono::seconds(4)};
+        ThreadPool pool(config);
+        pool.Start();
+        std::atomic<int> done{0};
+        auto start = Clock::now();
+        for (int i = 0; i < kBlocked; ++i) {
+            pool.Post([&done]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                ++done;
+            });
+        }
+        while (done < kBlocked) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        // 阻塞的任务占着线程，耗时和总的阻塞时间成正比
+        printf("%d pool tasks blocking in sleep_for(10ms) on %d threads: %.2f s -> %ld tasks blocking 1 s would take %.1f hours\n",
+               kBlocked, kThreads, seconds, count, seconds / kBlocked / 0.01 * count / 3600);
+        pool.ShutDown();
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+递归的fan-out/fan-in：并行计算fib(n)，小于cutoff的子问题串行计算。
+Future的写法用Async拆分、WhenAll合并，没有线程阻塞等待；对照组是原来的写法，任务里Run子任务再get()阻塞等待，
+线程都阻塞在get()上以后线程池就没有线程执行子任务了，超过10秒没有结果就算死锁
+g++ -std=c++14 -O2 -I../ThreadPool future_bench.cpp -o future_bench -lpthread
+./future_bench [线程数] [阻塞写法的max_threads]
+*/
+#include "ThreadPool.h"
+#include "pool_future.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    const int kCutoff = 12;
+
+    std::atomic<long> g_split_num{0};
+
+    long SerialFib(int n) { return n < 2 ? n : SerialFib(n - 1) + SerialFib(n - 2); }
+
+    Future<long> FutureFib(ThreadPool& pool, int n) {
+        if (n < kCutoff) {
+            return MakeReadyFuture(SerialFib(n));
+        }
+        g_split_num.fetch_add(1, std::memory_order_relaxed);
+        std::vector<Future<long>> parts;
+        parts.push_back(Async(pool, [&pool, n]() { return FutureFib(pool, n - 1); }));
+        parts.push_back(FutureFib(pool, n - 2));
+        return WhenAll(std::move(parts)).ThenInline([](std::vector<long> values) { return values[0] + values[1]; });
+    }
+
+    long BlockingFib(ThreadPool& pool, int n) {
+        if (n < kCutoff) {
+            return SerialFib(n);
+        }
+        auto first = pool.Run([&pool, n]() { return BlockingFib(pool, n - 1); });
+        long second = BlockingFib(pool, n - 2);
+        return first->get() + second;
+    }
+
+    double MillisSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int blocking_max_threads = argc > 2 ? atoi(argv[2]) : 64;
+    printf("pool threads %d, serial below n=%d; blocking Run()->get() with max_threads %d\n", threads, kCutoff, blocking_max_threads);
+
+    ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+    ThreadPool pool(config);
+    pool.Start();
+    for (int n : {20, 25, 30, 32}) {
+        g_split_num = 0;
+        auto start = Clock::now();
+        long value = FutureFib(pool, n).Get();
+        double millis = MillisSince(start);
+        printf("fib(%d) = %ld  continuations %8.1f ms  (%ld split nodes, %.2f us per node)\n", n, value, millis, g_split_num.load(),
+               millis * 1e3 / std::max(g_split_num.load(), 1L));
+    }
+    pool.ShutDown();
+
+    // 死锁时线程一直阻塞在get()上，线程池无法析构，只能留给进程退出时处理
+    ThreadPool::ThreadPoolConfig blocking_config{threads, blocking_max_threads, 0, std::chrono::seconds(4)};
+    ThreadPool* blocking_pool = new ThreadPool(blocking_config);
+    blocking_pool->Start();
+    for (int n : {20, 25}) {
+        auto start = Clock::now();
+        auto result = blocking_pool->Run([blocking_pool, n]() { return BlockingFib(*blocking_pool, n); });
+        if (result->wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+            printf("fib(%d)      blocking Run()->get(): deadlocked, no result after 10 s with %d threads\n", n,
+                   blocking_pool->GetTotalThreadSize());
+            fflush(stdout);
+            _exit(0);
+        }
+        printf("fib(%d) = %ld  blocking Run()->get() %8.1f ms\n", n, result->get(), MillisSince(start));
+    }
+    blocking_pool->ShutDown();
+    delete blocking_pool;
+    return 0;
+}
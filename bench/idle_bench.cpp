@@ -0,0 +1,86 @@
+/*
+线程空闲时两种等待方式的对比：间隔提交任务时的唤醒延迟、任务链(每个任务提交下一个)的吞吐，以及完全空闲时占用的CPU时间
+g++ -std=c++14 -O2 -I../ThreadPool idle_bench.cpp -o idle_bench -lpthread
+./idle_bench [线程数]
+*/
+#include "ThreadPool.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    double ProcessCpuSeconds() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    // 每隔interval提交一个任务，统计从提交到开始执行的时间
+    void WakeLatency(ThreadPool& pool, std::chrono::microseconds interval, int count) {
+        std::vector<int64_t> latency_ns(count);
+        std::atomic<int> done{0};
+        for (int i = 0; i < count; ++i) {
+            auto post_time = Clock::now();
+            pool.Post([&latency_ns, &done, i, post_time]() {
+                latency_ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - post_time).count();
+                ++done;
+            });
+            auto until = post_time + interval;
+            while (Clock::now() < until) {
+            }
+        }
+        while (done < count) std::this_thread::yield();
+        std::sort(latency_ns.begin(), latency_ns.end());
+        printf("    wake latency every %4lld us   p50 %7lld ns  p99 %8lld ns\n", (long long)interval.count(),
+               (long long)latency_ns[count / 2], (long long)latency_ns[count * 99 / 100]);
+    }
+
+    // 每个任务执行时提交下一个任务，其他线程都处于空闲状态，衡量唤醒和交接的开销
+    void ChainThroughput(ThreadPool& pool, int length) {
+        std::atomic<int> remaining{length};
+        std::function<void()> step = [&pool, &remaining, &step]() {
+            if (--remaining > 0) pool.Post(step);
+        };
+        auto start = Clock::now();
+        pool.Post(step);
+        while (remaining > 0) std::this_thread::yield();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("    task chain of %d           %.0f ns/hop\n", length, seconds * 1e9 / length);
+    }
+
+    void RunPolicy(const char* name, ThreadPool::IdlePolicy policy, int threads) {
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        config.idle_policy = policy;
+        ThreadPool pool(config);
+        pool.Start();
+        printf("%s\n", name);
+
+        WakeLatency(pool, std::chrono::microseconds(20), 20000);
+        WakeLatency(pool, std::chrono::microseconds(1000), 500);
+        ChainThroughput(pool, 200000);
+
+        // 线程池完全空闲时主线程只睡眠，进程的CPU时间基本都是空闲线程消耗的
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        double cpu_start = ProcessCpuSeconds();
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        printf("    idle for 500 ms           %.1f ms cpu\n", (ProcessCpuSeconds() - cpu_start) * 1e3);
+        pool.ShutDown();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 4;
+    printf("threads %d\n", threads);
+    RunPolicy("kBlock", ThreadPool::IdlePolicy::kBlock, threads);
+    RunPolicy("kSpinThenPark", ThreadPool::IdlePolicy::kSpinThenPark, threads);
+    return 0;
+}
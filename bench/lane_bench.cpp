@@ -0,0 +1,96 @@
+/*
+任务通道的效果：大量普通任务排队时高优先级任务的排队延迟，以及kWeightedFair下各通道实际分到的执行份额
+g++ -std=c++14 -O2 -I../ThreadPool lane_bench.cpp -o lane_bench -lpthread
+./lane_bench [线程数]
+*/
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    void BusyFor(std::chrono::microseconds duration) {
+        auto until = Clock::now() + duration;
+        while (Clock::now() < until) {
+        }
+    }
+
+    // 先放入flood个20us的普通任务，再每隔1ms提交一个探测任务，统计探测任务从提交到开始执行的时间
+    void ProbeLatency(const char* name, ThreadPool::LanePolicy policy, ThreadPool::TaskPriority probe_priority, int threads) {
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        config.lane_policy = policy;
+        ThreadPool pool(config);
+        pool.Start();
+
+        const int kFlood = 20000;
+        const int kProbe = 100;
+        std::atomic<int> flood_done{0};
+        for (int i = 0; i < kFlood; ++i) {
+            pool.Post([&flood_done]() {
+                BusyFor(std::chrono::microseconds(20));
+                ++flood_done;
+            });
+        }
+
+        std::vector<int64_t> latency_us(kProbe);
+        std::atomic<int> probe_done{0};
+        for (int i = 0; i < kProbe; ++i) {
+            auto post_time = Clock::now();
+            pool.PostOnLane(probe_priority, [&latency_us, &probe_done, i, post_time]() {
+                latency_us[i] = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - post_time).count();
+                ++probe_done;
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        while (probe_done < kProbe || flood_done < kFlood) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        std::sort(latency_us.begin(), latency_us.end());
+        printf("%-34s probe latency p50 %7lld us  p99 %7lld us  max %7lld us\n", name, (long long)latency_us[kProbe / 2],
+               (long long)latency_us[kProbe * 99 / 100], (long long)latency_us.back());
+        pool.ShutDown();
+    }
+
+    // 三条内置通道各放入足够多的任务，运行一段时间后看各通道执行了多少个
+    void WeightedShare(int threads) {
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        config.lane_policy = ThreadPool::LanePolicy::kWeightedFair;
+        ThreadPool pool(config);
+        pool.Start();
+
+        const int kPerLane = 20000;
+        std::atomic<int> executed[3] = {{0}, {0}, {0}};
+        std::atomic<bool> stop{false};
+        for (int i = 0; i < kPerLane; ++i) {
+            for (int lane = 0; lane < 3; ++lane) {
+                pool.PostOnLane(lane, [&executed, &stop, lane]() {
+                    if (stop) return;
+                    BusyFor(std::chrono::microseconds(10));
+                    ++executed[lane];
+                });
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        stop = true;
+        printf("kWeightedFair share (weights 16:4:1)  high %d  normal %d  low %d  ->  %.1f : %.1f : 1\n", executed[0].load(),
+               executed[1].load(), executed[2].load(), 1.0 * executed[0] / std::max(1, executed[2].load()),
+               1.0 * executed[1] / std::max(1, executed[2].load()));
+        pool.ShutDown();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 4;
+    printf("threads %d\n", threads);
+    ProbeLatency("probe on kNormal (FIFO behind flood)", ThreadPool::LanePolicy::kStrictPriority, ThreadPool::TaskPriority::kNormal, threads);
+    ProbeLatency("probe on kHigh, kStrictPriority", ThreadPool::LanePolicy::kStrictPriority, ThreadPool::TaskPriority::kHigh, threads);
+    ProbeLatency("probe on kHigh, kWeightedFair", ThreadPool::LanePolicy::kWeightedFair, ThreadPool::TaskPriority::kHigh, threads);
+    WeightedShare(threads);
+    return 0;
+}
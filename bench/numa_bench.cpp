@@ -0,0 +1,100 @@
+/*
+线程绑定和NUMA感知提交的效果：每个节点一块数据，由该节点上的线程首次写入，再提交大量顺序读这块数据的任务，
+对比不绑定线程、按cpu_list绑定和kSpread加PostOnNode三种方式的读带宽，以及任务执行期间线程换CPU的次数
+g++ -std=c++14 -O2 -I../ThreadPool numa_bench.cpp -o numa_bench -lpthread
+./numa_bench [每个节点的数据MB数] [每个节点的任务数]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+using namespace wzq;
+
+namespace {
+
+    std::atomic<long> g_migrations{0};
+
+    // 同一个线程相邻两次执行任务时所在的CPU不同就算一次迁移
+    void CountMigration() {
+        static thread_local int last_cpu = -1;
+        int cpu = CpuTopology::CurrentCpu();
+        if (last_cpu >= 0 && cpu != last_cpu) {
+            g_migrations.fetch_add(1, std::memory_order_relaxed);
+        }
+        last_cpu = cpu;
+    }
+
+    void RunMode(const char* name, ThreadPool::AffinityMode affinity, bool is_node_aware, size_t bytes_per_node, int tasks_per_node) {
+        const CpuTopology& topology = CpuTopology::Get();
+        int threads = static_cast<int>(std::thread::hardware_concurrency());
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        config.affinity = affinity;
+        for (int node = 0; node < topology.NodeNum(); ++node) {
+            config.cpu_list.insert(config.cpu_list.end(), topology.NodeCpus(node).begin(), topology.NodeCpus(node).end());
+        }
+        ThreadPool pool(config);
+        pool.Start();
+
+        int node_num = pool.GetNumaNodeNum();
+        size_t count = bytes_per_node / sizeof(long);
+        std::vector<std::unique_ptr<long[]>> buffers(node_num);
+        auto post = [&pool, is_node_aware](int node, std::function<void()> task) {
+            if (is_node_aware) {
+                pool.PostOnNode(node, std::move(task));
+            }
+            else {
+                pool.Post(std::move(task));
+            }
+        };
+
+        // 第一次写入决定物理页所在的节点
+        std::atomic<int> done{0};
+        for (int node = 0; node < node_num; ++node) {
+            buffers[node].reset(new long[count]);
+            long* data = buffers[node].get();
+            post(node, [data, count, &done]() {
+                for (size_t i = 0; i < count; ++i) data[i] = static_cast<long>(i);
+                ++done;
+            });
+        }
+        while (done < node_num) std::this_thread::yield();
+
+        g_migrations = 0;
+        done = 0;
+        std::atomic<long> checksum{0};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < tasks_per_node; ++i) {
+            for (int node = 0; node < node_num; ++node) {
+                const long* data = buffers[node].get();
+                post(node, [data, count, &done, &checksum]() {
+                    CountMigration();
+                    long sum = 0;
+                    for (size_t j = 0; j < count; ++j) sum += data[j];
+                    checksum.fetch_add(sum, std::memory_order_relaxed);
+                    ++done;
+                });
+            }
+        }
+        while (done < tasks_per_node * node_num) std::this_thread::yield();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double gigabytes = 1.0 * bytes_per_node * tasks_per_node * node_num / 1e9;
+        printf("%-26s nodes %d threads %d  %.1f ms  %.2f GB/s  migrations %ld\n", name, node_num, threads, seconds * 1e3,
+               gigabytes / seconds, g_migrations.load());
+        pool.ShutDown();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 16;
+    int tasks_per_node = argc > 2 ? atoi(argv[2]) : 200;
+    const CpuTopology& topology = CpuTopology::Get();
+    printf("numa nodes %d, %zu MB per node, %d tasks per node\n", topology.NodeNum(), megabytes, tasks_per_node);
+    RunMode("kNone + Post", ThreadPool::AffinityMode::kNone, false, megabytes << 20, tasks_per_node);
+    RunMode("kCpuList + Post", ThreadPool::AffinityMode::kCpuList, false, megabytes << 20, tasks_per_node);
+    RunMode("kSpread + PostOnNode", ThreadPool::AffinityMode::kSpread, true, megabytes << 20, tasks_per_node);
+    return 0;
+}
@@ -0,0 +1,82 @@
+/*
+wzq::parallel中各个并行算法和对应的串行标准库算法的耗时对比
+g++ -std=c++14 -O2 -I../ThreadPool parallel_bench.cpp -o parallel_bench -lpthread
+./parallel_bench [线程数] [元素个数]
+*/
+#include "parallel.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace wzq;
+using namespace wzq::parallel;
+
+namespace {
+
+    // 重复执行f取最好的一次，单位毫秒
+    template <typename F>
+    double BestMs(F&& f, int repeat = 5) {
+        double best = 1e30;
+        for (int i = 0; i < repeat; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            f();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void Report(const char* name, double serial_ms, double parallel_ms) {
+        printf("  %-22s serial %8.2f ms   parallel %8.2f ms   speedup %.2fx\n", name, serial_ms, parallel_ms, serial_ms / parallel_ms);
+    }
+
+    void RunPartition(ThreadPool& pool, Partition partition, size_t n) {
+        std::vector<double> input(n), output(n);
+        std::mt19937 rng(1);
+        for (auto& x : input) x = rng() % 1000000;
+
+        auto heavy = [](double x) { return std::sqrt(x) * std::log(x + 1.0); };
+        Report("ParallelFor", BestMs([&] { for (size_t i = 0; i < n; ++i) output[i] = heavy(input[i]); }),
+               BestMs([&] { ParallelFor(pool, size_t(0), n, [&](size_t i) { output[i] = heavy(input[i]); }, partition); }));
+
+        volatile double sink = 0;
+        Report("ParallelReduce", BestMs([&] { sink = std::accumulate(input.begin(), input.end(), 0.0); }),
+               BestMs([&] { sink = ParallelReduce(pool, input.begin(), input.end(), 0.0, std::plus<>(), partition); }));
+
+        Report("ParallelTransform", BestMs([&] { std::transform(input.begin(), input.end(), output.begin(), heavy); }),
+               BestMs([&] { ParallelTransform(pool, input.begin(), input.end(), output.begin(), heavy, partition); }));
+
+        // 很小的区间，衡量一次fork/join本身的开销
+        std::vector<double> small(1000);
+        double serial_us = BestMs([&] { for (auto& x : small) x += 1; }, 1000) * 1e3;
+        double parallel_us = BestMs([&] { ParallelFor(pool, size_t(0), small.size(), [&](size_t i) { small[i] += 1; }, partition); }, 1000) * 1e3;
+        printf("  %-22s serial %8.2f us   parallel %8.2f us\n", "ParallelFor n=1000", serial_us, parallel_us);
+        (void)sink;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    size_t n = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 4000000;
+    if (threads <= 0) threads = 4;
+
+    ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+    ThreadPool pool(config);
+    pool.Start();
+    printf("threads %d n %zu\n", threads, n);
+
+    printf("kStatic\n");
+    RunPartition(pool, Partition::kStatic, n);
+    printf("kGuided\n");
+    RunPartition(pool, Partition::kGuided, n);
+
+    std::vector<int> data(n);
+    std::mt19937 rng(2);
+    for (auto& x : data) x = static_cast<int>(rng());
+    printf("sort\n");
+    Report("ParallelSort", BestMs([&] { auto copy = data; std::sort(copy.begin(), copy.end()); }, 3),
+           BestMs([&] { auto copy = data; ParallelSort(pool, copy.begin(), copy.end()); }, 3));
+    return 0;
+}
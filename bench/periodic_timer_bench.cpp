@@ -0,0 +1,125 @@
+/*
+周期定时器的开销：n个kFixedRateSkip周期定时器，周期1毫秒，稳定运行2秒，
+统计每秒触发次数、CPU占用、每次触发的CPU时间和operator new次数，以及平均延迟和每个定时器最大延迟的分布(抖动)
+延迟是实际执行时间减去按周期排好的触发时间；单核上n很大时触发不过来，这时数字反映的是每次触发的开销
+g++ -std=c++14 -O2 -I../My_Timer periodic_timer_bench.cpp -o periodic_timer_bench -lpthread
+./periodic_timer_bench [周期(us)] [w表示时间轮后端]
+*/
+#include "timer.h"
+
+#include <sys/resource.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    std::atomic<long> g_alloc_num{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    g_alloc_num.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+namespace {
+
+    std::atomic<long> g_fire_num{0};
+
+    int64_t NowNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    }
+
+    double CpuSeconds() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+    }
+
+    // 每个定时器自己的统计，只在它自己的任务中修改，同一个定时器的任务不会重叠执行
+    struct Jitter {
+        int64_t next_ns;
+        int64_t period_ns;
+        int64_t max_late_ns;
+        int64_t late_sum_ns;
+        long late_num;
+    };
+
+    void RunPeriodic(int count, int period_us, TimerQueue::TimerBackend backend) {
+        TimerQueue timer(backend);
+        timer.Run();
+        int64_t period_ns = period_us * 1000LL;
+        std::vector<Jitter> jitters(count);
+        std::vector<TimerHandle> handles;
+        handles.reserve(count);
+        for (Jitter& jitter : jitters) {
+            jitter = Jitter{NowNanos() + period_ns, period_ns, 0, 0, 0};
+            Jitter* ptr = &jitter;
+            handles.push_back(timer.AddPeriodicFunc(TimerQueue::RepeatMode::kFixedRateSkip, std::chrono::microseconds(period_us), [ptr]() {
+                int64_t now_ns = NowNanos();
+                ptr->max_late_ns = std::max(ptr->max_late_ns, now_ns - ptr->next_ns);
+                ptr->late_sum_ns += now_ns - ptr->next_ns;
+                ++ptr->late_num;
+                // 和kFixedRateSkip一样，错过的周期直接跳过
+                ptr->next_ns += ptr->period_ns;
+                if (ptr->next_ns <= now_ns) ptr->next_ns += ((now_ns - ptr->next_ns) / ptr->period_ns + 1) * ptr->period_ns;
+                g_fire_num.fetch_add(1, std::memory_order_relaxed);
+            }));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));  // 预热，之后只统计稳定状态
+        for (Jitter& jitter : jitters) {
+            jitter.max_late_ns = 0;
+            jitter.late_sum_ns = 0;
+            jitter.late_num = 0;
+        }
+        long fire_start = g_fire_num.load();
+        long alloc_start = g_alloc_num.load();
+        double cpu_start = CpuSeconds();
+        auto start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        long fire_num = g_fire_num.load() - fire_start;
+        long alloc_num = g_alloc_num.load() - alloc_start;
+        double cpu = CpuSeconds() - cpu_start;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (TimerHandle& handle : handles) handle.Cancel();
+        timer.Stop();
+
+        std::vector<int64_t> late;
+        double late_sum_ns = 0;
+        long late_num = 0;
+        for (const Jitter& jitter : jitters) {
+            late.push_back(jitter.max_late_ns);
+            late_sum_ns += jitter.late_sum_ns;
+            late_num += jitter.late_num;
+        }
+        std::sort(late.begin(), late.end());
+        fire_num = std::max(fire_num, 1L);
+        printf("%6d timers  %8.0f fires/s (ideal %9.0f)  cpu %3.0f%%  %5.2f us cpu/fire  %.4f allocs/fire  lateness mean %7.1f us, per-timer max p50 %7.1f us p99 %7.1f us\n",
+               count, fire_num / seconds, count * 1e6 / period_us, cpu / seconds * 100, cpu * 1e6 / fire_num, 1.0 * alloc_num / fire_num,
+               late_sum_ns / std::max(late_num, 1L) / 1e3, late[late.size() / 2] / 1e3, late[late.size() * 99 / 100] / 1e3);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int period_us = argc > 1 ? atoi(argv[1]) : 1000;
+    bool is_wheel = argc > 2 && argv[2][0] == 'w';
+    printf("kFixedRateSkip periodic timers, period %d us, %s backend, 2 s steady state after 300 ms warm-up\n", period_us,
+           is_wheel ? "wheel" : "heap");
+    for (int count : {100, 1000, 100000}) {
+        RunPeriodic(count, period_us, is_wheel ? TimerQueue::TimerBackend::kWheel : TimerQueue::TimerBackend::kHeap);
+    }
+    return 0;
+}
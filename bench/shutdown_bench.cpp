@@ -0,0 +1,114 @@
+/*
+线程池启动和关闭的耗时：Start创建全部核心线程，ShutDown执行完排队的任务并join所有线程，
+ShutDownNow丢弃排队的任务，以及ShutDown(timeout)在任务执行不完时按时返回
+g++ -std=c++14 -O2 -I../ThreadPool shutdown_bench.cpp -o shutdown_bench -lpthread
+./shutdown_bench [排队的任务数]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    double MillisSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // 每个线程先被一个等待gate的任务占住，保证后面的任务都在队列里排队
+    void BlockWorkers(ThreadPool& pool, int threads, std::atomic<bool>& gate, std::atomic<int>& blocked) {
+        for (int i = 0; i < threads; ++i) {
+            pool.Post([&gate, &blocked]() {
+                ++blocked;
+                while (!gate) std::this_thread::yield();
+            });
+        }
+        while (blocked < threads) std::this_thread::yield();
+    }
+
+    void RunThreads(int threads, int queued) {
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        auto task = []() {
+            volatile int sink = 0;
+            for (int i = 0; i < 1000; ++i) sink = sink + i;
+        };
+
+        // ShutDown：执行完排队的任务再退出
+        double start_ms = 0;
+        double drain_ms = 0;
+        ThreadPool::ShutDownStats drain_stats{};
+        {
+            ThreadPool pool(config);
+            auto start = Clock::now();
+            pool.Start();
+            start_ms = MillisSince(start);
+            std::atomic<bool> gate{false};
+            std::atomic<int> blocked{0};
+            BlockWorkers(pool, threads, gate, blocked);
+            for (int i = 0; i < queued; ++i) pool.Post(task);
+            start = Clock::now();
+            gate = true;
+            drain_stats = pool.ShutDown();
+            drain_ms = MillisSince(start);
+        }
+
+        // ShutDownNow：丢弃排队的任务，只等正在执行的任务
+        double now_ms = 0;
+        ThreadPool::ShutDownStats now_stats{};
+        {
+            ThreadPool pool(config);
+            pool.Start();
+            std::atomic<bool> gate{false};
+            std::atomic<int> blocked{0};
+            BlockWorkers(pool, threads, gate, blocked);
+            for (int i = 0; i < queued; ++i) pool.Post(task);
+            auto start = Clock::now();
+            gate = true;
+            now_stats = pool.ShutDownNow();
+            now_ms = MillisSince(start);
+        }
+
+        // ShutDown(5ms)：每个线程都在执行50ms的任务，到时间后返回，剩下的线程由析构函数join
+        double timeout_ms = 0;
+        double destroy_ms = 0;
+        ThreadPool::ShutDownStats timeout_stats{};
+        {
+            auto start = Clock::now();
+            {
+                ThreadPool pool(config);
+                pool.Start();
+                std::atomic<int> running{0};
+                for (int i = 0; i < threads; ++i) {
+                    pool.Post([&running]() {
+                        ++running;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    });
+                }
+                while (running < threads) std::this_thread::yield();
+                for (int i = 0; i < queued; ++i) pool.Post(task);
+                start = Clock::now();
+                timeout_stats = pool.ShutDown(std::chrono::milliseconds(5));
+                timeout_ms = MillisSince(start);
+            }
+            destroy_ms = MillisSince(start);
+        }
+
+        printf("%3d  %7.2f  %7.2f (done %5llu)  %7.2f (dropped %5llu)  %6.2f is_finished %d (dropped %5llu), destroyed %6.2f\n", threads,
+               start_ms, drain_ms, (unsigned long long)drain_stats.completed_num, now_ms, (unsigned long long)now_stats.dropped_num,
+               timeout_ms, timeout_stats.is_finished, (unsigned long long)timeout_stats.dropped_num, destroy_ms);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int queued = argc > 1 ? atoi(argv[1]) : 1000;
+    printf("%d queued tasks, times in ms\n", queued);
+    printf("thr  Start    ShutDown (done含占住线程的任务)  ShutDownNow             ShutDown(5ms), 线程在执行50ms的任务\n");
+    for (int threads : {1, 4, 16, 64}) {
+        RunThreads(threads, queued);
+    }
+    return 0;
+}
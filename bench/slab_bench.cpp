@@ -0,0 +1,143 @@
+/*
+slab分配器和glibc malloc的对比：
+1. 工作窃取模式下任务里递归提交捕获120字节的任务(放不进Task的缓冲区)，统计每个任务的耗时、operator new次数和slab命中率；
+   加-DWZQ_TASK_SLAB=0编译就是原来的new/delete，GLIBC_TUNABLES=glibc.malloc.tcache_count=0运行时关掉glibc的线程缓存
+2. 直接分配128字节的块，每批4096个：同一个线程分配释放，和一个线程分配、另一个线程释放
+g++ -std=c++14 -O2 -I../ThreadPool slab_bench.cpp -o slab_bench -lpthread
+./slab_bench [线程数] [递归深度]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    std::atomic<long> g_alloc_num{0};
+
+}  // namespace
+
+void* operator new(size_t size) {
+    g_alloc_num.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+namespace {
+
+    const size_t kBatch = 4096;
+
+    std::atomic<long> g_done{0};
+
+    struct Payload {
+        char data[104];
+    };
+
+    void Spawn(ThreadPool* pool, int depth, const Payload& payload) {
+        g_done.fetch_add(1, std::memory_order_relaxed);
+        if (depth == 0) return;
+        pool->Post([pool, depth, payload]() { Spawn(pool, depth - 1, payload); });
+        pool->Post([pool, depth, payload]() { Spawn(pool, depth - 1, payload); });
+    }
+
+    void RunFanOut(int threads, int depth) {
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        config.schedule_mode = ThreadPool::ScheduleMode::kWorkStealing;
+        ThreadPool pool(config);
+        pool.Start();
+        long total = (1L << (depth + 1)) - 1;
+        Payload payload{};
+        g_done = 0;
+        long alloc_start = g_alloc_num.load();
+        auto start = Clock::now();
+        pool.Post([&pool, depth, payload]() { Spawn(&pool, depth, payload); });
+        while (g_done.load(std::memory_order_relaxed) != total) std::this_thread::yield();
+        double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        long alloc_num = g_alloc_num.load() - alloc_start;
+        SlabStats slab = pool.GetStats().slab;
+        printf("fan-out %ld tasks with %zu-byte captures, %d threads, WZQ_TASK_SLAB=%d\n", total, sizeof(Payload) + 16, threads,
+               WZQ_TASK_SLAB);
+        printf("    %.0f ns/task, %.3f operator new per task, slab allocs %llu hit rate %.1f%% (local %llu remote %llu miss %llu)\n",
+               nanos / total, 1.0 * alloc_num / total, (unsigned long long)slab.alloc_num, slab.HitRate() * 100,
+               (unsigned long long)slab.local_hit_num, (unsigned long long)slab.remote_hit_num, (unsigned long long)slab.miss_num);
+        pool.ShutDown();
+    }
+
+    struct MallocBlock {
+        static void* Allocate() { return malloc(128); }
+        static void Deallocate(void* ptr) { free(ptr); }
+    };
+
+    // 同一个线程分配一批再全部释放，返回每对分配释放的耗时(ns)
+    template <typename Allocator>
+    double SameThreadNanos(int rounds) {
+        std::vector<void*> blocks(kBatch);
+        auto start = Clock::now();
+        for (int round = 0; round < rounds; ++round) {
+            for (void*& block : blocks) block = Allocator::Allocate();
+            for (void* block : blocks) Allocator::Deallocate(block);
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (rounds * kBatch);
+    }
+
+    // 主线程分配一批交给另一个线程释放，两边轮流进行，分别统计每次分配和释放的耗时(ns)
+    template <typename Allocator>
+    void CrossThreadNanos(int rounds, double& alloc_nanos, double& free_nanos) {
+        std::vector<void*> blocks(kBatch);
+        std::atomic<int> phase{0};
+        double free_total = 0;
+        std::thread freer([&]() {
+            for (int round = 0; round < rounds; ++round) {
+                while (phase.load(std::memory_order_acquire) != 2 * round + 1) std::this_thread::yield();
+                auto start = Clock::now();
+                for (void* block : blocks) Allocator::Deallocate(block);
+                free_total += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                phase.store(2 * round + 2, std::memory_order_release);
+            }
+        });
+        double alloc_total = 0;
+        for (int round = 0; round < rounds; ++round) {
+            while (phase.load(std::memory_order_acquire) != 2 * round) std::this_thread::yield();
+            auto start = Clock::now();
+            for (void*& block : blocks) block = Allocator::Allocate();
+            alloc_total += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            phase.store(2 * round + 1, std::memory_order_release);
+        }
+        freer.join();
+        alloc_nanos = alloc_total / (rounds * kBatch);
+        free_nanos = free_total / (rounds * kBatch);
+    }
+
+    template <typename Allocator>
+    void RunBlocks(const char* name, int rounds) {
+        double same_nanos = SameThreadNanos<Allocator>(rounds);
+        double alloc_nanos = 0;
+        double free_nanos = 0;
+        CrossThreadNanos<Allocator>(rounds, alloc_nanos, free_nanos);
+        printf("    %-8s same thread %5.1f ns/pair   cross thread %5.1f ns alloc + %5.1f ns free\n", name, same_nanos, alloc_nanos,
+               free_nanos);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int depth = argc > 2 ? atoi(argv[2]) : 17;
+    RunFanOut(threads, depth);
+
+    const int kRounds = 500;
+    printf("128-byte blocks, %d batches of %zu\n", kRounds, kBatch);
+    RunBlocks<MallocBlock>("malloc", kRounds);
+    RunBlocks<SlabAllocator<128>>("slab", kRounds);
+    return 0;
+}
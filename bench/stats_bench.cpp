@@ -0,0 +1,70 @@
+/*
+运行时统计的开销：直方图记录一次的耗时、每个任务多读的两次时钟、GetStats()取一次快照的耗时，
+以及有人不停调用GetStats()时线程池执行空任务的吞吐
+g++ -std=c++14 -O2 -I../ThreadPool stats_bench.cpp -o stats_bench -lpthread
+./stats_bench [线程数]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    template <typename F>
+    double NanosPerOp(long count, F&& f) {
+        auto start = Clock::now();
+        for (long i = 0; i < count; ++i) f(i);
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    }
+
+    // 提交count个空任务并等待全部执行完，返回每个任务的平均耗时
+    double PoolNanosPerTask(ThreadPool& pool, long count) {
+        std::atomic<long> done{0};
+        auto start = Clock::now();
+        for (long i = 0; i < count; ++i) pool.Post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+        while (done.load(std::memory_order_relaxed) != count) std::this_thread::yield();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0) threads = 4;
+    printf("threads %d\n", threads);
+
+    LatencyHistogram histogram;
+    printf("LatencyHistogram::Record      %6.1f ns\n", NanosPerOp(10000000, [&](long i) { histogram.Record(static_cast<uint64_t>(i) * 37); }));
+    LatencyHistogram local_histogram;
+    printf("LatencyHistogram::RecordLocal %6.1f ns\n", NanosPerOp(10000000, [&](long i) { local_histogram.RecordLocal(static_cast<uint64_t>(i) * 37); }));
+    volatile int64_t sink = 0;
+    printf("steady_clock::now             %6.1f ns\n", NanosPerOp(10000000, [&](long) { sink = Clock::now().time_since_epoch().count(); }));
+    (void)sink;
+
+    ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+    ThreadPool pool(config);
+    pool.Start();
+    PoolNanosPerTask(pool, 100000);
+    printf("GetStats                      %6.1f us\n", NanosPerOp(10000, [&](long) { pool.GetStats(); }) / 1e3);
+
+    const long kTasks = 2000000;
+    printf("empty task, no reader         %6.1f ns/task\n", PoolNanosPerTask(pool, kTasks));
+
+    // 另一个线程每毫秒取一次快照，相当于监控系统的采集频率上限
+    std::atomic<bool> stop{false};
+    std::thread reader([&pool, &stop]() {
+        while (!stop) {
+            pool.GetStats();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    printf("empty task, GetStats per ms   %6.1f ns/task\n", PoolNanosPerTask(pool, kTasks));
+    stop = true;
+    reader.join();
+    pool.ShutDown();
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+同步原语和mutex+condition_variable的对比：提交n个任务，主线程等待它们全部完成(fan-in)，
+分别用mutex+condvar实现的计数器、CountDownLatch、WaitGroup、Semaphore等待；另外单独测一次CountDown的耗时
+g++ -std=c++14 -O2 -I../ThreadPool sync_bench.cpp -o sync_bench -lpthread
+./sync_bench [线程数] [每种fan-in的轮数]
+*/
+#include "ThreadPool.h"
+#include "count_down_latch.h"
+#include "counting_semaphore.h"
+#include "wait_group.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    // 对照组：mutex+condition_variable实现的倒计数
+    class CondVarLatch {
+    public:
+        explicit CondVarLatch(int count) : count_(count) {}
+
+        void CountDown() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--count_ == 0) {
+                cv_.notify_all();
+            }
+        }
+
+        void Await() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return count_ == 0; });
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        int count_;
+    };
+
+    // 每轮提交fan_in个任务再等待，返回每轮的平均耗时(us)
+    template <typename F>
+    double FanIn(int rounds, F&& round) {
+        auto start = Clock::now();
+        for (int i = 0; i < rounds; ++i) round();
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+    }
+
+    // 一个线程等待时，另一个线程CountDown一次的平均耗时
+    template <typename Latch>
+    double CountDownNanos(long count) {
+        Latch latch(static_cast<int>(count));
+        std::thread waiter([&latch]() { latch.Await(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        auto start = Clock::now();
+        for (long i = 0; i < count; ++i) latch.CountDown();
+        double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+        waiter.join();
+        return nanos;
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    int rounds = argc > 2 ? atoi(argv[2]) : 200;
+    ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+    ThreadPool pool(config);
+    pool.Start();
+    printf("pool threads %d, average of %d rounds, us per round\n", threads, rounds);
+    printf("%6s  %10s  %10s  %10s  %10s\n", "fan-in", "mutex+cv", "latch", "waitgroup", "semaphore");
+    for (int fan_in : {2, 8, 32, 128, 256}) {
+        double condvar_us = FanIn(rounds, [&]() {
+            CondVarLatch latch(fan_in);
+            for (int i = 0; i < fan_in; ++i) pool.Post([&latch]() { latch.CountDown(); });
+            latch.Await();
+        });
+        double latch_us = FanIn(rounds, [&]() {
+            CountDownLatch latch(fan_in);
+            for (int i = 0; i < fan_in; ++i) pool.Post([&latch]() { latch.CountDown(); });
+            latch.Await();
+        });
+        double wait_group_us = FanIn(rounds, [&]() {
+            WaitGroup wait_group;
+            wait_group.Add(fan_in);
+            for (int i = 0; i < fan_in; ++i) pool.Post([&wait_group]() { wait_group.Done(); });
+            wait_group.Wait();
+        });
+        double semaphore_us = FanIn(rounds, [&]() {
+            Semaphore semaphore;
+            for (int i = 0; i < fan_in; ++i) pool.Post([&semaphore]() { semaphore.Release(); });
+            for (int i = 0; i < fan_in; ++i) semaphore.Acquire();
+        });
+        printf("%6d  %10.1f  %10.1f  %10.1f  %10.1f\n", fan_in, condvar_us, latch_us, wait_group_us, semaphore_us);
+    }
+    pool.ShutDown();
+
+    const long kCount = 10000000;
+    printf("CountDown with one waiter: mutex+cv %.1f ns, CountDownLatch %.1f ns\n", CountDownNanos<CondVarLatch>(kCount),
+           CountDownNanos<CountDownLatch>(kCount));
+    return 0;
+}
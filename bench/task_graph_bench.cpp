@@ -0,0 +1,96 @@
+/*
+TaskGraph每个节点的调度开销：宽图(1 -> n -> 1)、深图(n个节点的链)、随机图(每个节点随机依赖前面的两个节点)，
+节点都是空任务，同一个图反复执行；对照组是原来的写法：每个节点Run一次，提交线程在future上get等待前驱
+g++ -std=c++14 -O2 -I../ThreadPool task_graph_bench.cpp -o task_graph_bench -lpthread
+./task_graph_bench [线程数] [节点数] [执行次数]
+*/
+#include "ThreadPool.h"
+#include "task_graph.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    std::atomic<long> g_executed{0};
+
+    void Touch() { g_executed.fetch_add(1, std::memory_order_relaxed); }
+
+    double NanosPerNode(TaskGraph& graph, ThreadPool& pool, size_t node_num, int runs) {
+        graph.Run(pool);  // 第一次执行会检查环并缓存入口节点，不计时
+        auto start = Clock::now();
+        for (int i = 0; i < runs; ++i) graph.Run(pool);
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (runs * node_num);
+    }
+
+    void BuildWide(TaskGraph& graph, size_t node_num) {
+        TaskGraph::NodeId source = graph.AddNode(Touch);
+        TaskGraph::NodeId sink = graph.AddNode(Touch);
+        for (size_t i = 2; i < node_num; ++i) {
+            TaskGraph::NodeId node = graph.AddNode(Touch);
+            graph.AddEdge(source, node);
+            graph.AddEdge(node, sink);
+        }
+    }
+
+    void BuildDeep(TaskGraph& graph, size_t node_num) {
+        TaskGraph::NodeId prev = graph.AddNode(Touch);
+        for (size_t i = 1; i < node_num; ++i) {
+            TaskGraph::NodeId node = graph.AddNode(Touch);
+            graph.AddEdge(prev, node);
+            prev = node;
+        }
+    }
+
+    void BuildRandom(TaskGraph& graph, size_t node_num) {
+        std::mt19937 rng(1);
+        for (size_t i = 0; i < node_num; ++i) {
+            TaskGraph::NodeId node = graph.AddNode(Touch);
+            for (int j = 0; j < 2 && i > 0; ++j) {
+                graph.AddEdge(rng() % i, node);
+            }
+        }
+    }
+
+    // 原来的写法：按拓扑顺序提交，每个节点先get前驱的future，所以提交线程一直在阻塞等待
+    double ChainedRunNanos(ThreadPool& pool, size_t node_num, int runs) {
+        auto start = Clock::now();
+        for (int run = 0; run < runs; ++run) {
+            std::shared_ptr<std::future<void>> prev;
+            for (size_t i = 0; i < node_num; ++i) {
+                if (prev) prev->get();
+                prev = pool.Run(Touch);
+            }
+            prev->get();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (runs * node_num);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    size_t node_num = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 10000;
+    int runs = argc > 3 ? atoi(argv[3]) : 20;
+    ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+    ThreadPool pool(config);
+    pool.Start();
+    printf("pool threads %d, %zu trivial nodes, average of %d runs of a reused graph\n", threads, node_num, runs);
+
+    TaskGraph wide;
+    BuildWide(wide, node_num);
+    printf("wide   (1 -> n -> 1)              %7.0f ns/node\n", NanosPerNode(wide, pool, node_num, runs));
+    TaskGraph deep;
+    BuildDeep(deep, node_num);
+    printf("deep   (chain of n)               %7.0f ns/node\n", NanosPerNode(deep, pool, node_num, runs));
+    TaskGraph random;
+    BuildRandom(random, node_num);
+    printf("random (2 random preds per node)  %7.0f ns/node\n", NanosPerNode(random, pool, node_num, runs));
+    printf("chain of Run() + future::get()    %7.0f ns/node\n", ChainedRunNanos(pool, node_num, runs));
+    pool.ShutDown();
+    return 0;
+}
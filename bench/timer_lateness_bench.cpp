@@ -0,0 +1,91 @@
+/*
+定时器触发延迟的分布：三种调度方式(kCondition、kTimerFd、kExternalLoop)各加入n个定时器，
+加入的时间均匀分布在n*100us内，每个定时器在0.2~20ms之后到期；延迟是线程池中开始执行的时间减去到期时间，负数表示提前触发
+kExternalLoop由这里的一个线程epoll_wait GetTimerFd()，可读时调用DispatchExpired
+g++ -std=c++14 -O2 -I../My_Timer timer_lateness_bench.cpp -o timer_lateness_bench -lpthread
+./timer_lateness_bench [定时器个数] [w表示时间轮后端]
+*/
+#include "timer.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace wzq;
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+    const int kBucketNum = 9;
+    const char* kBucketNames[kBucketNum] = {"<-1ms", "-1ms~0", "0~50us", "50~100us", "100~250us", "250~500us", "0.5~1ms", "1~2ms", ">2ms"};
+
+    int BucketOf(int64_t late_ns) {
+        const int64_t kBounds[kBucketNum - 1] = {-1000000, 0, 50000, 100000, 250000, 500000, 1000000, 2000000};
+        int bucket = 0;
+        while (bucket < kBucketNum - 1 && late_ns >= kBounds[bucket]) ++bucket;
+        return bucket;
+    }
+
+    void RunMode(const char* name, TimerQueue::DispatchMode mode, TimerQueue::TimerBackend backend, int count) {
+        TimerQueue timer(backend, mode);
+        timer.Run();
+        std::atomic<bool> stop{false};
+        std::thread loop;
+        if (mode == TimerQueue::DispatchMode::kExternalLoop && timer.GetTimerFd() >= 0) {
+            loop = std::thread([&timer, &stop]() {
+                int epoll_fd = epoll_create1(0);
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.fd = timer.GetTimerFd();
+                epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer.GetTimerFd(), &event);
+                while (!stop) {
+                    if (epoll_wait(epoll_fd, &event, 1, 10) > 0) timer.DispatchExpired();
+                }
+                close(epoll_fd);
+            });
+        }
+
+        std::vector<int64_t> lateness(count);
+        std::atomic<int> done{0};
+        std::mt19937 rng(5);
+        auto start = Clock::now();
+        for (int i = 0; i < count; ++i) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(i * 100));
+            auto due = Clock::now() + std::chrono::microseconds(200 + rng() % 19800);
+            timer.AddFuncAtTimePoint(due, [&lateness, &done, due, i]() {
+                lateness[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - due).count();
+                ++done;
+            });
+        }
+        while (done < count) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stop = true;
+        if (loop.joinable()) loop.join();
+        timer.Stop();
+
+        long histogram[kBucketNum] = {0};
+        for (int64_t late_ns : lateness) ++histogram[BucketOf(late_ns)];
+        std::sort(lateness.begin(), lateness.end());
+        printf("%-14s", name);
+        for (long num : histogram) printf(" %9.1f%%", num * 100.0 / count);
+        printf("  %7.0f %7.0f %7.0f\n", lateness[count / 2] / 1e3, lateness[count * 99 / 100] / 1e3, lateness[count - 1] / 1e3);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    bool is_wheel = argc > 2 && argv[2][0] == 'w';
+    TimerQueue::TimerBackend backend = is_wheel ? TimerQueue::TimerBackend::kWheel : TimerQueue::TimerBackend::kHeap;
+    printf("%d timers, 0.2~20ms delays, added over %.1f s, %s backend; lateness = start on a pool thread - due time\n", count,
+           count * 1e-4, is_wheel ? "wheel" : "heap");
+    printf("%-14s", "");
+    for (const char* bucket_name : kBucketNames) printf(" %10s", bucket_name);
+    printf("  %7s %7s %7s (us)\n", "p50", "p99", "max");
+    RunMode("kCondition", TimerQueue::DispatchMode::kCondition, backend, count);
+    RunMode("kTimerFd", TimerQueue::DispatchMode::kTimerFd, backend, count);
+    RunMode("kExternalLoop", TimerQueue::DispatchMode::kExternalLoop, backend, count);
+    return 0;
+}
@@ -0,0 +1,75 @@
+/*
+slack合并唤醒的效果：n个定时器的到期时间均匀分布在10秒内，slack在[0, 最大slack]内随机，
+用GetStats()的wakeup_num和posted_num统计每秒唤醒调度线程的次数和提交给线程池的任务数，
+同时检查有没有定时器早于到期时间触发，以及超过最晚触发时间(到期时间+slack)多久才执行
+kCondition本来就允许提前不到1毫秒触发，所以另外统计提前超过1毫秒的个数
+g++ -std=c++14 -O2 -I../My_Timer timer_slack_bench.cpp -o timer_slack_bench -lpthread
+./timer_slack_bench [定时器个数]
+*/
+#include "timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace wzq;
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+
+    const int kSpanUs = 10000000;
+
+    void RunSlack(const char* name, TimerQueue::TimerBackend backend, TimerQueue::DispatchMode mode, int max_slack_ms, int count) {
+        TimerQueue timer(backend, mode);
+        timer.Run();
+        std::mt19937 rng(11);
+        std::atomic<int> done{0};
+        std::atomic<int> early_num{0};
+        std::atomic<int> very_early_num{0};
+        std::vector<int64_t> overdue(count);  // 超过最晚触发时间的时间，没超过时是0
+        auto base = Clock::now() + std::chrono::seconds(1);
+        for (int i = 0; i < count; ++i) {
+            auto due = base + std::chrono::microseconds(rng() % kSpanUs);
+            auto slack = std::chrono::microseconds(max_slack_ms > 0 ? rng() % (max_slack_ms * 1000 + 1) : 0);
+            timer.AddFuncAtTimePoint(due, TimerQueue::Slack(slack), [&, due, slack, i]() {
+                auto now = Clock::now();
+                if (now < due) ++early_num;
+                if (now < due - std::chrono::milliseconds(1)) ++very_early_num;
+                overdue[i] = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due - slack).count(), 0);
+                ++done;
+            });
+        }
+        std::this_thread::sleep_until(base);
+        TimerQueue::TimerStats stats_start = timer.GetStats();
+        auto start = std::chrono::steady_clock::now();
+        while (done < count) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        TimerQueue::TimerStats stats = timer.GetStats();
+        timer.Stop();
+
+        uint64_t wakeup_num = stats.wakeup_num - stats_start.wakeup_num;
+        uint64_t posted_num = stats.posted_num - stats_start.posted_num;
+        uint64_t fired_num = stats.fired_num - stats_start.fired_num;
+        std::sort(overdue.begin(), overdue.end());
+        printf("%-16s slack<=%3dms  %9.0f %9.0f %8.1f   %8d %8d   %8.1f %8.1f\n", name, max_slack_ms, wakeup_num / seconds, posted_num / seconds,
+               1.0 * fired_num / std::max<uint64_t>(posted_num, 1), early_num.load(), very_early_num.load(), overdue[count * 99 / 100] / 1e3,
+               overdue[count - 1] / 1e3);
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 1000000;
+    printf("%d timers, deadlines uniform over 10 s, slack uniform in [0, max]; per second over the run\n", count);
+    printf("%-16s %12s  %9s %9s %8s   %8s %8s   %17s\n", "", "", "wakeups/s", "tasks/s", "timers/task", "early", "early>1ms",
+           "past window p99/max (us)");
+    const TimerQueue::TimerBackend kHeap = TimerQueue::TimerBackend::kHeap;
+    const TimerQueue::TimerBackend kWheel = TimerQueue::TimerBackend::kWheel;
+    const TimerQueue::DispatchMode kTimerFd = TimerQueue::DispatchMode::kTimerFd;
+    const TimerQueue::DispatchMode kCondition = TimerQueue::DispatchMode::kCondition;
+    for (int max_slack_ms : {0, 10, 100}) RunSlack("heap  timerfd", kHeap, kTimerFd, max_slack_ms, count);
+    for (int max_slack_ms : {0, 10, 100}) RunSlack("heap  condition", kHeap, kCondition, max_slack_ms, count);
+    RunSlack("wheel timerfd", kWheel, kTimerFd, 100, count);
+    RunSlack("wheel condition", kWheel, kCondition, 100, count);
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+定时器两种后端的对比：直接使用timer_wheel.h中的TimerHeap和TimerWheel，时间是模拟的，不等待真实时间。
+n个定时器的到期时间均匀分布在60秒内，先全部插入，再取消一半，剩下的按1毫秒一步推进时间全部触发，
+统计插入、取消、触发每个定时器的耗时和插入之后每个定时器占用的内存
+g++ -std=c++14 -O2 -I../My_Timer timer_wheel_bench.cpp -o timer_wheel_bench -lpthread
+./timer_wheel_bench [定时器个数]
+*/
+#include "timer_wheel.h"
+
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace wzq;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+    const int64_t kSpanNs = 60LL * 1000 * 1000 * 1000;
+    const int64_t kStepNs = 1000 * 1000;
+
+    size_t HeapBytes() {
+        struct mallinfo2 info = mallinfo2();
+        return info.uordblks + info.hblkhd;
+    }
+
+    double NanosSince(Clock::time_point start) { return std::chrono::duration<double, std::nano>(Clock::now() - start).count(); }
+
+    // 两种后端的接口不完全一样，用两个小的适配器统一成Insert/Remove/Expire
+    struct HeapBackend {
+        TimerHeap heap{TimerNode::kHeap};
+
+        void Insert(TimerNodePool& nodes, uint32_t slot) { heap.Push(nodes, slot); }
+        void Remove(TimerNodePool& nodes, uint32_t slot) { heap.Remove(nodes, slot); }
+        void Expire(TimerNodePool& nodes, int64_t now_ns, std::vector<uint32_t>& expired) { heap.PopExpired(nodes, now_ns, expired); }
+    };
+
+    struct WheelBackend {
+        TimerWheel wheel{0};
+
+        void Insert(TimerNodePool& nodes, uint32_t slot) { wheel.Insert(nodes, slot); }
+        void Remove(TimerNodePool& nodes, uint32_t slot) { wheel.Remove(nodes, slot); }
+        void Expire(TimerNodePool& nodes, int64_t now_ns, std::vector<uint32_t>& expired) { wheel.Advance(nodes, now_ns, expired); }
+    };
+
+    template <typename Backend>
+    void Run(const char* name, long count) {
+        std::mt19937_64 rng(1);
+        std::vector<int64_t> deadlines(count);
+        for (int64_t& deadline : deadlines) deadline = 1 + static_cast<int64_t>(rng() % kSpanNs);
+        std::vector<uint32_t> slots(count);
+
+        size_t bytes_before = HeapBytes();
+        {
+            TimerNodePool nodes;
+            Backend backend;
+            auto start = Clock::now();
+            for (long i = 0; i < count; ++i) {
+                uint32_t slot = nodes.Alloc();
+                nodes[slot].deadline_ns = deadlines[i];
+                backend.Insert(nodes, slot);
+                slots[i] = slot;
+            }
+            double insert_ns = NanosSince(start) / count;
+            double bytes_per_timer = 1.0 * (HeapBytes() - bytes_before) / count;
+
+            start = Clock::now();
+            for (long i = 0; i < count; i += 2) {
+                backend.Remove(nodes, slots[i]);
+                nodes.Free(slots[i]);
+            }
+            long cancelled = (count + 1) / 2;
+            double cancel_ns = NanosSince(start) / cancelled;
+
+            long fired = 0;
+            std::vector<uint32_t> expired;
+            start = Clock::now();
+            for (int64_t now_ns = 0; now_ns <= kSpanNs + kStepNs; now_ns += kStepNs) {
+                expired.clear();
+                backend.Expire(nodes, now_ns, expired);
+                for (uint32_t slot : expired) nodes.Free(slot);
+                fired += static_cast<long>(expired.size());
+            }
+            double fire_ns = NanosSince(start) / std::max(fired, 1L);
+            printf("%-6s insert %4.0f ns  cancel %4.0f ns  fire %5.0f ns/timer  %4.0f B/timer  (fired %ld of %ld)\n", name, insert_ns,
+                   cancel_ns, fire_ns, bytes_per_timer, fired, count - cancelled);
+        }
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    long count = argc > 1 ? atol(argv[1]) : 10000000;
+    printf("%ld timers, deadlines uniform over 60 s, every other one cancelled, the rest fired advancing 1 ms at a time\n", count);
+    printf("sizeof(TimerNode) %zu bytes\n", sizeof(TimerNode));
+    Run<HeapBackend>("heap", count);
+    Run<WheelBackend>("wheel", count);
+    return 0;
+}
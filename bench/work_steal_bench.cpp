@@ -0,0 +1,71 @@
+/*
+全局队列和工作窃取两种调度模式的对比
+g++ -std=c++14 -O2 -I../ThreadPool work_steal_bench.cpp -o work_steal_bench -lpthread
+./work_steal_bench [线程数] [递归深度]
+*/
+#include "ThreadPool.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+using namespace wzq;
+
+namespace {
+
+    std::atomic<long> g_done{0};
+
+    double SecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 在任务中继续提交两个子任务，总共2^(depth+1)-1个任务，工作窃取模式下子任务进入当前线程的本地队列
+    void Spawn(ThreadPool* pool, int depth) {
+        g_done.fetch_add(1, std::memory_order_relaxed);
+        if (depth == 0) return;
+        pool->Post([pool, depth]() { Spawn(pool, depth - 1); });
+        pool->Post([pool, depth]() { Spawn(pool, depth - 1); });
+    }
+
+    void WaitDone(long total) {
+        while (g_done.load(std::memory_order_relaxed) != total) std::this_thread::yield();
+    }
+
+    void RunMode(ThreadPool::ScheduleMode mode, const char* name, int threads, int depth) {
+        ThreadPool::ThreadPoolConfig config{threads, threads, 0, std::chrono::seconds(4)};
+        config.schedule_mode = mode;
+        ThreadPool pool(config);
+        pool.Start();
+
+        // 任务中递归提交
+        long total = (1L << (depth + 1)) - 1;
+        g_done = 0;
+        auto start = std::chrono::steady_clock::now();
+        pool.Post([&pool, depth]() { Spawn(&pool, depth); });
+        WaitDone(total);
+        double fork_sec = SecondsSince(start);
+
+        // 外部线程提交大量空任务
+        const long kFlood = 1000000;
+        g_done = 0;
+        start = std::chrono::steady_clock::now();
+        for (long i = 0; i < kFlood; ++i) pool.Post([]() { g_done.fetch_add(1, std::memory_order_relaxed); });
+        WaitDone(kFlood);
+        double flood_sec = SecondsSince(start);
+
+        printf("%-14s fork %ld tasks %.1f ms (%.0f ns/task)   external %ld tasks %.1f ms (%.0f ns/task)   steals %llu\n", name,
+               total, fork_sec * 1e3, fork_sec * 1e9 / total, kFlood, flood_sec * 1e3, flood_sec * 1e9 / kFlood,
+               (unsigned long long)pool.GetStats().steal_num);
+        pool.ShutDown();
+    }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int depth = argc > 2 ? atoi(argv[2]) : 18;
+    if (threads <= 0) threads = 4;
+    printf("threads %d depth %d\n", threads, depth);
+    RunMode(ThreadPool::ScheduleMode::kGlobalQueue, "kGlobalQueue", threads, depth);
+    RunMode(ThreadPool::ScheduleMode::kWorkStealing, "kWorkStealing", threads, depth);
+    return 0;
+}
@@ -10,6 +10,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <wait.h>
+
+#include "trace.h"
 using namespace std;
 
 //const
@@ -111,7 +113,7 @@ string parser(string request)
     if (request.substr(0, 4) == "POST")  //上传信息
     {
         string result = request.substr(request.find("fname") + 6); //取出fname之后的所有内容
-        cout << "fname:" << result << endl; 
+        WZQ_TRACE_INFO("fname", result);
         string dresult = UrlDecode(result);
         doreverse(dresult);
         response += "HTTP/1.0 200 OK\r\n";
@@ -148,7 +150,7 @@ void sig_child(int signo)
     while ((pid = waitpid(-1, &stat, WNOHANG)) > 0)
     {
         //connum--;
-        cout << "end child:" << pid << endl;
+        WZQ_TRACE_INFO("end child", pid);
         //cout << "client number: " << connum << endl;
     }
 
@@ -157,8 +159,7 @@ void sig_child(int signo)
 void print_addr(const sockaddr_in cliaddr)
 {
     sa.s_addr = cliaddr.sin_addr.s_addr;
-    cout << inet_ntoa(sa) << ":";
-    cout << htons(cliaddr.sin_port) << endl;
+    WZQ_TRACE_INFO("client", inet_ntoa(sa), ntohs(cliaddr.sin_port));
 }
 
 void my_echo(int connfd)
@@ -168,20 +169,19 @@ void my_echo(int connfd)
     {
         if (n = (recv(connfd, recvbuf_c, BUFSIZE, 0)) > 0)
         {
-            cout << "get request "
-                 << "from: ";
+            WZQ_TRACE_INFO("get request");
             print_addr(cliaddr);
             string response = parser(string(recvbuf_c));
             //doreverse(recvbuf);
             if (send(connfd, response.c_str(), response.length() * sizeof(char), 0) <= 0)
             {
-                cout << "send error" << endl;
+                WZQ_TRACE_ERROR("send error", errno);
                 break;
             }
         }
         else
         {
-            cout << "read error" << endl;
+            WZQ_TRACE_ERROR("read error", errno);
             break;
         }
     }
@@ -195,7 +195,7 @@ int main()
     bind(listenfd, (sockaddr *)&seraddr, sizeof(seraddr));/*将 socket与ip，端口绑定*/
     listen(listenfd, LISTENQ);/*设置内核监听队列的最大长度，并开始监听*/
     signal(SIGCHLD, sig_child);//注册信号处理函数，即产生SIGCHILD信号后执行b编写的额sig_child函数，而不是操作系统的默认函数
-    cout << "Begin to listen" << endl;
+    WZQ_TRACE_INFO("begin to listen", PORT);
     while (1)
     {
         clilen = sizeof(cliaddr);
@@ -215,14 +215,14 @@ int main()
                 //child
                 close(listenfd);//关闭监听socket
                 my_echo(connfd);//回复
-                cout << "end the echo" << endl;
+                WZQ_TRACE_INFO("end the echo");
                 exit(0);  //结束子进程，并通知父进程回收
             }
             else
             {
               //父进程直接关闭connfd，单这时候子进程也指向这个socket，所以直到子进程关闭才会真正关闭connfd
                 connum++;
-                cout << "client number:  " << connum << endl;
+                WZQ_TRACE_INFO("client number", connum);
                 close(connfd);
             }
         }
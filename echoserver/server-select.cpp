@@ -10,6 +10,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <wait.h>
+
+#include "trace.h"
 using namespace std;
 
 //const
@@ -33,8 +35,7 @@ fd_set rset, allset;
 void print_addr(const sockaddr_in cliaddr)
 {
     sa.s_addr = cliaddr.sin_addr.s_addr;
-    cout << inet_ntoa(sa) << ":";
-    cout << htons(cliaddr.sin_port) << endl;
+    WZQ_TRACE_INFO("client", inet_ntoa(sa), ntohs(cliaddr.sin_port));
 }
 void doreverse(char *ptr)
 {
@@ -56,18 +57,17 @@ void my_echo(int connfd)
 
     if (n = (recv(connfd, recvbuf, BUFSIZE, 0)) > 0)
     {
-        cout << "get: " << recvbuf << "\t";
-        cout << "from: ";
+        WZQ_TRACE_INFO("get", recvbuf);
         print_addr(cliaddr);
         doreverse(recvbuf);
         if (send(connfd, recvbuf, BUFSIZE, 0) <= 0)
         {
-            cout << "send error" << endl;
+            WZQ_TRACE_ERROR("send error", errno);
         }
     }
     else
     {
-        cout << "read error" << endl;
+        WZQ_TRACE_ERROR("read error", errno);
     }
 }
 int main()
@@ -85,7 +85,7 @@ int main()
     FD_ZERO(&allset);
     FD_SET(listenfd, &allset);
 
-    cout << "Begin to listen" << endl;
+    WZQ_TRACE_INFO("begin to listen", PORT);
 
     while (1)
     {
@@ -93,7 +93,7 @@ int main()
         nready = select(maxfd + 1, &rset, nullptr, nullptr, NULL);
         if (FD_ISSET(listenfd, &rset))
         {
-            cout << "new client" << endl;
+            WZQ_TRACE_INFO("new client");
             clilen = sizeof(cliaddr);
             if ((connfd = accept(listenfd, (sockaddr *)&cliaddr, &clilen)) < 0)
             {
@@ -116,7 +116,7 @@ int main()
                 //cout << "accepted:" << i << ":" << connfd << endl;
                 if (i == FD_SETSIZE)
                 {
-                    cout << "too many clients" << endl;
+                    WZQ_TRACE_ERROR("too many clients");
                     break;
                 }
                 FD_SET(connfd, &allset);
@@ -140,7 +140,7 @@ int main()
                 FD_CLR(sockfd, &allset);
                 close(sockfd);
                 nready--;
-                cout << "close client No." << i << endl;
+                WZQ_TRACE_INFO("close client", i);
             }
             if (nready <= 0)
                 break;
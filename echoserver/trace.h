@@ -0,0 +1,358 @@
+#ifndef __TRACE__
+#define __TRACE__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __unix__
+#include <pthread.h>
+#endif
+
+/*
+异步追踪：记录事件的线程只把二进制的时间戳和参数写进自己的无锁环形缓冲区，不加锁也不做任何I/O，
+后台线程定期把所有缓冲区中的事件按时间排序、格式化后写到输出文件（默认stdout）。
+
+编译时用WZQ_TRACE_LEVEL选择记录哪些级别的事件：
+0: 全部关闭  1: 只记录错误  2: 记录错误和一般信息（默认）  3: 再加上线程池内部每次等待、唤醒这类调试信息
+被关闭的级别的WZQ_TRACE_xxx宏展开为空语句，参数也不会被求值。
+
+用法：WZQ_TRACE_INFO("add thread", id, flag); 第一个参数必须是字符串常量，后面最多kMaxArgs个整数或字符串参数，
+输出为"[时间] [线程] [级别] add thread 3 1"。
+*/
+
+#ifndef WZQ_TRACE_LEVEL
+#define WZQ_TRACE_LEVEL 2
+#endif
+
+#if WZQ_TRACE_LEVEL >= 1
+#define WZQ_TRACE_ERROR(...) ::wzq::Tracer::Instance().Record(::wzq::TraceLevel::kError, __VA_ARGS__)
+#else
+#define WZQ_TRACE_ERROR(...) ((void)0)
+#endif
+
+#if WZQ_TRACE_LEVEL >= 2
+#define WZQ_TRACE_INFO(...) ::wzq::Tracer::Instance().Record(::wzq::TraceLevel::kInfo, __VA_ARGS__)
+#else
+#define WZQ_TRACE_INFO(...) ((void)0)
+#endif
+
+#if WZQ_TRACE_LEVEL >= 3
+#define WZQ_TRACE_DEBUG(...) ::wzq::Tracer::Instance().Record(::wzq::TraceLevel::kDebug, __VA_ARGS__)
+#else
+#define WZQ_TRACE_DEBUG(...) ((void)0)
+#endif
+
+namespace wzq {
+
+    enum class TraceLevel { kError = 1, kInfo = 2, kDebug = 3 };
+
+    /**
+     * 一条追踪事件，格式化推迟到后台线程
+     * 整数参数直接保存在args中；字符串参数复制到text里，args中保存它在text中的偏移，text放不下的部分会被截断
+     */
+    struct TraceEvent {
+        static const int kMaxArgs = 4;
+        static const int kTextSize = 64;
+
+        int64_t timestamp_ns;
+        uint32_t thread_index;
+        TraceLevel level;
+        const char* message;
+        uint8_t arg_num;
+        uint8_t text_mask;  //第i位为1表示第i个参数是字符串
+        uint8_t text_size;
+        int64_t args[kMaxArgs];
+        char text[kTextSize];
+    };
+
+    /**
+     * 每个线程一个的单生产者单消费者环形缓冲区，记录事件的线程写入，后台线程读取
+     * 缓冲区满了直接丢弃新的事件并计数，不会阻塞记录事件的线程
+     */
+    class TraceBuffer {
+    public:
+        static const size_t kCapacity = 1024;
+
+        explicit TraceBuffer(uint32_t thread_index)
+            : thread_index_(thread_index), events_(new TraceEvent[kCapacity]), head_(0), tail_(0), dropped_(0), retired_(false) {}
+
+        TraceBuffer(const TraceBuffer&) = delete;
+        TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+        uint32_t ThreadIndex() const { return thread_index_; }
+
+        //返回可以写入的位置，缓冲区已满时返回nullptr
+        TraceEvent* BeginWrite() {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_.load(std::memory_order_acquire) >= kCapacity) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            return &events_[tail % kCapacity];
+        }
+
+        void EndWrite() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+        //只能由一个线程调用
+        template <typename F>
+        void Drain(F&& func) {
+            size_t head = head_.load(std::memory_order_relaxed);
+            size_t tail = tail_.load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                func(events_[head % kCapacity]);
+            }
+            head_.store(head, std::memory_order_release);
+        }
+
+        bool Empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+        void Clear() { head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release); }
+
+        uint64_t TakeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+
+        void Retire() { retired_.store(true, std::memory_order_release); }
+
+        bool IsRetired() const { return retired_.load(std::memory_order_acquire); }
+
+    private:
+        const uint32_t thread_index_;
+        std::unique_ptr<TraceEvent[]> events_;
+        std::atomic<size_t> head_;
+        std::atomic<size_t> tail_;
+        std::atomic<uint64_t> dropped_;
+        std::atomic<bool> retired_;  //所属线程已经退出，取完剩余事件后就可以释放
+    };
+
+    /**
+     * 追踪系统，进程内唯一
+     * 第一次记录事件时启动后台线程，每隔flush_interval取出所有缓冲区中的事件输出；进程退出时在atexit中输出剩余的事件
+     * fork出的子进程会丢弃从父进程复制来的事件，并在第一次记录事件时重新启动自己的后台线程
+     */
+    class Tracer {
+    public:
+        //故意不释放，静态对象析构时记录事件也是安全的
+        static Tracer& Instance() {
+            static Tracer* tracer = new Tracer();
+            return *tracer;
+        }
+
+        template <typename... Args>
+        void Record(TraceLevel level, const char* message, const Args&... args) {
+            static_assert(sizeof...(Args) <= TraceEvent::kMaxArgs, "too many trace arguments");
+            TraceBuffer* buffer = LocalBuffer();
+            TraceEvent* event = buffer->BeginWrite();
+            if (event == nullptr) {
+                return;
+            }
+            event->timestamp_ns = NowNanos();
+            event->thread_index = buffer->ThreadIndex();
+            event->level = level;
+            event->message = message;
+            event->arg_num = 0;
+            event->text_mask = 0;
+            event->text_size = 0;
+            int expand[] = { 0, (PutArg(*event, args), 0)... };
+            (void)expand;
+            buffer->EndWrite();
+            if (!flusher_started_.load(std::memory_order_acquire) && !stopped_.load(std::memory_order_relaxed)) {
+                StartFlusher();
+            }
+        }
+
+        //在调用线程中立即输出所有缓冲区中的事件
+        void Flush() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            DrainAll();
+        }
+
+        void SetOutput(FILE* output) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            output_ = output;
+        }
+
+        void SetFlushInterval(std::chrono::milliseconds interval) { flush_interval_ms_.store(std::max<int64_t>(interval.count(), 1)); }
+
+    private:
+        static const int kSleepStepMs = 10;
+
+        //线程退出时thread_local的LocalHolder析构，把缓冲区标记为退役
+        struct LocalHolder {
+            std::shared_ptr<TraceBuffer> buffer;
+            ~LocalHolder() {
+                if (buffer != nullptr) {
+                    buffer->Retire();
+                }
+            }
+        };
+
+        Tracer()
+            : output_(stdout), next_thread_index_(0), start_ns_(NowNanos()), flush_interval_ms_(100), flusher_started_(false), stopped_(false) {
+            std::atexit(&Tracer::OnExit);
+#ifdef __unix__
+            pthread_atfork(&Tracer::BeforeFork, &Tracer::AfterForkInParent, &Tracer::AfterForkInChild);
+#endif
+        }
+
+        static int64_t NowNanos() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        static LocalHolder& Local() {
+            static thread_local LocalHolder holder;
+            return holder;
+        }
+
+        TraceBuffer* LocalBuffer() {
+            LocalHolder& holder = Local();
+            if (holder.buffer == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                holder.buffer = std::make_shared<TraceBuffer>(next_thread_index_++);
+                buffers_.push_back(holder.buffer);
+            }
+            return holder.buffer.get();
+        }
+
+        template <typename T>
+        static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type PutArg(TraceEvent& event, const T& value) {
+            event.args[event.arg_num++] = static_cast<int64_t>(value);
+        }
+
+        static void PutArg(TraceEvent& event, const char* text) {
+            size_t offset = event.text_size;
+            size_t rest = TraceEvent::kTextSize - offset;
+            size_t length = text != nullptr ? std::min(std::strlen(text), rest - 1) : 0;
+            if (length > 0) {
+                std::memcpy(event.text + offset, text, length);
+            }
+            event.text[offset + length] = '\0';
+            event.text_size = static_cast<uint8_t>(std::min(offset + length + 1, static_cast<size_t>(TraceEvent::kTextSize - 1)));
+            event.text_mask |= static_cast<uint8_t>(1 << event.arg_num);
+            event.args[event.arg_num++] = static_cast<int64_t>(offset);
+        }
+
+        static void PutArg(TraceEvent& event, char* text) { PutArg(event, static_cast<const char*>(text)); }
+
+        static void PutArg(TraceEvent& event, const std::string& text) { PutArg(event, text.c_str()); }
+
+        void StartFlusher() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (flusher_started_.load() || stopped_) {
+                return;
+            }
+            flusher_.reset(new std::thread([this]() { FlushLoop(); }));
+            flusher_started_.store(true, std::memory_order_release);
+        }
+
+        void FlushLoop() {
+            while (!stopped_.load()) {
+                for (int64_t slept = 0; slept < flush_interval_ms_.load() && !stopped_.load(); slept += kSleepStepMs) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int64_t>(kSleepStepMs)));
+                }
+                Flush();
+            }
+        }
+
+        //调用时需要持有mutex_
+        void DrainAll() {
+            std::vector<TraceEvent> events;
+            auto iter = buffers_.begin();
+            while (iter != buffers_.end()) {
+                TraceBuffer& buffer = **iter;
+                bool is_retired = buffer.IsRetired();
+                buffer.Drain([&events](const TraceEvent& event) { events.push_back(event); });
+                uint64_t dropped = buffer.TakeDropped();
+                if (dropped > 0) {
+                    std::fprintf(output_, "[trace] thread %u dropped %llu events\n", buffer.ThreadIndex(),
+                        static_cast<unsigned long long>(dropped));
+                }
+                if (is_retired && buffer.Empty()) {
+                    iter = buffers_.erase(iter);
+                }
+                else {
+                    ++iter;
+                }
+            }
+            std::stable_sort(events.begin(), events.end(),
+                [](const TraceEvent& a, const TraceEvent& b) { return a.timestamp_ns < b.timestamp_ns; });
+            for (auto& event : events) {
+                Write(event);
+            }
+            if (!events.empty()) {
+                std::fflush(output_);
+            }
+        }
+
+        void Write(const TraceEvent& event) {
+            static const char* kLevelNames[] = { "", "ERROR", "INFO", "DEBUG" };
+            char line[256];
+            int64_t elapsed_us = (event.timestamp_ns - start_ns_) / 1000;
+            int length = std::snprintf(line, sizeof(line), "[%lld.%06lld] [T%u] [%s] %s",
+                static_cast<long long>(elapsed_us / 1000000), static_cast<long long>(elapsed_us % 1000000), event.thread_index,
+                kLevelNames[static_cast<int>(event.level)], event.message);
+            for (int i = 0; i < event.arg_num && length > 0 && length < static_cast<int>(sizeof(line)); ++i) {
+                if (event.text_mask & (1 << i)) {
+                    length += std::snprintf(line + length, sizeof(line) - length, " %s", event.text + event.args[i]);
+                }
+                else {
+                    length += std::snprintf(line + length, sizeof(line) - length, " %lld", static_cast<long long>(event.args[i]));
+                }
+            }
+            std::fprintf(output_, "%s\n", line);
+        }
+
+        static void OnExit() {
+            Tracer& tracer = Instance();
+            tracer.stopped_.store(true);
+            if (tracer.flusher_ != nullptr && tracer.flusher_->joinable()) {
+                tracer.flusher_->join();
+            }
+            tracer.Flush();
+        }
+
+        static void BeforeFork() { Instance().mutex_.lock(); }
+
+        static void AfterForkInParent() { Instance().mutex_.unlock(); }
+
+        //子进程中只有调用fork的线程，后台线程已经不存在，复制来的事件交给父进程输出
+        static void AfterForkInChild() {
+            Tracer& tracer = Instance();
+            tracer.flusher_.release();  //线程已经不存在，std::thread对象不能析构也不能join，直接放弃
+            tracer.flusher_started_.store(false);
+            std::shared_ptr<TraceBuffer> local = Local().buffer;
+            for (auto& buffer : tracer.buffers_) {
+                buffer->Clear();
+                buffer->TakeDropped();
+            }
+            tracer.buffers_.clear();
+            if (local != nullptr) {
+                tracer.buffers_.push_back(local);
+            }
+            tracer.mutex_.unlock();
+        }
+
+        std::mutex mutex_;  //保护buffers_和输出，同一时间只有一个线程取事件
+        std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+        FILE* output_;
+        uint32_t next_thread_index_;
+        const int64_t start_ns_;
+        std::atomic<int64_t> flush_interval_ms_;
+        std::unique_ptr<std::thread> flusher_;
+        std::atomic<bool> flusher_started_;
+        std::atomic<bool> stopped_;
+    };
+
+}  // namespace wzq
+
+#endif